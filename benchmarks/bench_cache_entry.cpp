@@ -0,0 +1,89 @@
+// Decode cost of cached entries: previous HTTP text format vs binary format
+#include "../src/cache/cacheEntry.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // The text parsing previously done by ProxyHandler::get_cached_response
+    HttpResponsePtr parse_text_entry(const std::string& cached_data) {
+        size_t header_end = cached_data.find("\r\n\r\n");
+        std::string headers_str = cached_data.substr(0, header_end);
+        std::string body = cached_data.substr(header_end + 4);
+
+        auto response = std::make_shared<HttpResponse>();
+        size_t first_line_end = headers_str.find("\r\n");
+        std::string status_line = headers_str.substr(0, first_line_end);
+        size_t code_start = status_line.find(" ");
+        size_t code_end = status_line.find(" ", code_start + 1);
+        response->set_status(static_cast<HttpStatus>(
+            std::stoi(status_line.substr(code_start + 1, code_end - code_start - 1))));
+
+        std::istringstream headers_stream(headers_str);
+        std::string line;
+        std::getline(headers_stream, line);
+        while (std::getline(headers_stream, line) && !line.empty()) {
+            if (line.back() == '\r') {
+                line.pop_back();
+            }
+            size_t colon_pos = line.find(':');
+            if (colon_pos != std::string::npos) {
+                size_t value_start = line.find_first_not_of(" \t", colon_pos + 1);
+                response->set_header(line.substr(0, colon_pos),
+                                     value_start != std::string::npos ? line.substr(value_start) : "");
+            }
+        }
+
+        response->set_body(body, response->get_header("Content-Type", "text/plain"));
+        return response;
+    }
+
+    template <typename Fn>
+    double ns_per_op(int iterations, Fn fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+}
+
+int main() {
+    const size_t sizes[] = {1024, 100 * 1024, 1024 * 1024};
+
+    std::cout << "size\ttext parse\tbinary view\tbinary deserialize (ns/op)" << std::endl;
+    for (size_t size : sizes) {
+        CacheEntry entry;
+        entry.response = std::make_shared<HttpResponse>(HttpStatus::OK);
+        entry.response->set_body(std::string(size, 'x'), "application/json");
+        entry.response->set_header("ETag", "\"abcdef0123456789\"");
+        entry.response->set_header("Cache-Control", "max-age=300, stale-while-revalidate=30");
+        entry.response->set_header("Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT");
+        entry.stored_at = CacheEntry::now();
+        entry.fresh_seconds = 300;
+
+        const std::string text = entry.response->to_string();
+        const std::string binary = entry.serialize();
+        int iterations = size >= 1024 * 1024 ? 200 : 5000;
+
+        // Each iteration starts from a fresh copy, as a Redis reply would be
+        double text_ns = ns_per_op(iterations, [&]() {
+            std::string data = text;
+            parse_text_entry(data);
+        });
+        double view_ns = ns_per_op(iterations, [&]() {
+            CacheEntryView view;
+            CacheEntry::decode(binary, view);
+        });
+        double binary_ns = ns_per_op(iterations, [&]() {
+            std::string data = binary;
+            CacheEntry restored;
+            CacheEntry::deserialize(std::move(data), restored);
+        });
+
+        std::cout << size << "\t" << text_ns << "\t" << view_ns << "\t" << binary_ns << std::endl;
+    }
+
+    return 0;
+}
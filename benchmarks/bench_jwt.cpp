@@ -0,0 +1,134 @@
+// JWT signature check cost: previous BIO base64 / one-shot HMAC path vs table base64url and reused HMAC context
+#include "../src/security/base64url.h"
+#include "../src/security/hmacSigner.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <openssl/bio.h>
+#include <openssl/buffer.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+namespace {
+    // The encoding previously done by Authentication::base64_url_encode
+    std::string bio_base64_url_encode(const std::string& input) {
+        BIO* bmem = BIO_new(BIO_s_mem());
+        BIO* b64 = BIO_new(BIO_f_base64());
+        BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
+        bmem = BIO_push(b64, bmem);
+
+        BIO_write(bmem, input.c_str(), input.length());
+        BIO_flush(bmem);
+
+        BUF_MEM* bptr;
+        BIO_get_mem_ptr(bmem, &bptr);
+        std::string result(bptr->data, bptr->length);
+        BIO_free_all(bmem);
+
+        std::replace(result.begin(), result.end(), '+', '-');
+        std::replace(result.begin(), result.end(), '/', '_');
+        while (!result.empty() && result.back() == '=') {
+            result.pop_back();
+        }
+        return result;
+    }
+
+    // The decoding previously done by Authentication::base64_url_decode
+    std::string bio_base64_url_decode(const std::string& input) {
+        std::string base64 = input;
+        std::replace(base64.begin(), base64.end(), '-', '+');
+        std::replace(base64.begin(), base64.end(), '_', '/');
+        switch (base64.size() % 4) {
+            case 2: base64 += "=="; break;
+            case 3: base64 += "="; break;
+            default: break;
+        }
+
+        BIO* b64 = BIO_new(BIO_f_base64());
+        BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
+        BIO* bmem = BIO_new_mem_buf(base64.c_str(), base64.length());
+        bmem = BIO_push(b64, bmem);
+
+        std::vector<char> buffer(base64.size());
+        int decoded_size = BIO_read(bmem, buffer.data(), buffer.size());
+        BIO_free_all(bmem);
+        return std::string(buffer.data(), std::max(decoded_size, 0));
+    }
+
+    // The signature check previously done by Authentication::verify_jwt
+    bool previous_verify(const std::string& token, const std::string& secret, std::string& payload) {
+        size_t first_dot = token.find('.');
+        size_t second_dot = token.find('.', first_dot + 1);
+        std::string header_b64 = token.substr(0, first_dot);
+        std::string payload_b64 = token.substr(first_dot + 1, second_dot - first_dot - 1);
+        std::string signature_b64 = token.substr(second_dot + 1);
+        std::string data_to_sign = header_b64 + "." + payload_b64;
+
+        unsigned char hmac[EVP_MAX_MD_SIZE];
+        unsigned int hmac_len;
+        HMAC(EVP_sha256(), secret.c_str(), secret.length(),
+             reinterpret_cast<const unsigned char*>(data_to_sign.c_str()), data_to_sign.length(), hmac, &hmac_len);
+
+        if (bio_base64_url_encode(std::string(reinterpret_cast<char*>(hmac), hmac_len)) != signature_b64) {
+            return false;
+        }
+        payload = bio_base64_url_decode(payload_b64);
+        return true;
+    }
+
+    // The signature check now done by Authentication::verify_jwt
+    bool current_verify(const std::string& token, const HmacSigner& signer, std::string& payload) {
+        std::string_view view(token);
+        size_t first_dot = view.find('.');
+        size_t second_dot = view.find('.', first_dot + 1);
+
+        unsigned char signature[HmacSigner::MAC_SIZE];
+        long size = Base64Url::decode(view.substr(second_dot + 1), signature, sizeof(signature));
+        if (size < 0 || !signer.verify(view.substr(0, second_dot), signature, static_cast<size_t>(size))) {
+            return false;
+        }
+        return Base64Url::decode(view.substr(first_dot + 1, second_dot - first_dot - 1), payload);
+    }
+
+    template <typename Fn>
+    double ns_per_op(int iterations, Fn fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+}
+
+int main() {
+    const std::string secret = "benchmark_jwt_secret";
+    const size_t payload_sizes[] = {64, 512, 4096};
+    const int iterations = 200000;
+    HmacSigner signer(secret);
+
+    std::cout << "payload\tprevious\tcurrent (ns/op)" << std::endl;
+    for (size_t payload_size : payload_sizes) {
+        std::string payload_json = "{\"sub\":\"" + std::string(payload_size, 'u') + "\",\"exp\":4102444800}";
+        std::string signed_part = Base64Url::encode("{\"alg\":\"HS256\",\"typ\":\"JWT\"}") + "." +
+                                  Base64Url::encode(payload_json);
+        unsigned char mac[HmacSigner::MAC_SIZE];
+        signer.sign(signed_part, mac);
+        const std::string token = signed_part + "." + Base64Url::encode(mac, sizeof(mac));
+
+        std::string payload;
+        if (!previous_verify(token, secret, payload) || !current_verify(token, signer, payload) ||
+            payload != payload_json) {
+            std::cerr << "verification mismatch" << std::endl;
+            return 1;
+        }
+
+        double previous_ns = ns_per_op(iterations, [&]() { previous_verify(token, secret, payload); });
+        double current_ns = ns_per_op(iterations, [&]() { current_verify(token, signer, payload); });
+
+        std::cout << payload_size << "\t" << previous_ns << "\t" << current_ns << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "admissionPolicy.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+    const uint64_t ROW_SEEDS[] = {
+        0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL
+    };
+
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    uint64_t key_hash(const std::string& key) {
+        return static_cast<uint64_t>(std::hash<std::string>()(key));
+    }
+}
+
+AdmissionPolicy::AdmissionPolicy(size_t width, int min_frequency, size_t max_object_bytes, size_t size_step)
+    : width_(16), min_frequency_(std::max(1, std::min(min_frequency, MAX_COUNT))),
+      max_object_bytes_(max_object_bytes), size_step_(std::max<size_t>(size_step, 1)) {
+    while (width_ < width) {
+        width_ <<= 1;
+    }
+    sample_size_ = width_ * 10;
+    table_.assign(ROWS * width_ / 16, 0);
+}
+
+size_t AdmissionPolicy::index(uint64_t hash, int row) const {
+    return mix(hash + ROW_SEEDS[row]) & (width_ - 1);
+}
+
+int AdmissionPolicy::counter(size_t row_index, int row) const {
+    size_t position = row * width_ + row_index;
+    return static_cast<int>((table_[position / 16] >> ((position % 16) * 4)) & 0xf);
+}
+
+void AdmissionPolicy::set_counter(size_t row_index, int row, int value) {
+    size_t position = row * width_ + row_index;
+    int shift = static_cast<int>((position % 16) * 4);
+    uint64_t& word = table_[position / 16];
+    word = (word & ~(0xfULL << shift)) | (static_cast<uint64_t>(value) << shift);
+}
+
+int AdmissionPolicy::estimate(uint64_t hash) const {
+    int min_count = MAX_COUNT;
+    for (int row = 0; row < ROWS; ++row) {
+        min_count = std::min(min_count, counter(index(hash, row), row));
+    }
+    return min_count;
+}
+
+void AdmissionPolicy::record(const std::string& key) {
+    uint64_t hash = key_hash(key);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Conservative update: only the smallest counters grow, which keeps
+    // collisions from inflating the estimate of other keys
+    int current = estimate(hash);
+    if (current < MAX_COUNT) {
+        for (int row = 0; row < ROWS; ++row) {
+            size_t i = index(hash, row);
+            if (counter(i, row) == current) {
+                set_counter(i, row, current + 1);
+            }
+        }
+    }
+
+    if (++additions_ >= sample_size_) {
+        age();
+    }
+}
+
+int AdmissionPolicy::frequency(const std::string& key) const {
+    uint64_t hash = key_hash(key);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return estimate(hash);
+}
+
+bool AdmissionPolicy::admit(const std::string& key, size_t size) const {
+    if (size > max_object_bytes_) {
+        return false;
+    }
+
+    // One more request is required per doubling above the size step
+    int required = min_frequency_;
+    for (size_t step = size_step_; size > step && required < MAX_COUNT; step <<= 1) {
+        ++required;
+    }
+
+    return frequency(key) >= required;
+}
+
+void AdmissionPolicy::age() {
+    for (auto& word : table_) {
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions_ /= 2;
+}
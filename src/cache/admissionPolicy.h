@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Admission Policy class
+ * TinyLFU-style filter deciding whether a response is worth storing.
+ *
+ * Request frequencies are estimated with a count-min sketch of 4-bit
+ * counters (four rows, conservative update) that is aged by halving every
+ * counter once the number of recorded accesses reaches ten times its
+ * width, so popularity from long ago fades out. A response is admitted
+ * once its key has been requested min_frequency times; objects larger
+ * than size_step bytes need one more request per doubling of their size,
+ * and objects over max_object_bytes are never admitted.
+ */
+class AdmissionPolicy {
+public:
+    /**
+     * Constructor
+     * @param width Counters per sketch row, rounded up to a power of two
+     * @param min_frequency Requests needed before a small object is admitted
+     * @param max_object_bytes Largest body size that may be admitted
+     * @param size_step Size above which admission gets stricter
+     */
+    AdmissionPolicy(size_t width, int min_frequency, size_t max_object_bytes, size_t size_step = 64 * 1024);
+
+    /**
+     * Count a request for a key
+     * @param key Cache key
+     */
+    void record(const std::string& key);
+
+    /**
+     * Estimate how often a key was requested recently
+     * @param key Cache key
+     * @return Estimated frequency, at most 15
+     */
+    int frequency(const std::string& key) const;
+
+    /**
+     * Decide whether a response should be stored
+     * @param key Cache key
+     * @param size Body size in bytes
+     * @return True if the object is popular enough for its size
+     */
+    bool admit(const std::string& key, size_t size) const;
+
+private:
+    static constexpr int ROWS = 4;
+    static constexpr int MAX_COUNT = 15;
+
+    size_t width_;             // counters per row, a power of two
+    int min_frequency_;
+    size_t max_object_bytes_;
+    size_t size_step_;
+    size_t sample_size_;       // accesses between two agings
+    size_t additions_ = 0;     // accesses since the last aging
+
+    mutable std::mutex mutex_;
+    std::vector<uint64_t> table_;  // ROWS rows of width_ 4-bit counters, 16 per word
+
+    /**
+     * Position of a key's counter in a row
+     */
+    size_t index(uint64_t hash, int row) const;
+
+    int counter(size_t row_index, int row) const;
+    void set_counter(size_t row_index, int row, int value);
+    int estimate(uint64_t hash) const;
+
+    /**
+     * Halve every counter
+     */
+    void age();
+};
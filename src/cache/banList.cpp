@@ -0,0 +1,106 @@
+#include "banList.h"
+#include "cacheEntry.h"
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+
+std::string Ban::encode() const {
+    return std::to_string(created_at) + " " + std::to_string(expires_at) + " " +
+           (prefix ? "prefix " : "exact ") + pattern;
+}
+
+bool Ban::decode(const std::string& line, Ban& ban) {
+    std::istringstream stream(line);
+    std::string type;
+    if (!(stream >> ban.created_at >> ban.expires_at >> type) || (type != "prefix" && type != "exact")) {
+        return false;
+    }
+    ban.prefix = type == "prefix";
+
+    // The pattern is the rest of the line after a single space
+    stream.get();
+    std::getline(stream, ban.pattern);
+    return !ban.pattern.empty();
+}
+
+void BanList::add(const Ban& ban) {
+    long long now = CacheEntry::now();
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (next_expiry_ != 0 && next_expiry_ <= now) {
+        prune(now);
+    }
+
+    BanTimes* times;
+    if (ban.prefix) {
+        auto inserted = prefixes_.try_emplace(ban.pattern);
+        if (inserted.second) {
+            ++prefix_lengths_[ban.pattern.size()];
+        }
+        times = &inserted.first->second;
+    } else {
+        times = &exact_[ban.pattern];
+    }
+
+    // Only the newest ban of a pattern matters
+    times->created_at = std::max(times->created_at, ban.created_at);
+    times->expires_at = std::max(times->expires_at, ban.expires_at);
+    if (next_expiry_ == 0 || times->expires_at < next_expiry_) {
+        next_expiry_ = times->expires_at;
+    }
+}
+
+void BanList::prune(long long now) {
+    next_expiry_ = 0;
+    auto keep = [this, now](const BanTimes& times) {
+        if (times.expires_at <= now) {
+            return false;
+        }
+        if (next_expiry_ == 0 || times.expires_at < next_expiry_) {
+            next_expiry_ = times.expires_at;
+        }
+        return true;
+    };
+
+    for (auto it = exact_.begin(); it != exact_.end();) {
+        it = keep(it->second) ? std::next(it) : exact_.erase(it);
+    }
+    for (auto it = prefixes_.begin(); it != prefixes_.end();) {
+        if (keep(it->second)) {
+            ++it;
+            continue;
+        }
+        auto length = prefix_lengths_.find(it->first.size());
+        if (--length->second == 0) {
+            prefix_lengths_.erase(length);
+        }
+        it = prefixes_.erase(it);
+    }
+}
+
+bool BanList::is_banned(const std::string& uri, long long stored_at) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto exact = exact_.find(uri);
+    if (exact != exact_.end() && stored_at <= exact->second.created_at) {
+        return true;
+    }
+
+    // One probe per distinct prefix length that fits the URI
+    std::string_view view(uri);
+    for (const auto& length : prefix_lengths_) {
+        if (length.first > view.size()) {
+            break;
+        }
+        auto prefix = prefixes_.find(view.substr(0, length.first));
+        if (prefix != prefixes_.end() && stored_at <= prefix->second.created_at) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t BanList::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return exact_.size() + prefixes_.size();
+}
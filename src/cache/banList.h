@@ -0,0 +1,86 @@
+#pragma once
+
+#include <shared_mutex>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+/**
+ * A cache ban
+ * Invalidates every entry for a URI (or URI prefix) stored before the ban
+ */
+struct Ban {
+    bool prefix = false;       // match URIs starting with pattern instead of equal to it
+    std::string pattern;
+    long long created_at = 0;  // entries stored at or before this time are banned
+    long long expires_at = 0;  // when no banned entry can be left in the cache
+
+    /**
+     * Encode the ban as a single line for storage
+     */
+    std::string encode() const;
+
+    /**
+     * Decode a ban encoded with encode()
+     * @param line Encoded ban
+     * @param ban Output ban
+     * @return False if the line is malformed
+     */
+    static bool decode(const std::string& line, Ban& ban);
+};
+
+/**
+ * Ban List class
+ * Bans are evaluated lazily when an entry is looked up, so invalidating
+ * any number of entries costs a single insertion instead of a scan over
+ * the cache.
+ *
+ * Exact bans are kept in a hash map from URI to the newest ban, and
+ * prefix bans in a sorted map probed once per distinct prefix length, so
+ * a lookup stays cheap with thousands of bans. Bans are dropped once they
+ * expire, which is ban_ttl_seconds after they were made.
+ *
+ * The list lives in this process. Bans are also appended to Redis, but
+ * other proxies sharing that Redis only pick them up when they start.
+ */
+class BanList {
+public:
+    /**
+     * Add a ban, dropping bans that have expired
+     * @param ban The ban
+     */
+    void add(const Ban& ban);
+
+    /**
+     * Check if an entry has been banned
+     * @param uri Request URI the entry was stored for
+     * @param stored_at When the entry was stored
+     * @return True if a ban created after the entry matches its URI
+     */
+    bool is_banned(const std::string& uri, long long stored_at) const;
+
+    /**
+     * Number of active bans, counting each pattern once
+     */
+    size_t size() const;
+
+private:
+    /**
+     * Newest ban for a pattern
+     */
+    struct BanTimes {
+        long long created_at = 0;
+        long long expires_at = 0;
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, BanTimes> exact_;           // URI -> newest ban
+    std::map<std::string, BanTimes, std::less<>> prefixes_;     // prefix -> newest ban
+    std::map<size_t, size_t> prefix_lengths_;                   // prefix length -> number of prefixes
+    long long next_expiry_ = 0;                                 // earliest expires_at of any ban
+
+    /**
+     * Drop expired bans, called with the lock held
+     */
+    void prune(long long now);
+};
@@ -0,0 +1,75 @@
+#include "cacheControl.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+    std::string trim(const std::string& value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
+
+    int parse_seconds(const std::string& value) {
+        std::string digits = value;
+        // Quoted values are tolerated, e.g. max-age="60"
+        digits.erase(std::remove(digits.begin(), digits.end(), '"'), digits.end());
+        if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+            return -1;
+        }
+        return std::atoi(digits.c_str());
+    }
+}
+
+CacheControl CacheControl::parse(const std::string& value) {
+    CacheControl cc;
+
+    size_t pos = 0;
+    while (pos <= value.size()) {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = value.size();
+        }
+
+        std::string directive = trim(value.substr(pos, comma - pos));
+        pos = comma + 1;
+        if (directive.empty()) {
+            continue;
+        }
+
+        // Split "name=value" and compare names case-insensitively
+        std::string name = directive;
+        std::string argument;
+        size_t eq = directive.find('=');
+        if (eq != std::string::npos) {
+            name = trim(directive.substr(0, eq));
+            argument = trim(directive.substr(eq + 1));
+        }
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+        if (name == "no-store") {
+            cc.no_store = true;
+        } else if (name == "no-cache") {
+            cc.no_cache = true;
+        } else if (name == "private") {
+            cc.is_private = true;
+        } else if (name == "max-age") {
+            cc.max_age = parse_seconds(argument);
+        } else if (name == "s-maxage") {
+            cc.s_maxage = parse_seconds(argument);
+        } else if (name == "stale-while-revalidate") {
+            cc.stale_while_revalidate = parse_seconds(argument);
+        } else if (name == "stale-if-error") {
+            cc.stale_if_error = parse_seconds(argument);
+        }
+    }
+
+    return cc;
+}
+
+bool CacheControl::is_storable() const {
+    return !no_store && !no_cache && !is_private;
+}
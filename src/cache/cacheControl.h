@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Cache-Control header
+ * Parsed form of the directives the proxy cache cares about
+ */
+struct CacheControl {
+    bool no_store = false;
+    bool no_cache = false;
+    bool is_private = false;
+    int max_age = -1;                  // -1 when the directive is absent
+    int s_maxage = -1;
+    int stale_while_revalidate = -1;
+    int stale_if_error = -1;
+
+    /**
+     * Parse a Cache-Control header value
+     * @param value Header value, e.g. "max-age=60, stale-while-revalidate=30"
+     * @return Parsed directives
+     */
+    static CacheControl parse(const std::string& value);
+
+    /**
+     * Check if a response with these directives may be stored by a shared cache
+     * @return True if the response is storable
+     */
+    bool is_storable() const;
+};
@@ -0,0 +1,238 @@
+#include "cacheEntry.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    const uint8_t EXT_URI = 1;
+
+    void put_u8(std::string& out, uint8_t value) {
+        out.push_back(static_cast<char>(value));
+    }
+
+    void put_u16(std::string& out, uint16_t value) {
+        for (int i = 0; i < 2; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void put_u32(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    void put_u64(std::string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    /**
+     * Bounds-checked little-endian reader over a byte range
+     */
+    class Reader {
+    public:
+        explicit Reader(std::string_view data) : data_(data), pos_(0), ok_(true) {}
+
+        uint64_t uint(size_t bytes) {
+            if (!need(bytes)) {
+                return 0;
+            }
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
+            }
+            pos_ += bytes;
+            return value;
+        }
+
+        std::string_view bytes(size_t length) {
+            if (!need(length)) {
+                return std::string_view();
+            }
+            std::string_view view = data_.substr(pos_, length);
+            pos_ += length;
+            return view;
+        }
+
+        bool at_end() const { return pos_ == data_.size(); }
+        bool ok() const { return ok_; }
+
+    private:
+        std::string_view data_;
+        size_t pos_;
+        bool ok_;
+
+        bool need(size_t length) {
+            if (!ok_ || data_.size() - pos_ < length) {
+                ok_ = false;
+            }
+            return ok_;
+        }
+    };
+}
+
+long long CacheEntry::now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+long long CacheEntry::age(long long now) const {
+    return std::max(0LL, now - stored_at);
+}
+
+bool CacheEntry::is_fresh(long long now) const {
+    return age(now) < fresh_seconds;
+}
+
+bool CacheEntry::is_stale_while_revalidate(long long now) const {
+    return age(now) < static_cast<long long>(fresh_seconds) + stale_while_revalidate_seconds;
+}
+
+bool CacheEntry::is_stale_if_error(long long now) const {
+    return age(now) < static_cast<long long>(fresh_seconds) + stale_if_error_seconds;
+}
+
+int CacheEntry::grace_seconds() const {
+    return std::max(stale_while_revalidate_seconds, stale_if_error_seconds);
+}
+
+std::string CacheEntry::serialize() const {
+    std::string_view body = response->body_view();
+    const auto& headers = response->headers();
+
+    // Size everything up front so the body is copied exactly once
+    size_t head_size = 2 + 8 + 4 + 4 + 4 + 2;
+    for (const auto& header : headers) {
+        head_size += 2 + header.first.size() + 4 + header.second.size();
+    }
+    if (!uri.empty()) {
+        head_size += 1 + 4 + uri.size();
+    }
+
+    std::string out;
+    out.reserve(body.size() + head_size + TRAILER_SIZE);
+    out.append(body);
+
+    put_u16(out, static_cast<uint16_t>(response->status_code()));
+    put_u64(out, static_cast<uint64_t>(stored_at));
+    put_u32(out, static_cast<uint32_t>(fresh_seconds));
+    put_u32(out, static_cast<uint32_t>(stale_while_revalidate_seconds));
+    put_u32(out, static_cast<uint32_t>(stale_if_error_seconds));
+
+    put_u16(out, static_cast<uint16_t>(headers.size()));
+    for (const auto& header : headers) {
+        put_u16(out, static_cast<uint16_t>(header.first.size()));
+        out.append(header.first);
+        put_u32(out, static_cast<uint32_t>(header.second.size()));
+        out.append(header.second);
+    }
+
+    if (!uri.empty()) {
+        put_u8(out, EXT_URI);
+        put_u32(out, static_cast<uint32_t>(uri.size()));
+        out.append(uri);
+    }
+
+    put_u32(out, static_cast<uint32_t>(out.size() - body.size()));
+    put_u64(out, body.size());
+    put_u16(out, VERSION);
+    put_u16(out, 0);
+    put_u32(out, MAGIC);
+
+    return out;
+}
+
+bool CacheEntry::decode(std::string_view data, CacheEntryView& view) {
+    uint64_t body_length = 0;
+    uint64_t head_length = 0;
+    if (!decode_head(data, view, body_length, head_length) ||
+        head_length + body_length + TRAILER_SIZE != data.size()) {
+        return false;
+    }
+
+    view.body = data.substr(0, body_length);
+    return true;
+}
+
+bool CacheEntry::decode_head(std::string_view tail, CacheEntryView& view,
+                             uint64_t& body_length, uint64_t& head_length) {
+    head_length = 0;
+    if (tail.size() < TRAILER_SIZE) {
+        return false;
+    }
+
+    Reader trailer(tail.substr(tail.size() - TRAILER_SIZE));
+    uint64_t head_len = trailer.uint(4);
+    uint64_t body_len = trailer.uint(8);
+    uint16_t version = static_cast<uint16_t>(trailer.uint(2));
+    trailer.uint(2);  // flags, none defined yet
+    uint32_t magic = static_cast<uint32_t>(trailer.uint(4));
+
+    if (magic != MAGIC || version != VERSION) {
+        return false;
+    }
+
+    // Report the head size even if the tail is too short, so the caller can read more
+    head_length = head_len;
+    body_length = body_len;
+    if (head_len + TRAILER_SIZE > tail.size()) {
+        return false;
+    }
+
+    view.body = std::string_view();
+
+    Reader head(tail.substr(tail.size() - TRAILER_SIZE - head_len, head_len));
+    view.status = static_cast<int>(head.uint(2));
+    view.stored_at = static_cast<long long>(head.uint(8));
+    view.fresh_seconds = static_cast<int>(head.uint(4));
+    view.stale_while_revalidate_seconds = static_cast<int>(head.uint(4));
+    view.stale_if_error_seconds = static_cast<int>(head.uint(4));
+
+    size_t header_count = head.uint(2);
+    view.headers.clear();
+    view.headers.reserve(header_count);
+    for (size_t i = 0; i < header_count && head.ok(); ++i) {
+        std::string_view name = head.bytes(head.uint(2));
+        std::string_view value = head.bytes(head.uint(4));
+        view.headers.emplace_back(name, value);
+    }
+
+    // Extension fields, skipped when unknown
+    view.uri = std::string_view();
+    while (head.ok() && !head.at_end()) {
+        uint8_t tag = static_cast<uint8_t>(head.uint(1));
+        std::string_view value = head.bytes(head.uint(4));
+        if (tag == EXT_URI) {
+            view.uri = value;
+        }
+    }
+
+    return head.ok();
+}
+
+bool CacheEntry::deserialize(std::string&& data, CacheEntry& entry) {
+    CacheEntryView view;
+    if (!decode(data, view)) {
+        return false;
+    }
+
+    auto response = std::make_shared<HttpResponse>(static_cast<HttpStatus>(view.status));
+    for (const auto& header : view.headers) {
+        response->set_header(std::string(header.first), std::string(header.second));
+    }
+
+    entry.stored_at = view.stored_at;
+    entry.fresh_seconds = view.fresh_seconds;
+    entry.stale_while_revalidate_seconds = view.stale_while_revalidate_seconds;
+    entry.stale_if_error_seconds = view.stale_if_error_seconds;
+    entry.uri = std::string(view.uri);
+
+    // The body is at the front of the buffer, truncate and hand the buffer over
+    std::string content_type = response->get_header("Content-Type", "text/plain");
+    data.resize(view.body.size());
+    response->set_body(std::move(data), content_type);
+
+    entry.response = response;
+    return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../http/ResponseHandler.h"
+
+/**
+ * Decoded view of a serialized cache entry
+ * All string views point into the serialized buffer, nothing is copied
+ */
+struct CacheEntryView {
+    int status = 0;
+    long long stored_at = 0;
+    int fresh_seconds = 0;
+    int stale_while_revalidate_seconds = 0;
+    int stale_if_error_seconds = 0;
+    std::vector<std::pair<std::string_view, std::string_view>> headers;
+    std::string_view body;
+    std::string_view uri;
+};
+
+/**
+ * Cache Entry
+ * A cached response together with the metadata needed to decide whether
+ * it is fresh, may be served stale, or must be refetched.
+ *
+ * Entries are stored in a versioned, length-prefixed binary format. The
+ * body comes first and the fixed-size trailer last, so that a decoder can
+ * locate everything from the end of the buffer and hand the body over by
+ * truncating the buffer instead of copying it:
+ *
+ *   [body][head][trailer]
+ *   head:    status u16, stored_at i64, fresh u32, swr u32, sie u32,
+ *            header count u16, (name len u16, name, value len u32, value)*,
+ *            (tag u8, len u32, value)* extension fields
+ *   trailer: head len u32, body len u64, version u16, flags u16, magic u32
+ *
+ * Validators (ETag, Last-Modified) travel in the header table. All integers
+ * are little-endian. Extension fields:
+ *   1  request URI the entry was stored for (used by bans)
+ */
+struct CacheEntry {
+    HttpResponsePtr response;
+    long long stored_at = 0;                 // Unix time the response was stored
+    int fresh_seconds = 0;                   // How long the response is fresh
+    int stale_while_revalidate_seconds = 0;  // Grace period served stale while refreshing
+    int stale_if_error_seconds = 0;          // Grace period served stale on upstream errors
+    std::string uri;                         // Request URI the response was stored for
+
+    static const uint32_t MAGIC = 0x45435052;  // "RPCE"
+    static const uint16_t VERSION = 1;
+    static const size_t TRAILER_SIZE = 20;
+
+    /**
+     * Current Unix time in seconds
+     */
+    static long long now();
+
+    /**
+     * Age of the entry
+     * @param now Current Unix time
+     * @return Seconds since the entry was stored
+     */
+    long long age(long long now) const;
+
+    /**
+     * Check if the entry can be served without revalidation
+     */
+    bool is_fresh(long long now) const;
+
+    /**
+     * Check if the entry can be served while it is refreshed in the background
+     */
+    bool is_stale_while_revalidate(long long now) const;
+
+    /**
+     * Check if the entry can be served when the upstream fails
+     */
+    bool is_stale_if_error(long long now) const;
+
+    /**
+     * How long the entry must be kept in storage past its freshness
+     */
+    int grace_seconds() const;
+
+    /**
+     * Serialize the entry for storage
+     * @return Serialized entry
+     */
+    std::string serialize() const;
+
+    /**
+     * Decode a serialized entry without copying anything
+     * @param data Serialized entry
+     * @param view Output view into data
+     * @return False if the data is malformed or of an unknown version
+     */
+    static bool decode(std::string_view data, CacheEntryView& view);
+
+    /**
+     * Decode the status, metadata and headers from the end of a serialized entry
+     * Used to read a large entry piecewise without fetching its body
+     * @param tail The last bytes of a serialized entry
+     * @param view Output view into tail, with an empty body
+     * @param body_length Output size of the body
+     * @param head_length Output size of the head, set as soon as the trailer is valid
+     * @return False if the data is malformed or tail is shorter than head and trailer
+     */
+    static bool decode_head(std::string_view tail, CacheEntryView& view,
+                            uint64_t& body_length, uint64_t& head_length);
+
+    /**
+     * Restore an entry from its serialized form
+     * The buffer is consumed: its storage becomes the response body
+     * @param data Serialized entry
+     * @param entry Output entry
+     * @return False if the data is malformed
+     */
+    static bool deserialize(std::string&& data, CacheEntry& entry);
+};
@@ -0,0 +1,165 @@
+#include "cacheKey.h"
+#include <algorithm>
+#include <cctype>
+#include <openssl/sha.h>
+
+namespace {
+    std::string trim(const std::string& value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
+
+    /**
+     * Match a parameter name against a list entry, a trailing '*' matches any suffix
+     */
+    bool matches(const std::string& name, const std::vector<std::string>& patterns) {
+        for (const auto& pattern : patterns) {
+            if (!pattern.empty() && pattern.back() == '*') {
+                if (name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0) {
+                    return true;
+                }
+            } else if (name == pattern) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+namespace CacheKey {
+    std::string normalize_query(const std::string& query, const RouteConfig& route) {
+        std::vector<std::pair<std::string, std::string>> params;
+
+        size_t pos = 0;
+        while (pos < query.size()) {
+            size_t amp = query.find('&', pos);
+            if (amp == std::string::npos) {
+                amp = query.size();
+            }
+
+            std::string param = query.substr(pos, amp - pos);
+            pos = amp + 1;
+            if (param.empty()) {
+                continue;
+            }
+
+            size_t eq = param.find('=');
+            std::string name = param.substr(0, eq);
+            if (!route.cache_key_query_allowlist.empty() && !matches(name, route.cache_key_query_allowlist)) {
+                continue;
+            }
+            if (matches(name, route.cache_key_query_denylist)) {
+                continue;
+            }
+            params.emplace_back(name, eq == std::string::npos ? "" : param.substr(eq));
+        }
+
+        // Stable, so repeated parameters keep their relative order
+        if (route.cache_key_sort_query) {
+            std::stable_sort(params.begin(), params.end(),
+                [](const auto& a, const auto& b) { return a.first < b.first; });
+        }
+
+        std::string normalized;
+        for (const auto& param : params) {
+            if (!normalized.empty()) {
+                normalized += '&';
+            }
+            normalized += param.first;
+            normalized += param.second;
+        }
+        return normalized;
+    }
+
+    std::string primary(const HttpRequest& request, const RouteConfig& route) {
+        std::string key = request.method() + " " + request.path();
+
+        std::string query = normalize_query(request.query_string(), route);
+        if (!query.empty()) {
+            key += "?" + query;
+        }
+
+        // Claim-restricted routes may share a prefix with a route that has no restriction
+        if (!route.match_claims.empty()) {
+            key += "\n@" + route.route_id;
+        }
+
+        for (const auto& name : route.cache_key_headers) {
+            key += "\n" + name + ": " + request.get_header(name);
+        }
+        return key;
+    }
+
+    bool parse_vary(const std::string& vary, std::vector<std::string>& names) {
+        names.clear();
+
+        size_t pos = 0;
+        while (pos <= vary.size()) {
+            size_t comma = vary.find(',', pos);
+            if (comma == std::string::npos) {
+                comma = vary.size();
+            }
+
+            std::string name = trim(vary.substr(pos, comma - pos));
+            pos = comma + 1;
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+            if (name == "*") {
+                return false;
+            }
+            if (name.empty() || name == "accept-encoding") {
+                continue;
+            }
+            if (std::find(names.begin(), names.end(), name) == names.end()) {
+                names.push_back(name);
+            }
+        }
+
+        std::sort(names.begin(), names.end());
+        return true;
+    }
+
+    std::string hash(const std::string& key) {
+        static const char hex[] = "0123456789abcdef";
+
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const unsigned char*>(key.data()), key.size(), digest);
+
+        std::string out = "cache:";
+        for (int i = 0; i < 16; ++i) {
+            out.push_back(hex[digest[i] >> 4]);
+            out.push_back(hex[digest[i] & 0x0f]);
+        }
+        return out;
+    }
+}
+
+VaryIndex::VaryIndex(size_t max_entries) : max_entries_(max_entries) {
+}
+
+std::vector<std::string> VaryIndex::lookup(const std::string& primary) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(primary);
+    if (it == entries_.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+void VaryIndex::update(const std::string& primary, const std::vector<std::string>& names) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (names.empty()) {
+        entries_.erase(primary);
+        return;
+    }
+
+    // Forgetting is safe, varied resources just miss until they are stored again
+    if (entries_.size() >= max_entries_ && entries_.find(primary) == entries_.end()) {
+        entries_.clear();
+    }
+    entries_[primary] = names;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../http/RequestHandler.h"
+#include "../http/ResponseHandler.h"
+#include "../config/Config.h"
+
+/**
+ * Cache key helpers
+ * Builds normalized, fixed-width cache keys from a request and its route's
+ * cache key options (query sorting, allow/deny lists, selected headers).
+ */
+namespace CacheKey {
+    /**
+     * Build the normalized, unhashed key of a request
+     * @param request The request
+     * @param route The matched route
+     * @return Method, path, normalized query, the route of claim-restricted routes
+     *         and selected header values
+     */
+    std::string primary(const HttpRequest& request, const RouteConfig& route);
+
+    /**
+     * Normalize a query string according to the route's options
+     * @param query Raw query string without the leading '?'
+     * @param route The matched route
+     * @return Filtered (and optionally sorted) query string
+     */
+    std::string normalize_query(const std::string& query, const RouteConfig& route);
+
+    /**
+     * Parse the header names listed in a response's Vary header
+     * Accept-Encoding is left out, encodings are cached as separate variants
+     * @param vary Value of the Vary header
+     * @param names Lowercase header names
+     * @return False if the response varies on everything ("*")
+     */
+    bool parse_vary(const std::string& vary, std::vector<std::string>& names);
+
+    /**
+     * Hash a normalized key to a fixed-width Redis key
+     * @param key Normalized key
+     * @return "cache:" followed by 32 hex digits of its SHA-256
+     */
+    std::string hash(const std::string& key);
+}
+
+/**
+ * Vary index
+ * Remembers which request headers a cached resource varies on, so that
+ * lookups can include the right header values in the key. Responses with
+ * a Vary header are only stored under the varied key, so a resource whose
+ * Vary is not known yet simply misses.
+ */
+class VaryIndex {
+public:
+    /**
+     * @param max_entries Number of resources to remember before starting over
+     */
+    explicit VaryIndex(size_t max_entries = 100000);
+
+    /**
+     * Get the header names a resource varies on
+     * @param primary Normalized key of the resource
+     * @return Header names, empty if the resource does not vary
+     */
+    std::vector<std::string> lookup(const std::string& primary) const;
+
+    /**
+     * Record the header names a resource varies on
+     * @param primary Normalized key of the resource
+     * @param names Header names from the response's Vary header
+     */
+    void update(const std::string& primary, const std::vector<std::string>& names);
+
+private:
+    size_t max_entries_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<std::string>> entries_;  // primary key -> Vary header names
+};
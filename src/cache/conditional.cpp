@@ -0,0 +1,135 @@
+#include "conditional.h"
+#include "../http/HttpDate.h"
+
+namespace {
+    // Headers a 304 carries and that refresh the stored response
+    const char* const NOT_MODIFIED_HEADERS[] = {
+        "ETag", "Last-Modified", "Cache-Control", "Expires", "Vary", "Content-Location", "Date"
+    };
+
+    std::string trim(const std::string& value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
+
+    // Weak comparison, W/"x" and "x" match each other
+    std::string opaque_tag(const std::string& etag) {
+        if (etag.compare(0, 2, "W/") == 0) {
+            return etag.substr(2);
+        }
+        return etag;
+    }
+
+    bool etag_list_matches(const std::string& if_none_match, const std::string& etag) {
+        std::string tag = opaque_tag(trim(etag));
+
+        size_t pos = 0;
+        while (pos <= if_none_match.size()) {
+            size_t comma = if_none_match.find(',', pos);
+            if (comma == std::string::npos) {
+                comma = if_none_match.size();
+            }
+
+            std::string candidate = trim(if_none_match.substr(pos, comma - pos));
+            if (candidate == "*" || (!candidate.empty() && opaque_tag(candidate) == tag)) {
+                return true;
+            }
+            pos = comma + 1;
+        }
+        return false;
+    }
+}
+
+bool Conditional::has_validators(const HttpResponse& response) {
+    return !response.get_header("ETag").empty() || !response.get_header("Last-Modified").empty();
+}
+
+bool Conditional::is_not_modified(const HttpRequest& request, const HttpResponse& response) {
+    std::string if_none_match = request.get_header("If-None-Match");
+    if (!if_none_match.empty()) {
+        std::string etag = response.get_header("ETag");
+        return !etag.empty() && etag_list_matches(if_none_match, etag);
+    }
+
+    std::string if_modified_since = request.get_header("If-Modified-Since");
+    std::string last_modified = response.get_header("Last-Modified");
+    if (if_modified_since.empty() || last_modified.empty()) {
+        return false;
+    }
+
+    long long since = 0;
+    long long modified = 0;
+    if (!HttpDate::parse(if_modified_since, since) || !HttpDate::parse(last_modified, modified)) {
+        return false;
+    }
+    return modified <= since;
+}
+
+HttpResponsePtr Conditional::make_not_modified(const HttpResponse& response) {
+    auto not_modified = std::make_shared<HttpResponse>(HttpStatus::NOT_MODIFIED);
+    for (const char* name : NOT_MODIFIED_HEADERS) {
+        std::string value = response.get_header(name);
+        if (!value.empty()) {
+            not_modified->set_header(name, value);
+        }
+    }
+    return not_modified;
+}
+
+void Conditional::add_revalidation_headers(HttpRequest& request, const HttpResponse& cached) {
+    std::string etag = cached.get_header("ETag");
+    std::string last_modified = cached.get_header("Last-Modified");
+
+    if (!etag.empty()) {
+        request.set_header("If-None-Match", etag);
+    }
+    if (!last_modified.empty()) {
+        request.set_header("If-Modified-Since", last_modified);
+    }
+}
+
+void Conditional::merge_not_modified(HttpResponse& cached, const HttpResponse& not_modified) {
+    for (const char* name : NOT_MODIFIED_HEADERS) {
+        std::string value = not_modified.get_header(name);
+        if (!value.empty()) {
+            cached.set_header(name, value);
+        }
+    }
+}
+
+void Conditional::tag_variant(HttpResponse& response, const std::string& encoding) {
+    std::string etag = trim(response.get_header("ETag"));
+    if (etag.empty()) {
+        return;
+    }
+
+    size_t quote = etag.compare(0, 2, "W/") == 0 ? 2 : 0;
+    if (etag.size() < quote + 2 || etag[quote] != '"' || etag.back() != '"') {
+        response.remove_header("ETag");
+        return;
+    }
+    etag.insert(etag.size() - 1, "-" + encoding);
+    response.set_header("ETag", etag);
+}
+
+bool Conditional::if_range_matches(const HttpRequest& request, const HttpResponse& response) {
+    std::string if_range = trim(request.get_header("If-Range"));
+    if (if_range.empty()) {
+        return true;
+    }
+
+    // Entity tag: only strong validators can be used for ranges
+    if (if_range[0] == '"' || if_range.compare(0, 2, "W/") == 0) {
+        std::string etag = trim(response.get_header("ETag"));
+        return if_range[0] == '"' && !etag.empty() && etag[0] == '"' && etag == if_range;
+    }
+
+    long long since = 0;
+    long long modified = 0;
+    std::string last_modified = response.get_header("Last-Modified");
+    return HttpDate::parse(if_range, since) && HttpDate::parse(last_modified, modified) && since == modified;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../http/RequestHandler.h"
+#include "../http/ResponseHandler.h"
+
+/**
+ * Conditional request helpers
+ * Evaluation of If-None-Match / If-Modified-Since against a response's
+ * validators (ETag / Last-Modified)
+ */
+namespace Conditional {
+    /**
+     * Check if a response carries validators usable for revalidation
+     * @param response The response
+     * @return True if it has an ETag or a Last-Modified header
+     */
+    bool has_validators(const HttpResponse& response);
+
+    /**
+     * Check if a client's conditional headers match a response
+     * If-None-Match takes precedence over If-Modified-Since
+     * @param request The client request
+     * @param response The response the client would receive
+     * @return True if the client's copy is still current (304 applies)
+     */
+    bool is_not_modified(const HttpRequest& request, const HttpResponse& response);
+
+    /**
+     * Build a 304 Not Modified response for a full response
+     * @param response The full response
+     * @return Response without a body carrying the validators and caching headers
+     */
+    HttpResponsePtr make_not_modified(const HttpResponse& response);
+
+    /**
+     * Add conditional headers for revalidating a cached response upstream
+     * @param request The request to send upstream
+     * @param cached The cached response being revalidated
+     */
+    void add_revalidation_headers(HttpRequest& request, const HttpResponse& cached);
+
+    /**
+     * Merge the headers of a 304 from upstream into the cached response
+     * @param cached The cached response, updated in place
+     * @param not_modified The 304 response from upstream
+     */
+    void merge_not_modified(HttpResponse& cached, const HttpResponse& not_modified);
+
+    /**
+     * Give a content-coded variant its own entity tag
+     * "abc" becomes "abc-gzip", so a strong tag never names both the identity
+     * bytes and the encoded ones. Weakness is kept and a malformed tag is removed.
+     * @param response The encoded response, updated in place
+     * @param encoding Its content coding
+     */
+    void tag_variant(HttpResponse& response, const std::string& encoding);
+
+    /**
+     * Check if a client's If-Range still matches a response
+     * Entity tags are compared strongly and dates must equal Last-Modified
+     * @param request The client request
+     * @param response The full response
+     * @return True if there is no If-Range or it matches, so the range applies
+     */
+    bool if_range_matches(const HttpRequest& request, const HttpResponse& response);
+}
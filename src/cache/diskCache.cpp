@@ -0,0 +1,290 @@
+#include "diskCache.h"
+#include "../util/Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    void write_u32(char* out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    void write_u64(char* out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    uint64_t read_uint(const char* in, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    std::string segment_name(uint32_t id) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "segment-%08u.dat", id);
+        return name;
+    }
+}
+
+DiskCache::Segment::~Segment() {
+    if (data) {
+        munmap(data, capacity);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+DiskCache::DiskCache(const std::string& directory, size_t segment_bytes, size_t max_bytes)
+    : directory_(directory), segment_bytes_(segment_bytes),
+      max_segments_(std::max<size_t>(2, max_bytes / std::max<size_t>(segment_bytes, 1))) {
+}
+
+DiskCache::~DiskCache() {
+}
+
+bool DiskCache::open() {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec) {
+        Logger::getInstance().error("Cannot create disk cache directory " + directory_ + ": " + ec.message(), "DiskCache");
+        return false;
+    }
+
+    // Segment ids grow monotonically, so sorting them gives the write order
+    std::vector<uint32_t> ids;
+    for (const auto& file : fs::directory_iterator(directory_, ec)) {
+        unsigned int id;
+        if (std::sscanf(file.path().filename().c_str(), "segment-%08u.dat", &id) == 1) {
+            ids.push_back(id);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t id : ids) {
+        auto segment = map_segment(id, false);
+        if (!segment) {
+            continue;
+        }
+        scan_segment(segment);
+        segments_.push_back(segment);
+        next_segment_id_ = id + 1;
+    }
+
+    while (segments_.size() > max_segments_) {
+        evict_oldest();
+    }
+
+    Logger::getInstance().info("Disk cache opened with " + std::to_string(segments_.size()) + " segments and " +
+                               std::to_string(index_.size()) + " entries", "DiskCache");
+    return true;
+}
+
+std::shared_ptr<DiskCache::Segment> DiskCache::map_segment(uint32_t id, bool create) {
+    auto segment = std::make_shared<Segment>();
+    segment->id = id;
+    segment->path = directory_ + "/" + segment_name(id);
+
+    segment->fd = ::open(segment->path.c_str(), O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (segment->fd < 0) {
+        Logger::getInstance().error("Cannot open disk cache segment " + segment->path + ": " + std::strerror(errno), "DiskCache");
+        return nullptr;
+    }
+
+    if (create) {
+        if (ftruncate(segment->fd, static_cast<off_t>(segment_bytes_)) != 0) {
+            Logger::getInstance().error("Cannot size disk cache segment " + segment->path + ": " + std::strerror(errno), "DiskCache");
+            unlink(segment->path.c_str());
+            return nullptr;
+        }
+        segment->capacity = segment_bytes_;
+    } else {
+        off_t size = lseek(segment->fd, 0, SEEK_END);
+        if (size <= 0) {
+            return nullptr;
+        }
+        segment->capacity = static_cast<size_t>(size);
+    }
+
+    void* data = mmap(nullptr, segment->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    if (data == MAP_FAILED) {
+        Logger::getInstance().error("Cannot map disk cache segment " + segment->path + ": " + std::strerror(errno), "DiskCache");
+        return nullptr;
+    }
+    segment->data = static_cast<char*>(data);
+    return segment;
+}
+
+void DiskCache::scan_segment(const std::shared_ptr<Segment>& segment) {
+    long long now = CacheEntry::now();
+
+    // Only record headers are read, bodies are skipped without touching their pages
+    size_t pos = 0;
+    while (pos + RECORD_HEADER_SIZE <= segment->capacity) {
+        const char* header = segment->data + pos;
+        if (read_uint(header, 4) != RECORD_MAGIC) {
+            break;  // End of the written part (or a torn write)
+        }
+
+        uint64_t key_length = read_uint(header + 4, 4);
+        uint64_t entry_length = read_uint(header + 8, 8);
+        long long expires_at = static_cast<long long>(read_uint(header + 16, 8));
+
+        // Check each length on its own, a corrupt header must not wrap the sum around
+        size_t available = segment->capacity - pos - RECORD_HEADER_SIZE;
+        if (key_length > available || entry_length > available - key_length) {
+            break;
+        }
+        size_t record_size = RECORD_HEADER_SIZE + static_cast<size_t>(key_length + entry_length);
+
+        std::string key(segment->data + pos + RECORD_HEADER_SIZE, key_length);
+        if (entry_length == 0 || expires_at <= now) {
+            index_.erase(key);
+        } else {
+            Location& location = index_[key];
+            location.segment = segment;
+            location.entry_offset = pos + RECORD_HEADER_SIZE + key_length;
+            location.entry_length = entry_length;
+            location.expires_at = expires_at;
+        }
+
+        pos += record_size;
+    }
+    segment->used = pos;
+}
+
+bool DiskCache::append(const std::string& key, const std::string& entry, long long expires_at) {
+    size_t record_size = RECORD_HEADER_SIZE + key.size() + entry.size();
+    if (record_size > segment_bytes_) {
+        return false;
+    }
+
+    if (segments_.empty() || segments_.back()->capacity - segments_.back()->used < record_size) {
+        auto segment = map_segment(next_segment_id_++, true);
+        if (!segment) {
+            return false;
+        }
+        segments_.push_back(segment);
+        while (segments_.size() > max_segments_) {
+            evict_oldest();
+        }
+    }
+
+    Segment& segment = *segments_.back();
+    char* record = segment.data + segment.used;
+
+    // Payload first and the magic last, so a torn record ends the scan on restart
+    std::memcpy(record + RECORD_HEADER_SIZE, key.data(), key.size());
+    std::memcpy(record + RECORD_HEADER_SIZE + key.size(), entry.data(), entry.size());
+    write_u32(record + 4, static_cast<uint32_t>(key.size()));
+    write_u64(record + 8, entry.size());
+    write_u64(record + 16, static_cast<uint64_t>(expires_at));
+    write_u32(record, RECORD_MAGIC);
+
+    if (entry.empty()) {
+        index_.erase(key);
+    } else {
+        Location& location = index_[key];
+        location.segment = segments_.back();
+        location.entry_offset = segment.used + RECORD_HEADER_SIZE + key.size();
+        location.entry_length = entry.size();
+        location.expires_at = expires_at;
+    }
+
+    segment.used += record_size;
+    return true;
+}
+
+void DiskCache::evict_oldest() {
+    std::shared_ptr<Segment> oldest = segments_.front();
+    segments_.pop_front();
+
+    for (auto it = index_.begin(); it != index_.end();) {
+        if (it->second.segment == oldest) {
+            it = index_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Responses still being sent keep the mapping alive until they are done
+    unlink(oldest->path.c_str());
+    Logger::getInstance().debug("Evicted disk cache segment " + oldest->path, "DiskCache");
+}
+
+bool DiskCache::put(const std::string& key, const CacheEntry& entry, long long expires_at) {
+    std::string serialized = entry.serialize();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return append(key, serialized, expires_at);
+}
+
+bool DiskCache::get(const std::string& key, CacheEntry& entry) {
+    Location location;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return false;
+        }
+        if (it->second.expires_at <= CacheEntry::now()) {
+            index_.erase(it);
+            return false;
+        }
+        location = it->second;
+    }
+
+    // Decode in place, only the header table is copied out of the mapping
+    const char* data = location.segment->data + location.entry_offset;
+    CacheEntryView view;
+    if (!CacheEntry::decode(std::string_view(data, location.entry_length), view)) {
+        Logger::getInstance().error("Corrupt disk cache record for " + key, "DiskCache");
+        return false;
+    }
+
+    auto response = std::make_shared<HttpResponse>(static_cast<HttpStatus>(view.status));
+    for (const auto& header : view.headers) {
+        response->set_header(std::string(header.first), std::string(header.second));
+    }
+
+    FileBody body;
+    body.fd = location.segment->fd;
+    body.offset = static_cast<long long>(location.entry_offset);
+    body.length = view.body.size();
+    body.data = view.body.data();
+    body.owner = location.segment;
+    response->set_file_body(body, response->get_header("Content-Type", "text/plain"));
+
+    entry.response = response;
+    entry.stored_at = view.stored_at;
+    entry.fresh_seconds = view.fresh_seconds;
+    entry.stale_while_revalidate_seconds = view.stale_while_revalidate_seconds;
+    entry.stale_if_error_seconds = view.stale_if_error_seconds;
+    entry.uri = std::string(view.uri);
+    return true;
+}
+
+void DiskCache::remove(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.erase(key) > 0) {
+        append(key, std::string(), 0);
+    }
+}
+
+size_t DiskCache::max_object_bytes() const {
+    return segment_bytes_ - RECORD_HEADER_SIZE;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "cacheEntry.h"
+
+/**
+ * Disk Cache class
+ * Cache tier for large objects below Redis.
+ *
+ * Entries are appended to fixed-size segment files that are memory-mapped,
+ * so lookups decode the cached entry in place and hand the body out as a
+ * file region that can be sent with sendfile. An in-memory index maps keys
+ * to their latest record. Segments are never rewritten: when the cache is
+ * full the oldest segment is dropped as a whole, and on startup the index
+ * is rebuilt by walking the record headers of every segment.
+ *
+ * Record layout (little-endian, no padding):
+ *   magic u32, key len u32, entry len u64, expires_at u64, key, entry
+ * where entry is a serialized CacheEntry ([body][head][trailer]), so the
+ * body starts right after the key. A record with an entry length of zero
+ * is a tombstone.
+ */
+class DiskCache {
+public:
+    /**
+     * Constructor
+     * @param directory Directory holding the segment files
+     * @param segment_bytes Size of each segment file
+     * @param max_bytes Total size of all segments
+     */
+    DiskCache(const std::string& directory, size_t segment_bytes, size_t max_bytes);
+    ~DiskCache();
+
+    /**
+     * Open the segment files and rebuild the index
+     * @return False if the directory cannot be used
+     */
+    bool open();
+
+    /**
+     * Store an entry
+     * @param key Cache key
+     * @param entry Entry to store
+     * @param expires_at Unix time after which the entry is dropped
+     * @return False if the entry is too large or cannot be written
+     */
+    bool put(const std::string& key, const CacheEntry& entry, long long expires_at);
+
+    /**
+     * Look up an entry
+     * The returned response's body refers to the mapped segment
+     * @param key Cache key
+     * @param entry Output entry
+     * @return False if the key is not cached or has expired
+     */
+    bool get(const std::string& key, CacheEntry& entry);
+
+    /**
+     * Remove an entry
+     * @param key Cache key
+     */
+    void remove(const std::string& key);
+
+    /**
+     * Largest entry a single segment can hold
+     */
+    size_t max_object_bytes() const;
+
+private:
+    static const uint32_t RECORD_MAGIC = 0x52435044;  // "DPCR"
+    static const size_t RECORD_HEADER_SIZE = 24;
+
+    /**
+     * A memory-mapped segment file
+     */
+    struct Segment {
+        uint32_t id = 0;
+        std::string path;
+        int fd = -1;
+        char* data = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+
+        ~Segment();
+    };
+
+    /**
+     * Location of a key's latest record
+     */
+    struct Location {
+        std::shared_ptr<Segment> segment;
+        size_t entry_offset = 0;   // offset of the serialized entry in the segment
+        size_t entry_length = 0;
+        long long expires_at = 0;
+    };
+
+    std::string directory_;
+    size_t segment_bytes_;
+    size_t max_segments_;
+
+    std::mutex mutex_;
+    std::deque<std::shared_ptr<Segment>> segments_;      // oldest first, last one is written to
+    std::unordered_map<std::string, Location> index_;    // key -> latest record
+    uint32_t next_segment_id_ = 0;
+
+    /**
+     * Map a segment file, creating it if needed
+     */
+    std::shared_ptr<Segment> map_segment(uint32_t id, bool create);
+
+    /**
+     * Walk a segment's records and add them to the index
+     */
+    void scan_segment(const std::shared_ptr<Segment>& segment);
+
+    /**
+     * Append a record to the active segment, rolling over to a new one when full
+     * @return False if the record could not be written
+     */
+    bool append(const std::string& key, const std::string& entry, long long expires_at);
+
+    /**
+     * Drop the oldest segment and every index entry pointing into it
+     */
+    void evict_oldest();
+};
@@ -49,7 +49,19 @@ std::string RedisClient::get(const std::string& key) {
         if (reply) freeReplyObject(reply);
         return "";
     }
-    std::string value = reply->str;
+    // Values may be binary, so use the reply length rather than the C string
+    std::string value(reply->str, reply->len);
+    freeReplyObject(reply);
+    return value;
+}
+
+std::string RedisClient::get_range(const std::string& key, long long start, long long end) {
+    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "GETRANGE %s %lld %lld", key.c_str(), start, end));
+    if (!reply || reply->type != REDIS_REPLY_STRING) {
+        if (reply) freeReplyObject(reply);
+        return "";
+    }
+    std::string value(reply->str, reply->len);
     freeReplyObject(reply);
     return value;
 }
@@ -60,12 +72,12 @@ int RedisClient::get_int(const std::string& key) {
 }
 
 void RedisClient::set(const std::string& key, const std::string& value) {
-    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "SET %s %s", key.c_str(), value.c_str()));
+    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "SET %s %b", key.c_str(), value.data(), value.size()));
     if (reply) freeReplyObject(reply);
 }
 
 void RedisClient::set_with_expiry(const std::string& key, const std::string& value, int ttl_seconds) {
-    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "SETEX %s %d %s", key.c_str(), ttl_seconds, value.c_str()));
+    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "SETEX %s %d %b", key.c_str(), ttl_seconds, value.data(), value.size()));
     if (reply) freeReplyObject(reply);
 }
 
@@ -73,3 +85,62 @@ void RedisClient::increment(const std::string& key) {
     redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "INCR %s", key.c_str()));
     if (reply) freeReplyObject(reply);
 }
+
+void RedisClient::del(const std::vector<std::string>& keys) {
+    if (keys.empty()) {
+        return;
+    }
+    
+    std::vector<const char*> argv;
+    std::vector<size_t> argv_len;
+    argv.push_back("DEL");
+    argv_len.push_back(3);
+    for (const auto& key : keys) {
+        argv.push_back(key.data());
+        argv_len.push_back(key.size());
+    }
+    
+    redisReply* reply = static_cast<redisReply*>(redisCommandArgv(context_, static_cast<int>(argv.size()), argv.data(), argv_len.data()));
+    if (reply) freeReplyObject(reply);
+}
+
+void RedisClient::set_add(const std::string& key, const std::string& member, int ttl_seconds) {
+    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "SADD %s %b", key.c_str(), member.data(), member.size()));
+    if (reply) freeReplyObject(reply);
+    
+    // Only ever extend the set's lifetime, so that it outlives all of its members
+    reply = static_cast<redisReply*>(redisCommand(context_, "TTL %s", key.c_str()));
+    long long current_ttl = (reply && reply->type == REDIS_REPLY_INTEGER) ? reply->integer : -1;
+    if (reply) freeReplyObject(reply);
+    if (current_ttl < ttl_seconds) {
+        reply = static_cast<redisReply*>(redisCommand(context_, "EXPIRE %s %d", key.c_str(), ttl_seconds));
+        if (reply) freeReplyObject(reply);
+    }
+}
+
+std::vector<std::string> RedisClient::set_members(const std::string& key) {
+    return get_array(static_cast<redisReply*>(redisCommand(context_, "SMEMBERS %s", key.c_str())));
+}
+
+void RedisClient::list_push(const std::string& key, const std::string& value) {
+    redisReply* reply = static_cast<redisReply*>(redisCommand(context_, "RPUSH %s %b", key.c_str(), value.data(), value.size()));
+    if (reply) freeReplyObject(reply);
+}
+
+std::vector<std::string> RedisClient::list_range(const std::string& key) {
+    return get_array(static_cast<redisReply*>(redisCommand(context_, "LRANGE %s 0 -1", key.c_str())));
+}
+
+std::vector<std::string> RedisClient::get_array(redisReply* reply) {
+    std::vector<std::string> values;
+    if (reply && reply->type == REDIS_REPLY_ARRAY) {
+        for (size_t i = 0; i < reply->elements; ++i) {
+            const redisReply* element = reply->element[i];
+            if (element->type == REDIS_REPLY_STRING) {
+                values.emplace_back(element->str, element->len);
+            }
+        }
+    }
+    if (reply) freeReplyObject(reply);
+    return values;
+}
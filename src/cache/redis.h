@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <hiredis/hiredis.h>
 
 class RedisClient {
@@ -13,10 +14,16 @@ public:
     void disconnect();
 
     std::string get(const std::string& key);
+    std::string get_range(const std::string& key, long long start, long long end);
     int get_int(const std::string& key);
     void set(const std::string& key, const std::string& value);
     void set_with_expiry(const std::string& key, const std::string& value, int ttl_seconds);
     void increment(const std::string& key);
+    void del(const std::vector<std::string>& keys);
+    void set_add(const std::string& key, const std::string& member, int ttl_seconds);
+    std::vector<std::string> set_members(const std::string& key);
+    void list_push(const std::string& key, const std::string& value);
+    std::vector<std::string> list_range(const std::string& key);
 
 private:
     std::string host_;
@@ -25,4 +32,5 @@ private:
     redisContext* context_;
 
     bool authenticate();
+    std::vector<std::string> get_array(redisReply* reply);
 };
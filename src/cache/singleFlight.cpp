@@ -0,0 +1,76 @@
+#include "singleFlight.h"
+
+HttpResponsePtr SingleFlight::run(const std::string& key, const Fetch& fetch,
+                                  std::chrono::milliseconds timeout, bool* shared) {
+    if (shared) {
+        *shared = false;
+    }
+
+    std::shared_ptr<Call> call;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = calls_.find(key);
+        if (it != calls_.end()) {
+            // Another request is already fetching this key, wait for it
+            call = it->second;
+            ++call->waiters;
+            bool finished = call->cv.wait_for(lock, timeout, [&call]() { return call->done; });
+            if (!finished) {
+                --call->waiters;  // Gone before the leader completes, it need not snapshot for us
+            }
+            std::shared_ptr<const HttpResponse> snapshot = finished ? call->response : nullptr;
+            lock.unlock();
+
+            if (snapshot) {
+                if (shared) {
+                    *shared = true;
+                }
+                return std::make_shared<HttpResponse>(*snapshot);
+            }
+
+            // The leader is too slow or failed, fall back to fetching directly
+            return fetch();
+        }
+
+        call = std::make_shared<Call>();
+        calls_[key] = call;
+    }
+
+    // This caller is the leader
+    HttpResponsePtr response;
+    try {
+        response = fetch();
+    }
+    catch (...) {
+        complete(key, call, nullptr);
+        throw;
+    }
+
+    complete(key, call, response);
+    return response;
+}
+
+void SingleFlight::complete(const std::string& key, const std::shared_ptr<Call>& call,
+                            const HttpResponsePtr& response) {
+    int waiters = 0;
+    {
+        // Unregister first so no new callers can join this call
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = calls_.find(key);
+        if (it != calls_.end() && it->second == call) {
+            calls_.erase(it);
+        }
+        waiters = call->waiters;
+    }
+
+    // Snapshot only when someone is waiting, the leader keeps modifying its own response
+    std::shared_ptr<const HttpResponse> snapshot;
+    if (response && waiters > 0) {
+        snapshot = std::make_shared<const HttpResponse>(*response);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    call->response = snapshot;
+    call->done = true;
+    call->cv.notify_all();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "../http/ResponseHandler.h"
+
+/**
+ * Single Flight class
+ * Collapses concurrent fetches for the same key into one upstream request.
+ * The first caller (the leader) runs the fetch, later callers wait for it
+ * and receive their own copy of the leader's response.
+ */
+class SingleFlight {
+public:
+    using Fetch = std::function<HttpResponsePtr()>;
+
+    /**
+     * Run a fetch at most once per key at a time
+     * @param key Key identifying identical requests
+     * @param fetch Function producing the response
+     * @param timeout How long a waiting caller waits before fetching on its own
+     * @param shared Optional flag set to true if the response came from another caller's fetch
+     * @return The response
+     */
+    HttpResponsePtr run(const std::string& key, const Fetch& fetch,
+                        std::chrono::milliseconds timeout, bool* shared = nullptr);
+
+private:
+    /**
+     * State of an in-flight fetch
+     */
+    struct Call {
+        std::condition_variable cv;
+        bool done = false;
+        int waiters = 0;                                // callers that joined this fetch
+        std::shared_ptr<const HttpResponse> response;  // snapshot handed to waiting callers
+    };
+
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Call>> calls_;  // key -> in-flight fetch
+
+    /**
+     * Publish a leader's result and wake up the waiting callers
+     * @param key Key of the fetch
+     * @param call The in-flight call
+     * @param response The leader's response (may be null on failure)
+     */
+    void complete(const std::string& key, const std::shared_ptr<Call>& call, const HttpResponsePtr& response);
+};
@@ -1,19 +1,63 @@
 #include "Config.h"
 #include "../util/Logger.h"
+#include <algorithm>
 #include <fstream>
 #include <json/json.h>
 
+namespace {
+    /**
+     * Longest time a route keeps an entry: its freshness plus the stale windows,
+     * or one more freshness when the entry can be revalidated
+     */
+    long long max_entry_seconds(const RouteConfig& route) {
+        int grace = std::max(route.stale_while_revalidate_seconds, route.stale_if_error_seconds);
+        long long longest = 0;
+        auto consider = [&longest, grace](int fresh) {
+            longest = std::max(longest, static_cast<long long>(fresh) + std::max(grace, fresh));
+        };
+        consider(route.cache_ttl_seconds);
+        for (const auto& status_ttl : route.cache_status_ttls) {
+            consider(status_ttl.second);
+        }
+        return longest;
+    }
+}
+
 Config::Config() : 
     http_port_(8080),
     websocket_port_(8081),
     websocket_enabled_(false),
     ssl_enabled_(false),
+    ssl_handshake_timeout_ms_(10000),
+    ssl_session_cache_size_(20480),
+    ssl_session_timeout_seconds_(3600),
+    ssl_session_tickets_(true),
+    ssl_session_ticket_rotate_seconds_(3600),
+    ssl_reload_check_seconds_(60),
+    ssl_ktls_(false),
     jwt_auth_enabled_(false),
+    jwt_cache_size_(10000),
+    jwks_refresh_seconds_(300),
     rate_limit_(100),
     rate_window_seconds_(60),
     gzip_enabled_(true),
+    compression_adaptive_(true),
+    compression_offload_threads_(0),
+    compression_offload_min_bytes_(256 * 1024),
+    compression_offload_queue_(64),
     redis_host_("localhost"),
-    redis_port_(6379)
+    redis_port_(6379),
+    cache_admission_enabled_(false),
+    cache_admission_min_frequency_(2),
+    cache_admission_sketch_width_(65536),
+    cache_max_object_bytes_(1024 * 1024),
+    disk_cache_enabled_(false),
+    disk_cache_path_("cache"),
+    disk_cache_segment_bytes_(64 * 1024 * 1024),
+    disk_cache_max_bytes_(1024 * 1024 * 1024),
+    disk_cache_min_object_bytes_(256 * 1024),
+    cache_tag_header_("Surrogate-Key"),
+    cache_ban_ttl_seconds_(86400)
 {
 }
 
@@ -55,20 +99,50 @@ bool Config::load(const std::string& config_path) {
         if (ssl_enabled_) {
             ssl_cert_path_ = root_["security"]["ssl_cert_path"].asString();
             ssl_key_path_ = root_["security"]["ssl_key_path"].asString();
+            ssl_handshake_timeout_ms_ = root_["security"].get("ssl_handshake_timeout_ms", ssl_handshake_timeout_ms_).asInt();
+            ssl_session_cache_size_ = root_["security"].get("ssl_session_cache_size", ssl_session_cache_size_).asInt();
+            ssl_session_timeout_seconds_ = root_["security"].get("ssl_session_timeout_seconds", ssl_session_timeout_seconds_).asInt();
+            ssl_session_tickets_ = root_["security"].get("ssl_session_tickets", ssl_session_tickets_).asBool();
+            ssl_session_ticket_key_file_ = root_["security"].get("ssl_session_ticket_key_file", "").asString();
+            ssl_session_ticket_rotate_seconds_ = root_["security"].get("ssl_session_ticket_rotate_seconds", ssl_session_ticket_rotate_seconds_).asInt();
+            ssl_reload_check_seconds_ = root_["security"].get("ssl_reload_check_seconds", ssl_reload_check_seconds_).asInt();
+            ssl_ktls_ = root_["security"].get("ssl_ktls", ssl_ktls_).asBool();
+            
+            // Certificates selected by SNI, the ssl_cert_path pair is the default
+            ssl_certificates_.clear();
+            for (const auto& certificate_json : root_["security"]["ssl_certificates"]) {
+                CertificateConfig certificate;
+                certificate.cert_path = certificate_json["cert_path"].asString();
+                certificate.key_path = certificate_json["key_path"].asString();
+                for (const auto& name : certificate_json["server_names"]) {
+                    certificate.server_names.push_back(name.asString());
+                }
+                ssl_certificates_.push_back(certificate);
+            }
         }
         
         // Read JWT configuration
         jwt_auth_enabled_ = root_["security"]["jwt_auth_enabled"].asBool();
         if (jwt_auth_enabled_) {
             jwt_secret_ = root_["security"]["jwt_secret"].asString();
+            jwt_cache_size_ = root_["security"].get("jwt_cache_size", Json::UInt64(jwt_cache_size_)).asUInt64();
+            jwks_source_ = root_["security"]["jwks_source"].asString();
+            jwks_refresh_seconds_ = root_["security"].get("jwks_refresh_seconds", jwks_refresh_seconds_).asInt();
+            jwt_audience_ = root_["security"]["jwt_audience"].asString();
         }
         
         // Read rate limiting configuration
         rate_limit_ = root_["performance"]["rate_limit"].asInt();
         rate_window_seconds_ = root_["performance"]["rate_window_seconds"].asInt();
+        rate_limit_key_claim_ = root_["performance"]["rate_limit_key_claim"].asString();
         
         // Read compression configuration
         gzip_enabled_ = root_["performance"]["gzip_enabled"].asBool();
+        const Json::Value& performance = root_["performance"];
+        compression_adaptive_ = performance.get("compression_adaptive", compression_adaptive_).asBool();
+        compression_offload_threads_ = performance.get("compression_offload_threads", compression_offload_threads_).asInt();
+        compression_offload_min_bytes_ = performance.get("compression_offload_min_bytes", Json::UInt64(compression_offload_min_bytes_)).asUInt64();
+        compression_offload_queue_ = performance.get("compression_offload_queue", Json::UInt64(compression_offload_queue_)).asUInt64();
         
         // Read Redis configuration
         redis_host_ = root_["cache"]["redis_host"].asString();
@@ -77,21 +151,85 @@ bool Config::load(const std::string& config_path) {
             redis_password_ = root_["cache"]["redis_password"].asString();
         }
         
-        // Read CORS configuration
-        const Json::Value& origins = root_["security"]["cors"]["allowed_origins"];
-        for (const auto& origin : origins) {
+        // Read cache admission configuration
+        cache_admission_enabled_ = root_["cache"]["admission_enabled"].asBool();
+        if (cache_admission_enabled_) {
+            cache_admission_min_frequency_ = root_["cache"].get("admission_min_frequency", cache_admission_min_frequency_).asInt();
+            cache_admission_sketch_width_ = root_["cache"].get("admission_sketch_width", cache_admission_sketch_width_).asInt();
+        }
+        cache_max_object_bytes_ = root_["cache"].get("max_object_bytes", Json::UInt64(cache_max_object_bytes_)).asUInt64();
+        
+        // Read cache invalidation configuration
+        cache_admin_token_ = root_["cache"]["admin_token"].asString();
+        cache_tag_header_ = root_["cache"].get("tag_header", cache_tag_header_).asString();
+        cache_ban_ttl_seconds_ = root_["cache"].get("ban_ttl_seconds", cache_ban_ttl_seconds_).asInt();
+        
+        // Read disk cache configuration
+        const Json::Value& disk = root_["cache"]["disk"];
+        disk_cache_enabled_ = disk["enabled"].asBool();
+        if (disk_cache_enabled_) {
+            disk_cache_path_ = disk.get("path", disk_cache_path_).asString();
+            disk_cache_segment_bytes_ = disk.get("segment_size_mb", Json::UInt64(disk_cache_segment_bytes_ >> 20)).asUInt64() << 20;
+            disk_cache_max_bytes_ = disk.get("max_size_mb", Json::UInt64(disk_cache_max_bytes_ >> 20)).asUInt64() << 20;
+            disk_cache_min_object_bytes_ = disk.get("min_object_bytes", Json::UInt64(disk_cache_min_object_bytes_)).asUInt64();
+        }
+        
+        // Read CORS configuration and compile it into the policy
+        const Json::Value& cors = root_["security"]["cors"];
+        allowed_origins_.clear();
+        for (const auto& origin : cors["allowed_origins"]) {
             allowed_origins_.push_back(origin.asString());
         }
+        std::vector<std::string> cors_methods = {"GET", "POST", "PUT", "DELETE", "OPTIONS"};
+        if (cors.isMember("allowed_methods")) {
+            cors_methods.clear();
+            for (const auto& method : cors["allowed_methods"]) {
+                cors_methods.push_back(method.asString());
+            }
+        }
+        std::vector<std::string> cors_headers = {"Origin", "Content-Type", "Accept", "Authorization", "X-Requested-With"};
+        if (cors.isMember("allowed_headers")) {
+            cors_headers.clear();
+            for (const auto& header : cors["allowed_headers"]) {
+                cors_headers.push_back(header.asString());
+            }
+        }
+        cors_policy_ = CorsPolicy(allowed_origins_, cors_methods, cors_headers,
+                                  cors.get("allow_credentials", true).asBool(),
+                                  cors.get("max_age_seconds", 3600).asInt());
         
-        // Read IP whitelist
+        // Read IP whitelist and blacklist and compile them into the filter
+        ip_filter_ = IpFilter();
+        allowed_ips_.clear();
+        denied_ips_.clear();
         const Json::Value& ips = root_["security"]["ip_whitelist"];
         for (const auto& ip : ips) {
             allowed_ips_.push_back(ip.asString());
+            if (!ip_filter_.add(allowed_ips_.back(), true)) {
+                // LOG_ERROR("Invalid ip_whitelist entry: " + allowed_ips_.back());
+                return false;
+            }
+        }
+        const Json::Value& denied_ips = root_["security"]["ip_blacklist"];
+        for (const auto& ip : denied_ips) {
+            denied_ips_.push_back(ip.asString());
+            if (!ip_filter_.add(denied_ips_.back(), false)) {
+                // LOG_ERROR("Invalid ip_blacklist entry: " + denied_ips_.back());
+                return false;
+            }
         }
         
         // Parse routes
         parse_routes(root_["routes"]);
         
+        // Bans are dropped after ban_ttl_seconds, so no entry may be kept longer
+        for (const auto& route : routes_) {
+            if (route.cache_enabled && max_entry_seconds(route) > cache_ban_ttl_seconds_) {
+                // LOG_ERROR("cache.ban_ttl_seconds is shorter than the entries of route " + route.path_prefix);
+                return false;
+            }
+        }
+        
         // LOG_INFO("Configuration loaded successfully");
         return true;
     }
@@ -115,6 +253,70 @@ void Config::parse_routes(const Json::Value& routes_config) {
         route.cache_enabled = route_json["cache_enabled"].asBool();
         if (route.cache_enabled) {
             route.cache_ttl_seconds = route_json["cache_ttl_seconds"].asInt();
+            route.coalescing_enabled = route_json.get("coalescing_enabled", route.coalescing_enabled).asBool();
+            route.coalesce_timeout_ms = route_json.get("coalesce_timeout_ms", route.coalesce_timeout_ms).asInt();
+            route.stale_while_revalidate_seconds = route_json["stale_while_revalidate_seconds"].asInt();
+            route.stale_if_error_seconds = route_json["stale_if_error_seconds"].asInt();
+            
+            // Parse cache key options
+            route.cache_key_sort_query = route_json.get("cache_key_sort_query", route.cache_key_sort_query).asBool();
+            for (const auto& param : route_json["cache_key_query_allowlist"]) {
+                route.cache_key_query_allowlist.push_back(param.asString());
+            }
+            for (const auto& param : route_json["cache_key_query_denylist"]) {
+                route.cache_key_query_denylist.push_back(param.asString());
+            }
+            for (const auto& header : route_json["cache_key_headers"]) {
+                route.cache_key_headers.push_back(header.asString());
+            }
+            
+            // Parse negative caching options, e.g. {"404": 30}
+            const Json::Value& status_ttls = route_json["cache_status_ttls"];
+            for (const auto& status : status_ttls.getMemberNames()) {
+                route.cache_status_ttls[std::stoi(status)] = status_ttls[status].asInt();
+            }
+        }
+        
+        // Parse compression options, e.g. ["br", "gzip"] and {"br": 4}
+        if (route_json.isMember("compression_encodings")) {
+            route.compression_encodings.clear();
+            for (const auto& encoding : route_json["compression_encodings"]) {
+                route.compression_encodings.push_back(encoding.asString());
+            }
+        }
+        const Json::Value& levels = route_json["compression_levels"];
+        for (const auto& encoding : levels.getMemberNames()) {
+            route.compression_levels[encoding] = levels[encoding].asInt();
+        }
+        
+        // Parse JWT claim options, e.g. {"sub": "X-User-Id"} and {"tenant": "acme"}
+        const Json::Value& claim_headers = route_json["claim_headers"];
+        for (const auto& claim : claim_headers.getMemberNames()) {
+            route.claim_headers[claim] = claim_headers[claim].asString();
+        }
+        const Json::Value& match_claims = route_json["match_claims"];
+        for (const auto& claim : match_claims.getMemberNames()) {
+            route.match_claims[claim] = match_claims[claim].asString();
+        }
+        
+        // Routes sharing a prefix are told apart by their claims, in name order
+        for (const auto& claim : route.match_claims) {
+            route.route_id += "\n" + claim.first + "=" + claim.second;
+        }
+        
+        // Responses built from forwarded claims differ per token, so the claims are part of the cache key
+        if (route.cache_enabled) {
+            for (const auto& claim_header : route.claim_headers) {
+                route.cache_key_headers.push_back(claim_header.second);
+            }
+        }
+        
+        // Parse request hedging options
+        route.hedging_enabled = route_json["hedging_enabled"].asBool();
+        if (route.hedging_enabled) {
+            route.hedge_percentile = route_json.get("hedge_percentile", route.hedge_percentile).asDouble();
+            route.hedge_min_delay_ms = route_json.get("hedge_min_delay_ms", route.hedge_min_delay_ms).asInt();
+            route.hedge_max_percent = route_json.get("hedge_max_percent", route.hedge_max_percent).asInt();
         }
         
         // Parse backend servers
@@ -158,6 +360,42 @@ std::string Config::get_ssl_key_path() const {
     return ssl_key_path_;
 }
 
+int Config::get_ssl_handshake_timeout_ms() const {
+    return ssl_handshake_timeout_ms_;
+}
+
+int Config::get_ssl_session_cache_size() const {
+    return ssl_session_cache_size_;
+}
+
+int Config::get_ssl_session_timeout_seconds() const {
+    return ssl_session_timeout_seconds_;
+}
+
+bool Config::is_ssl_session_tickets_enabled() const {
+    return ssl_session_tickets_;
+}
+
+std::string Config::get_ssl_session_ticket_key_file() const {
+    return ssl_session_ticket_key_file_;
+}
+
+int Config::get_ssl_session_ticket_rotate_seconds() const {
+    return ssl_session_ticket_rotate_seconds_;
+}
+
+const std::vector<CertificateConfig>& Config::get_ssl_certificates() const {
+    return ssl_certificates_;
+}
+
+int Config::get_ssl_reload_check_seconds() const {
+    return ssl_reload_check_seconds_;
+}
+
+bool Config::is_ssl_ktls_enabled() const {
+    return ssl_ktls_;
+}
+
 bool Config::is_jwt_auth_enabled() const {
     return jwt_auth_enabled_;
 }
@@ -166,6 +404,22 @@ std::string Config::get_jwt_secret() const {
     return jwt_secret_;
 }
 
+size_t Config::get_jwt_cache_size() const {
+    return jwt_cache_size_;
+}
+
+std::string Config::get_jwt_audience() const {
+    return jwt_audience_;
+}
+
+std::string Config::get_jwks_source() const {
+    return jwks_source_;
+}
+
+int Config::get_jwks_refresh_seconds() const {
+    return jwks_refresh_seconds_;
+}
+
 int Config::get_rate_limit() const {
     return rate_limit_;
 }
@@ -174,10 +428,30 @@ int Config::get_rate_window_seconds() const {
     return rate_window_seconds_;
 }
 
+std::string Config::get_rate_limit_key_claim() const {
+    return rate_limit_key_claim_;
+}
+
 bool Config::is_gzip_enabled() const {
     return gzip_enabled_;
 }
 
+bool Config::is_compression_adaptive() const {
+    return compression_adaptive_;
+}
+
+int Config::get_compression_offload_threads() const {
+    return compression_offload_threads_;
+}
+
+size_t Config::get_compression_offload_min_bytes() const {
+    return compression_offload_min_bytes_;
+}
+
+size_t Config::get_compression_offload_queue() const {
+    return compression_offload_queue_;
+}
+
 std::string Config::get_redis_host() const {
     return redis_host_;
 }
@@ -190,28 +464,110 @@ std::string Config::get_redis_password() const {
     return redis_password_;
 }
 
-std::vector<std::string> Config::get_allowed_origins() const {
+bool Config::is_cache_admission_enabled() const {
+    return cache_admission_enabled_;
+}
+
+int Config::get_cache_admission_min_frequency() const {
+    return cache_admission_min_frequency_;
+}
+
+int Config::get_cache_admission_sketch_width() const {
+    return cache_admission_sketch_width_;
+}
+
+size_t Config::get_cache_max_object_bytes() const {
+    return cache_max_object_bytes_;
+}
+
+bool Config::is_disk_cache_enabled() const {
+    return disk_cache_enabled_;
+}
+
+std::string Config::get_disk_cache_path() const {
+    return disk_cache_path_;
+}
+
+size_t Config::get_disk_cache_segment_bytes() const {
+    return disk_cache_segment_bytes_;
+}
+
+size_t Config::get_disk_cache_max_bytes() const {
+    return disk_cache_max_bytes_;
+}
+
+size_t Config::get_disk_cache_min_object_bytes() const {
+    return disk_cache_min_object_bytes_;
+}
+
+std::string Config::get_cache_admin_token() const {
+    return cache_admin_token_;
+}
+
+std::string Config::get_cache_tag_header() const {
+    return cache_tag_header_;
+}
+
+int Config::get_cache_ban_ttl_seconds() const {
+    return cache_ban_ttl_seconds_;
+}
+
+const std::vector<std::string>& Config::get_allowed_origins() const {
     return allowed_origins_;
 }
 
-std::vector<std::string> Config::get_allowed_ips() const {
+const CorsPolicy& Config::get_cors_policy() const {
+    return cors_policy_;
+}
+
+const std::vector<std::string>& Config::get_allowed_ips() const {
     return allowed_ips_;
 }
 
-const RouteConfig* Config::find_route(const std::string& path) const {
+const std::vector<std::string>& Config::get_denied_ips() const {
+    return denied_ips_;
+}
+
+const IpFilter& Config::get_ip_filter() const {
+    return ip_filter_;
+}
+
+const RouteConfig* Config::find_route(const std::string& path,
+                                   const std::map<std::string, std::string>* claims) const {
     // Find the best matching route based on path prefix
     const RouteConfig* best_match = nullptr;
     size_t best_match_length = 0;
     
     for (const auto& route : routes_) {
         // Check if this route prefix matches the path
-        if (path.compare(0, route.path_prefix.size(), route.path_prefix) == 0) {
-            // If this is a longer match than the current best, use it
-            if (route.path_prefix.size() > best_match_length) {
-                best_match = &route;
-                best_match_length = route.path_prefix.size();
+        if (path.compare(0, route.path_prefix.size(), route.path_prefix) != 0) {
+            continue;
+        }
+        
+        // Claim-restricted routes need every listed claim value
+        bool claims_match = true;
+        for (const auto& required : route.match_claims) {
+            if (!claims) {
+                claims_match = false;
+                break;
+            }
+            auto claim = claims->find(required.first);
+            if (claim == claims->end() || claim->second != required.second) {
+                claims_match = false;
+                break;
             }
         }
+        if (!claims_match) {
+            continue;
+        }
+        
+        // If this is a longer match than the current best, use it
+        if (route.path_prefix.size() > best_match_length ||
+            (best_match && route.path_prefix.size() == best_match_length && best_match->match_claims.empty() &&
+             !route.match_claims.empty())) {
+            best_match = &route;
+            best_match_length = route.path_prefix.size();
+        }
     }
     
     return best_match;
@@ -3,8 +3,11 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <memory>
 #include <json/json.h>
+#include "../security/corsPolicy.h"
+#include "../security/ipFilter.h"
 
 /**
  * Backend Server Configuration
@@ -22,20 +25,50 @@ struct BackendServer {
         : name(n), host(h), port(p), weight(w), is_healthy(true) {}
 };
 
+/**
+ * TLS certificate served for a set of server names (SNI)
+ */
+struct CertificateConfig {
+    std::string cert_path;
+    std::string key_path;
+    std::vector<std::string> server_names;  // empty: taken from the certificate's DNS names
+};
+
 /**
  * route Configuration
  * defines how URLs are mapped to backend servers
  */
 struct RouteConfig {
     std::string path_prefix;              // URL path prefix to match
+    std::string route_id;                 // Path prefix and match_claims, unique per configured route
     std::vector<BackendServer> backends;  // Potential backend servers
     bool websocket_enabled;               // Whether this route supports WebSockets
     bool cache_enabled;                   // Whether to cache responses
     int cache_ttl_seconds;                // How long to cache responses
+    bool coalescing_enabled;              // Whether concurrent cache misses share one upstream fetch
+    int coalesce_timeout_ms;              // How long a coalesced request waits before fetching itself
+    int stale_while_revalidate_seconds;   // How long a stale response is served while refreshing
+    int stale_if_error_seconds;           // How long a stale response is served on backend errors
+    bool cache_key_sort_query;            // Whether query parameter order is ignored in cache keys
+    std::vector<std::string> cache_key_query_allowlist;  // Query parameters kept in cache keys (empty = all)
+    std::vector<std::string> cache_key_query_denylist;   // Query parameters dropped from cache keys
+    std::vector<std::string> cache_key_headers;          // Request headers included in cache keys
+    std::map<int, int> cache_status_ttls;                 // Cacheable non-200 statuses -> TTL in seconds
+    std::vector<std::string> compression_encodings;      // Content codings offered, most preferred first
+    std::map<std::string, int> compression_levels;        // Content coding -> compression level
+    std::map<std::string, std::string> claim_headers;     // JWT claim -> upstream request header
+    std::map<std::string, std::string> match_claims;      // JWT claim values a request needs to use this route
+    bool hedging_enabled;                 // Whether to hedge slow GET/HEAD requests
+    double hedge_percentile;              // Latency percentile used as the hedge delay
+    int hedge_min_delay_ms;               // Lower bound for the hedge delay
+    int hedge_max_percent;                // Max share of requests that may be hedged
     
     // Constructor
     RouteConfig(const std::string& prefix) 
-        : path_prefix(prefix), websocket_enabled(false), cache_enabled(false), cache_ttl_seconds(300) {}
+        : path_prefix(prefix), route_id(prefix), websocket_enabled(false), cache_enabled(false), cache_ttl_seconds(300),
+          coalescing_enabled(true), coalesce_timeout_ms(5000),
+          stale_while_revalidate_seconds(0), stale_if_error_seconds(0), cache_key_sort_query(true),
+          compression_encodings({"br", "zstd", "gzip"}), hedging_enabled(false), hedge_percentile(95.0), hedge_min_delay_ms(5), hedge_max_percent(10) {}
 };
 
 /**
@@ -61,23 +94,68 @@ public:
     bool is_ssl_enabled() const;
     std::string get_ssl_cert_path() const;
     std::string get_ssl_key_path() const;
+    int get_ssl_handshake_timeout_ms() const;
+    int get_ssl_session_cache_size() const;
+    int get_ssl_session_timeout_seconds() const;
+    bool is_ssl_session_tickets_enabled() const;
+    std::string get_ssl_session_ticket_key_file() const;
+    int get_ssl_session_ticket_rotate_seconds() const;
+    const std::vector<CertificateConfig>& get_ssl_certificates() const;
+    int get_ssl_reload_check_seconds() const;
+    bool is_ssl_ktls_enabled() const;
     bool is_jwt_auth_enabled() const;
     std::string get_jwt_secret() const;
+    size_t get_jwt_cache_size() const;
+    std::string get_jwks_source() const;
+    int get_jwks_refresh_seconds() const;
+    std::string get_jwt_audience() const;
     int get_rate_limit() const;
     int get_rate_window_seconds() const;
+    std::string get_rate_limit_key_claim() const;
     bool is_gzip_enabled() const;
+    bool is_compression_adaptive() const;
+    int get_compression_offload_threads() const;
+    size_t get_compression_offload_min_bytes() const;
+    size_t get_compression_offload_queue() const;
     std::string get_redis_host() const;
     int get_redis_port() const;
     std::string get_redis_password() const;
-    std::vector<std::string> get_allowed_origins() const;
-    std::vector<std::string> get_allowed_ips() const;
+    bool is_cache_admission_enabled() const;
+    int get_cache_admission_min_frequency() const;
+    int get_cache_admission_sketch_width() const;
+    size_t get_cache_max_object_bytes() const;
+    bool is_disk_cache_enabled() const;
+    std::string get_disk_cache_path() const;
+    size_t get_disk_cache_segment_bytes() const;
+    size_t get_disk_cache_max_bytes() const;
+    size_t get_disk_cache_min_object_bytes() const;
+    std::string get_cache_admin_token() const;
+    std::string get_cache_tag_header() const;
+    int get_cache_ban_ttl_seconds() const;
+    const std::vector<std::string>& get_allowed_origins() const;
+    
+    /**
+     * CORS settings compiled for lookups
+     */
+    const CorsPolicy& get_cors_policy() const;
+    const std::vector<std::string>& get_allowed_ips() const;
+    const std::vector<std::string>& get_denied_ips() const;
+    
+    /**
+     * Allow and deny lists compiled for lookups
+     */
+    const IpFilter& get_ip_filter() const;
     
     /**
      * Find a route configuration matching a path
+     * Routes with match_claims only match requests whose token carries those
+     * claim values, and win over a route with the same prefix that has none.
      * @param path Request path to match
+     * @param claims Claims of the request's verified token, if any
      * @return Pointer to matched route or nullptr
      */
-    const RouteConfig* find_route(const std::string& path) const;
+    const RouteConfig* find_route(const std::string& path,
+                                  const std::map<std::string, std::string>* claims = nullptr) const;
     
     /**
      * Get all configured routes
@@ -94,16 +172,49 @@ private:
     bool ssl_enabled_;
     std::string ssl_cert_path_;
     std::string ssl_key_path_;
+    int ssl_handshake_timeout_ms_;
+    int ssl_session_cache_size_;
+    int ssl_session_timeout_seconds_;
+    bool ssl_session_tickets_;
+    std::string ssl_session_ticket_key_file_;
+    int ssl_session_ticket_rotate_seconds_;
+    std::vector<CertificateConfig> ssl_certificates_;
+    int ssl_reload_check_seconds_;
+    bool ssl_ktls_;
     bool jwt_auth_enabled_;
     std::string jwt_secret_;
+    size_t jwt_cache_size_;
+    std::string jwks_source_;
+    int jwks_refresh_seconds_;
+    std::string jwt_audience_;
     int rate_limit_;
     int rate_window_seconds_;
+    std::string rate_limit_key_claim_;
     bool gzip_enabled_;
+    bool compression_adaptive_;
+    int compression_offload_threads_;
+    size_t compression_offload_min_bytes_;
+    size_t compression_offload_queue_;
     std::string redis_host_;
     int redis_port_;
     std::string redis_password_;
+    bool cache_admission_enabled_;
+    int cache_admission_min_frequency_;
+    int cache_admission_sketch_width_;
+    size_t cache_max_object_bytes_;
+    bool disk_cache_enabled_;
+    std::string disk_cache_path_;
+    size_t disk_cache_segment_bytes_;
+    size_t disk_cache_max_bytes_;
+    size_t disk_cache_min_object_bytes_;
+    std::string cache_admin_token_;
+    std::string cache_tag_header_;
+    int cache_ban_ttl_seconds_;
     std::vector<std::string> allowed_origins_;
+    CorsPolicy cors_policy_;
     std::vector<std::string> allowed_ips_;
+    std::vector<std::string> denied_ips_;
+    IpFilter ip_filter_;
     
     /**
      * Parse routes from configuration
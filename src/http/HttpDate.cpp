@@ -0,0 +1,26 @@
+#include "HttpDate.h"
+#include <ctime>
+#include <cstring>
+
+bool HttpDate::parse(const std::string& value, long long& unix_time) {
+    std::tm tm;
+    std::memset(&tm, 0, sizeof(tm));
+
+    const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return false;
+    }
+
+    unix_time = static_cast<long long>(timegm(&tm));
+    return true;
+}
+
+std::string HttpDate::format(long long unix_time) {
+    std::time_t time = static_cast<std::time_t>(unix_time);
+    std::tm tm;
+    gmtime_r(&time, &tm);
+
+    char buffer[64];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buffer, length);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+/**
+ * HTTP date helpers
+ * Conversion between Unix time and the IMF-fixdate format used in
+ * headers such as Last-Modified and If-Modified-Since
+ */
+namespace HttpDate {
+    /**
+     * Parse an HTTP date
+     * @param value Date string, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+     * @param unix_time Output Unix time in seconds
+     * @return False if the value is not a valid HTTP date
+     */
+    bool parse(const std::string& value, long long& unix_time);
+
+    /**
+     * Format Unix time as an HTTP date
+     * @param unix_time Unix time in seconds
+     * @return Formatted date string
+     */
+    std::string format(long long unix_time);
+}
@@ -0,0 +1,191 @@
+#include "HttpRange.h"
+#include <algorithm>
+#include <cctype>
+#include <random>
+
+namespace {
+    // More ranges than this are answered with the full response
+    const size_t MAX_RANGES = 16;
+
+    std::string trim(const std::string& value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
+
+    bool parse_position(const std::string& digits, size_t& value) {
+        if (digits.empty() || digits.size() > 18 || !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+            return false;
+        }
+        value = static_cast<size_t>(std::stoull(digits));
+        return true;
+    }
+
+    std::string content_range(const HttpRange::ByteRange& range, size_t length) {
+        return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" +
+               std::to_string(length);
+    }
+
+    std::string make_boundary() {
+        static const char hex[] = "0123456789abcdef";
+        thread_local std::mt19937_64 generator(std::random_device{}());
+
+        uint64_t value = generator();
+        std::string boundary = "proxy-range-";
+        for (int i = 0; i < 16; ++i) {
+            boundary.push_back(hex[(value >> (4 * i)) & 0xf]);
+        }
+        return boundary;
+    }
+
+    /**
+     * Create the 206 response carrying over the full response's headers
+     */
+    HttpResponsePtr make_head(const HttpResponse& full) {
+        auto partial = std::make_shared<HttpResponse>(HttpStatus::PARTIAL_CONTENT);
+        for (const auto& header : full.headers()) {
+            partial->set_header(header.first, header.second);
+        }
+        return partial;
+    }
+}
+
+namespace HttpRange {
+    ParseResult parse(const std::string& header, size_t length, std::vector<ByteRange>& ranges) {
+        ranges.clear();
+
+        std::string value = trim(header);
+        std::string unit = value.substr(0, 6);
+        std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+        if (unit != "bytes=") {
+            return ParseResult::IGNORED;
+        }
+
+        size_t specs = 0;
+        size_t pos = 6;
+        while (pos <= value.size()) {
+            size_t comma = value.find(',', pos);
+            if (comma == std::string::npos) {
+                comma = value.size();
+            }
+
+            std::string spec = trim(value.substr(pos, comma - pos));
+            pos = comma + 1;
+            if (spec.empty()) {
+                continue;
+            }
+            if (++specs > MAX_RANGES) {
+                return ParseResult::IGNORED;
+            }
+
+            size_t dash = spec.find('-');
+            if (dash == std::string::npos) {
+                return ParseResult::IGNORED;
+            }
+
+            ByteRange range;
+            if (dash == 0) {
+                // Suffix range: the last N bytes
+                size_t suffix = 0;
+                if (!parse_position(spec.substr(1), suffix)) {
+                    return ParseResult::IGNORED;
+                }
+                if (suffix == 0 || length == 0) {
+                    continue;
+                }
+                range.first = length - std::min(suffix, length);
+                range.last = length - 1;
+            } else {
+                size_t first = 0;
+                size_t last = length - 1;
+                if (!parse_position(spec.substr(0, dash), first)) {
+                    return ParseResult::IGNORED;
+                }
+                if (dash + 1 < spec.size() && !parse_position(spec.substr(dash + 1), last)) {
+                    return ParseResult::IGNORED;
+                }
+                if (dash + 1 < spec.size() && last < first) {
+                    return ParseResult::IGNORED;
+                }
+                if (first >= length) {
+                    continue;  // Does not overlap the representation
+                }
+                range.first = first;
+                range.last = std::min(last, length - 1);
+            }
+            ranges.push_back(range);
+        }
+
+        if (specs == 0) {
+            return ParseResult::IGNORED;
+        }
+        return ranges.empty() ? ParseResult::UNSATISFIABLE : ParseResult::SATISFIABLE;
+    }
+
+    HttpResponsePtr make_partial(const HttpResponse& full, const std::vector<ByteRange>& ranges) {
+        std::string content_type = full.get_header("Content-Type", "application/octet-stream");
+        std::string_view body = full.body_view();
+
+        // A single range of a file-backed body stays a file region, so it is still sent with sendfile
+        const FileBody* file = full.file_body();
+        if (ranges.size() == 1 && file) {
+            FileBody slice = *file;
+            slice.offset += static_cast<long long>(ranges[0].first);
+            slice.length = ranges[0].length();
+            slice.data += ranges[0].first;
+
+            auto partial = make_head(full);
+            partial->set_file_body(slice, content_type);
+            partial->set_header("Content-Range", content_range(ranges[0], body.size()));
+            return partial;
+        }
+
+        std::vector<std::string> parts;
+        parts.reserve(ranges.size());
+        for (const auto& range : ranges) {
+            parts.emplace_back(body.substr(range.first, range.length()));
+        }
+        return make_partial(full, body.size(), ranges, std::move(parts));
+    }
+
+    HttpResponsePtr make_partial(const HttpResponse& head, size_t length, const std::vector<ByteRange>& ranges,
+                                 std::vector<std::string>&& parts) {
+        std::string content_type = head.get_header("Content-Type", "application/octet-stream");
+        auto partial = make_head(head);
+
+        if (ranges.size() == 1) {
+            partial->set_body(std::move(parts[0]), content_type);
+            partial->set_header("Content-Range", content_range(ranges[0], length));
+            return partial;
+        }
+
+        std::string boundary = make_boundary();
+        size_t size = 0;
+        for (const auto& part : parts) {
+            size += part.size() + boundary.size() + content_type.size() + 96;
+        }
+
+        std::string body;
+        body.reserve(size);
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            body += "\r\n--" + boundary + "\r\n";
+            body += "Content-Type: " + content_type + "\r\n";
+            body += "Content-Range: " + content_range(ranges[i], length) + "\r\n\r\n";
+            body += parts[i];
+        }
+        body += "\r\n--" + boundary + "--\r\n";
+
+        partial->set_body(std::move(body), "multipart/byteranges; boundary=" + boundary);
+        return partial;
+    }
+
+    HttpResponsePtr make_unsatisfiable(size_t length) {
+        auto response = std::make_shared<HttpResponse>(HttpStatus::RANGE_NOT_SATISFIABLE);
+        response->set_header("Content-Range", "bytes */" + std::to_string(length));
+        response->set_body("Range Not Satisfiable", "text/plain");
+        return response;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ResponseHandler.h"
+
+/**
+ * HTTP range helpers
+ * Parsing of Range headers and construction of 206 / 416 responses,
+ * with single ranges of file-backed bodies kept as file regions
+ */
+namespace HttpRange {
+    /**
+     * Inclusive byte range of a representation
+     */
+    struct ByteRange {
+        size_t first = 0;
+        size_t last = 0;
+
+        size_t length() const { return last - first + 1; }
+    };
+
+    enum class ParseResult {
+        IGNORED,        // No usable Range header, send the full response
+        SATISFIABLE,    // At least one range overlaps the representation
+        UNSATISFIABLE   // Valid header but no range overlaps, send 416
+    };
+
+    /**
+     * Parse a Range header against a representation length
+     * Invalid headers and requests for too many ranges are ignored
+     * @param header Value of the Range header, e.g. "bytes=0-99,-500"
+     * @param length Size of the full representation
+     * @param ranges Output ranges, clamped to the representation
+     * @return Whether and how the ranges can be served
+     */
+    ParseResult parse(const std::string& header, size_t length, std::vector<ByteRange>& ranges);
+
+    /**
+     * Build a 206 response from a full response
+     * @param full The full 200 response
+     * @param ranges Satisfiable ranges from parse()
+     * @return Single-part or multipart/byteranges response
+     */
+    HttpResponsePtr make_partial(const HttpResponse& full, const std::vector<ByteRange>& ranges);
+
+    /**
+     * Build a 206 response from separately fetched range contents
+     * @param head Response whose status line and headers describe the full representation
+     * @param length Size of the full representation
+     * @param ranges Satisfiable ranges from parse()
+     * @param parts Content of each range, in the same order
+     * @return Single-part or multipart/byteranges response
+     */
+    HttpResponsePtr make_partial(const HttpResponse& head, size_t length, const std::vector<ByteRange>& ranges,
+                                 std::vector<std::string>&& parts);
+
+    /**
+     * Build a 416 response
+     * @param length Size of the full representation
+     * @return Range Not Satisfiable response
+     */
+    HttpResponsePtr make_unsatisfiable(size_t length);
+}
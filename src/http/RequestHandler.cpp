@@ -56,6 +56,18 @@ void HttpRequest::set_header(const std::string& name, const std::string& value)
     header_names_[lowercase_name] = name;
 }
 
+void HttpRequest::set_method(const std::string& method) {
+    method_ = method;
+}
+
+void HttpRequest::remove_header(const std::string& name) {
+    std::string lowercase_name = name;
+    std::transform(lowercase_name.begin(), lowercase_name.end(), lowercase_name.begin(), ::tolower);
+    
+    headers_.erase(lowercase_name);
+    header_names_.erase(lowercase_name);
+}
+
 void HttpRequest::set_body(const std::string& body) {
     body_ = body;
 }
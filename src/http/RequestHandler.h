@@ -36,6 +36,12 @@ public:
      */
     std::string get_header(const std::string& name, const std::string& default_value = "") const;
     
+    /**
+     * Change the request method
+     * @param method HTTP method (GET, POST, etc.)
+     */
+    void set_method(const std::string& method);
+    
     /**
      * Add or update a header
      * @param name Header name
@@ -43,6 +49,12 @@ public:
      */
     void set_header(const std::string& name, const std::string& value);
     
+    /**
+     * Remove a header if present
+     * @param name Header name (case-insensitive)
+     */
+    void remove_header(const std::string& name);
+    
     /**
      * Set the request body
      * @param body Request body content
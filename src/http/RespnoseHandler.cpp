@@ -42,14 +42,118 @@ void HttpResponse::set_header(const std::string& name, const std::string& value)
     headers_[name] = value;
 }
 
+void HttpResponse::remove_header(const std::string& name) {
+    std::string lower_name = name;
+    std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
+    
+    for (auto it = headers_.begin(); it != headers_.end();) {
+        std::string header_name = it->first;
+        std::transform(header_name.begin(), header_name.end(), header_name.begin(), ::tolower);
+        
+        if (header_name == lower_name) {
+            it = headers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void HttpResponse::set_body(const std::string& body, const std::string& content_type) {
     body_ = body;
+    file_body_ = FileBody();
     
     // Set content type and length headers
     headers_["Content-Type"] = content_type;
     headers_["Content-Length"] = std::to_string(body.size());
 }
 
+void HttpResponse::set_body(std::string&& body, const std::string& content_type) {
+    body_ = std::move(body);
+    file_body_ = FileBody();
+    
+    // Set content type and length headers
+    headers_["Content-Type"] = content_type;
+    headers_["Content-Length"] = std::to_string(body_.size());
+}
+
+void HttpResponse::set_file_body(const FileBody& body, const std::string& content_type) {
+    body_.clear();
+    file_body_ = body;
+    
+    // Set content type and length headers
+    headers_["Content-Type"] = content_type;
+    headers_["Content-Length"] = std::to_string(body.length);
+}
+
+const FileBody* HttpResponse::file_body() const {
+    return file_body_.fd >= 0 ? &file_body_ : nullptr;
+}
+
+void HttpResponse::strip_body() {
+    body_.clear();
+    file_body_ = FileBody();
+}
+
+void HttpResponse::add_vary(const std::string& name) {
+    std::string vary = get_header("Vary");
+    std::string lower_name = name;
+    std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(), ::tolower);
+    
+    size_t pos = 0;
+    while (pos <= vary.size()) {
+        size_t comma = vary.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = vary.size();
+        }
+        
+        std::string listed = vary.substr(pos, comma - pos);
+        listed.erase(0, listed.find_first_not_of(" \t"));
+        listed.erase(listed.find_last_not_of(" \t") + 1);
+        std::transform(listed.begin(), listed.end(), listed.begin(), ::tolower);
+        if (listed == "*" || listed == lower_name) {
+            return;
+        }
+        pos = comma + 1;
+    }
+    
+    // Backends may send the header in any case, keep a single one
+    remove_header("Vary");
+    headers_["Vary"] = vary.find_first_not_of(" \t") == std::string::npos ? name : vary + ", " + name;
+}
+
+std::string_view HttpResponse::body_view() const {
+    if (file_body_.fd >= 0) {
+        return std::string_view(file_body_.data, file_body_.length);
+    }
+    return body_;
+}
+
+void HttpResponse::set_stream_encoding(const std::string& encoding, int level) {
+    stream_encoding_ = encoding;
+    stream_level_ = level;
+    
+    remove_header("Content-Length");
+    headers_["Content-Encoding"] = encoding;
+    headers_["Transfer-Encoding"] = "chunked";
+    add_vary("Accept-Encoding");
+}
+
+const std::string& HttpResponse::stream_encoding() const {
+    return stream_encoding_;
+}
+
+int HttpResponse::stream_level() const {
+    return stream_level_;
+}
+
+void HttpResponse::set_header_block(std::shared_ptr<const std::string> block) {
+    header_block_ = std::move(block);
+}
+
+const std::shared_ptr<const std::string>& HttpResponse::header_block() const {
+    return header_block_;
+}
+
 std::string HttpResponse::get_header(const std::string& name, const std::string& default_value) const {
     // Case-insensitive header lookup
     std::string lower_name = name;
@@ -67,7 +171,7 @@ std::string HttpResponse::get_header(const std::string& name, const std::string&
     return default_value;
 }
 
-std::string HttpResponse::to_string() const {
+std::string HttpResponse::head_string() const {
     std::ostringstream ss;
     
     // Status line
@@ -77,14 +181,23 @@ std::string HttpResponse::to_string() const {
     for (const auto& header : headers_) {
         ss << header.first << ": " << header.second << "\r\n";
     }
+    if (header_block_) {
+        ss << *header_block_;
+    }
     
     // Empty line separating headers from body
     ss << "\r\n";
     
+    return ss.str();
+}
+
+std::string HttpResponse::to_string() const {
+    std::string out = head_string();
+    
     // Body
-    ss << body_;
+    out.append(body_view());
     
-    return ss.str();
+    return out;
 }
 
 std::string HttpResponse::get_status_message(HttpStatus status) const {
@@ -93,16 +206,20 @@ std::string HttpResponse::get_status_message(HttpStatus status) const {
         case HttpStatus::CREATED: return "Created";
         case HttpStatus::ACCEPTED: return "Accepted";
         case HttpStatus::NO_CONTENT: return "No Content";
+        case HttpStatus::PARTIAL_CONTENT: return "Partial Content";
         case HttpStatus::MOVED_PERMANENTLY: return "Moved Permanently";
         case HttpStatus::FOUND: return "Found";
         case HttpStatus::SEE_OTHER: return "See Other";
         case HttpStatus::NOT_MODIFIED: return "Not Modified";
         case HttpStatus::TEMPORARY_REDIRECT: return "Temporary Redirect";
+        case HttpStatus::PERMANENT_REDIRECT: return "Permanent Redirect";
         case HttpStatus::BAD_REQUEST: return "Bad Request";
         case HttpStatus::UNAUTHORIZED: return "Unauthorized";
         case HttpStatus::FORBIDDEN: return "Forbidden";
         case HttpStatus::NOT_FOUND: return "Not Found";
         case HttpStatus::METHOD_NOT_ALLOWED: return "Method Not Allowed";
+        case HttpStatus::GONE: return "Gone";
+        case HttpStatus::RANGE_NOT_SATISFIABLE: return "Range Not Satisfiable";
         case HttpStatus::TOO_MANY_REQUESTS: return "Too Many Requests";
         case HttpStatus::INTERNAL_SERVER_ERROR: return "Internal Server Error";
         case HttpStatus::NOT_IMPLEMENTED: return "Not Implemented";
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <memory>
 
@@ -12,16 +13,20 @@ enum class HttpStatus {
     CREATED = 201,
     ACCEPTED = 202,
     NO_CONTENT = 204,
+    PARTIAL_CONTENT = 206,
     MOVED_PERMANENTLY = 301,
     FOUND = 302,
     SEE_OTHER = 303,
     NOT_MODIFIED = 304,
     TEMPORARY_REDIRECT = 307,
+    PERMANENT_REDIRECT = 308,
     BAD_REQUEST = 400,
     UNAUTHORIZED = 401,
     FORBIDDEN = 403,
     NOT_FOUND = 404,
     METHOD_NOT_ALLOWED = 405,
+    GONE = 410,
+    RANGE_NOT_SATISFIABLE = 416,
     TOO_MANY_REQUESTS = 429,
     INTERNAL_SERVER_ERROR = 500,
     NOT_IMPLEMENTED = 501,
@@ -30,6 +35,18 @@ enum class HttpStatus {
     GATEWAY_TIMEOUT = 504
 };
 
+/**
+ * Response body held in a region of a file, e.g. a memory-mapped cache segment
+ * The owner keeps the file descriptor and the mapping alive while the body is in use
+ */
+struct FileBody {
+    int fd = -1;                         // file to send the body from
+    long long offset = 0;                // offset of the body in the file
+    size_t length = 0;                   // body size in bytes
+    const char* data = nullptr;          // mapped bytes of the body
+    std::shared_ptr<const void> owner;   // keeps fd and data valid
+};
+
 /**
  * HTTP Response class
  * Represents an HTTP response to send to a client
@@ -75,6 +92,18 @@ public:
      */
     void set_header(const std::string& name, const std::string& value);
     
+    /**
+     * Remove a response header
+     * @param name Header name (case-insensitive)
+     */
+    void remove_header(const std::string& name);
+    
+    /**
+     * Add a request header name to the Vary header, keeping the names already listed
+     * @param name Header name, not added again if listed (case-insensitive) or if Vary is "*"
+     */
+    void add_vary(const std::string& name);
+    
     /**
      * Set the response body
      * @param body Response body content
@@ -82,6 +111,70 @@ public:
      */
     void set_body(const std::string& body, const std::string& content_type = "text/plain");
     
+    /**
+     * Set the response body, taking ownership of the buffer
+     * @param body Response body content
+     * @param content_type Optional content type (default: text/plain)
+     */
+    void set_body(std::string&& body, const std::string& content_type = "text/plain");
+    
+    /**
+     * Set a body that lives in a file and can be sent without copying it
+     * @param body File region holding the body
+     * @param content_type Optional content type (default: text/plain)
+     */
+    void set_file_body(const FileBody& body, const std::string& content_type = "text/plain");
+    
+    /**
+     * Get the file-backed body
+     * @return File region or nullptr if the body is held in memory
+     */
+    const FileBody* file_body() const;
+    
+    /**
+     * Drop the body but keep Content-Length, as a response to HEAD does
+     */
+    void strip_body();
+    
+    /**
+     * Get the body bytes wherever they are held
+     * @return View of the in-memory or mapped body
+     */
+    std::string_view body_view() const;
+    
+    /**
+     * Have the body encoded while it is sent instead of up front
+     * The body stays unencoded in memory; the headers announce the encoding and
+     * chunked transfer, since the encoded length is only known once it is sent.
+     * Such responses must be written with HttpServer::write_response.
+     * @param encoding Content coding, e.g. "gzip"
+     * @param level Compression level for the coding
+     */
+    void set_stream_encoding(const std::string& encoding, int level);
+    
+    /**
+     * Get the content coding applied while sending
+     * @return The coding, or an empty string if the body is sent as it is
+     */
+    const std::string& stream_encoding() const;
+    
+    /**
+     * Get the compression level of the stream encoding
+     */
+    int stream_level() const;
+    
+    /**
+     * Append preformatted header lines when the head is serialized
+     * The block is shared, not copied, and is not visible to get_header.
+     * @param block Header lines, each ending with CRLF, or nullptr for none
+     */
+    void set_header_block(std::shared_ptr<const std::string> block);
+    
+    /**
+     * Get the preformatted header lines, may be nullptr
+     */
+    const std::shared_ptr<const std::string>& header_block() const;
+    
     /**
      * Get specific header value
      * @param name Header name (case-insensitive)
@@ -90,6 +183,12 @@ public:
      */
     std::string get_header(const std::string& name, const std::string& default_value = "") const;
     
+    /**
+     * Convert the status line and headers to a string ready to send
+     * @return Response head including the blank line that ends it
+     */
+    std::string head_string() const;
+    
     /**
      * Convert response to a string ready to send
      * @return String representation of the HTTP response
@@ -100,6 +199,10 @@ private:
     HttpStatus status_;
     std::map<std::string, std::string> headers_;
     std::string body_;
+    FileBody file_body_;  // used instead of body_ when fd is set
+    std::string stream_encoding_;  // coding applied to the body while sending
+    int stream_level_ = 0;
+    std::shared_ptr<const std::string> header_block_;  // preformatted lines appended to the head
     
     /**
      * Get the status message for a given status code
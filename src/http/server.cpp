@@ -1,16 +1,28 @@
 #include "server.h"
 #include "../util/logger.h"
+#include "../proxy/compression.h"
+#include "../security/ktlsStream.h"
+#include "../security/ssl.h"
 #include <iostream>
 #include <boost/bind.hpp>
 #include <thread>
 #include <sstream>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <sys/sendfile.h>
 
 HttpServer::HttpServer(boost::asio::io_context& io_context, int port, 
-                       std::shared_ptr<ProxyHandler> proxy_handler)
+                       std::shared_ptr<ProxyHandler> proxy_handler,
+                       SSLContextManager* ssl,
+                       std::chrono::milliseconds handshake_timeout)
     : io_context_(io_context),
       acceptor_(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
       proxy_handler_(proxy_handler),
-      running_(false) {
+      running_(false),
+      ssl_(ssl && ssl->is_enabled() ? ssl : nullptr),
+      handshake_timeout_(handshake_timeout) {
 }
 
 void HttpServer::start() {
@@ -21,7 +33,7 @@ void HttpServer::start() {
     
     running_ = true;
     start_accept();
-    Logger::getInstance().info("HTTP server started and listening on port " + 
+    Logger::getInstance().info(std::string(ssl_ ? "HTTPS" : "HTTP") + " server started and listening on port " + 
                                std::to_string(acceptor_.local_endpoint().port()), "HttpServer.cpp");
 }
 
@@ -40,9 +52,19 @@ void HttpServer::stop() {
         Logger::getInstance().error("Error closing acceptor: " + ec.message(), "HttpServer.cpp");
     }
     
+    if (ssl_) {
+        Logger::getInstance().info("TLS handshakes: " + std::to_string(handshake_metrics_.completed.load()) +
+                                   " completed (" + std::to_string(handshake_metrics_.resumed.load()) + " resumed, " +
+                                   std::to_string(handshake_metrics_.ktls.load()) + " kTLS), " + std::to_string(handshake_metrics_.failed.load()) + " failed, " +
+                                   std::to_string(handshake_metrics_.timed_out.load()) + " timed out", "HttpServer.cpp");
+    }
     Logger::getInstance().info("HTTP server stopped", "HttpServer.cpp");
 }
 
+const HandshakeMetrics& HttpServer::handshake_metrics() const {
+    return handshake_metrics_;
+}
+
 void HttpServer::start_accept() {
     if (!running_) {
         return;
@@ -60,11 +82,13 @@ void HttpServer::handle_accept(std::shared_ptr<boost::asio::ip::tcp::socket> soc
                               const boost::system::error_code& error) {
     if (error) {
         Logger::getInstance().error("Error accepting connection: " + error.message(), "HttpServer.cpp");
+    } else if (ssl_) {
+        start_handshake(socket);
     } else {
         // Handle the connection in a separate thread
         std::thread([this, socket]() {
             try {
-                handle_connection(socket);
+                handle_connection(*socket);
             } catch (const std::exception& e) {
                 Logger::getInstance().error("Exception handling connection: " + std::string(e.what()), "HttpServer.cpp");
             }
@@ -75,12 +99,145 @@ void HttpServer::handle_accept(std::shared_ptr<boost::asio::ip::tcp::socket> soc
     start_accept();
 }
 
-void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket> socket) {
+void HttpServer::start_handshake(std::shared_ptr<boost::asio::ip::tcp::socket> socket) {
+    auto context = ssl_->get_context();
+    
+    // The timer and the handshake share a strand, so the timeout never races the completion
+    auto strand = boost::asio::make_strand(io_context_);
+    auto timer = std::make_shared<boost::asio::steady_timer>(strand, handshake_timeout_);
+    auto state = std::make_shared<HandshakeState>();
+    
+    // The streams' SSL objects hold their own reference to the context, reloads do not affect them
+    if (ssl_->is_ktls_enabled()) {
+        std::shared_ptr<KtlsStream> stream;
+        try {
+            stream = std::make_shared<KtlsStream>(std::move(*socket), context->native_handle());
+        } catch (const std::exception& e) {
+            Logger::getInstance().error("Cannot create TLS stream: " + std::string(e.what()), "HttpServer.cpp");
+            return;
+        }
+        
+        boost::asio::dispatch(strand, [this, stream, strand, timer, state]() {
+            start_handshake_timer(stream, timer, state);
+            continue_ktls_handshake(stream, strand, timer, state);
+        });
+        return;
+    }
+    
+    std::shared_ptr<TlsStream> stream;
+    try {
+        stream = std::make_shared<TlsStream>(std::move(*socket), *context);
+    } catch (const std::exception& e) {
+        Logger::getInstance().error("Cannot create TLS stream: " + std::string(e.what()), "HttpServer.cpp");
+        return;
+    }
+    
+    boost::asio::dispatch(strand, [this, stream, strand, timer, state]() {
+        start_handshake_timer(stream, timer, state);
+        stream->async_handshake(boost::asio::ssl::stream_base::server, boost::asio::bind_executor(strand,
+            [this, stream, timer, state](const boost::system::error_code& error) {
+                complete_handshake(stream, error, *timer, *state);
+            }));
+    });
+}
+
+void HttpServer::continue_ktls_handshake(std::shared_ptr<KtlsStream> stream, Strand strand,
+                                         std::shared_ptr<boost::asio::steady_timer> timer,
+                                         std::shared_ptr<HandshakeState> state) {
+    if (state->timed_out) {
+        complete_handshake(stream, boost::asio::error::timed_out, *timer, *state);
+        return;
+    }
+    
+    KtlsStream::HandshakeStep step = stream->handshake_step();
+    if (step == KtlsStream::HandshakeStep::DONE) {
+        complete_handshake(stream, boost::system::error_code(), *timer, *state);
+        return;
+    }
+    if (step == KtlsStream::HandshakeStep::FAILED) {
+        complete_handshake(stream, boost::asio::error::no_protocol_option, *timer, *state);
+        return;
+    }
+    
+    auto wait = step == KtlsStream::HandshakeStep::WANT_READ ? boost::asio::ip::tcp::socket::wait_read
+                                                             : boost::asio::ip::tcp::socket::wait_write;
+    stream->lowest_layer().async_wait(wait, boost::asio::bind_executor(strand,
+        [this, stream, strand, timer, state](const boost::system::error_code& error) {
+            if (error) {
+                complete_handshake(stream, error, *timer, *state);
+            } else {
+                continue_ktls_handshake(stream, strand, timer, state);
+            }
+        }));
+}
+
+template <typename Stream>
+void HttpServer::start_handshake_timer(std::shared_ptr<Stream> stream, std::shared_ptr<boost::asio::steady_timer> timer,
+                                       std::shared_ptr<HandshakeState> state) {
+    timer->async_wait([this, stream, state](const boost::system::error_code& error) {
+        if (error || state->done) {
+            return;
+        }
+        // Closing the socket aborts the pending handshake
+        state->timed_out = true;
+        handshake_metrics_.timed_out++;
+        boost::system::error_code ignored;
+        stream->lowest_layer().close(ignored);
+    });
+}
+
+template <typename Stream>
+void HttpServer::complete_handshake(std::shared_ptr<Stream> stream, const boost::system::error_code& error,
+                                    boost::asio::steady_timer& timer, HandshakeState& state) {
+    state.done = true;
+    timer.cancel();
+    
+    if (error) {
+        if (!state.timed_out) {
+            handshake_metrics_.failed++;
+        }
+        Logger::getInstance().debug("TLS handshake failed: " + error.message(), "HttpServer.cpp");
+        boost::system::error_code ignored;
+        stream->lowest_layer().close(ignored);
+        return;
+    }
+    
+    auto elapsed = std::chrono::steady_clock::now() - state.started;
+    handshake_metrics_.completed++;
+    handshake_metrics_.total_us += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    if (SSL_session_reused(stream->native_handle())) {
+        handshake_metrics_.resumed++;
+    }
+    count_ktls(*stream);
+    
+    // Requests are served with blocking I/O, as for plaintext connections
+    std::thread([this, stream]() {
+        try {
+            handle_connection(*stream);
+        } catch (const std::exception& e) {
+            Logger::getInstance().error("Exception handling connection: " + std::string(e.what()), "HttpServer.cpp");
+        }
+    }).detach();
+}
+
+void HttpServer::count_ktls(TlsStream&) {
+    // Asio's memory BIOs keep TLS in user space
+}
+
+void HttpServer::count_ktls(KtlsStream& stream) {
+    if (stream.ktls_send()) {
+        handshake_metrics_.ktls++;
+    }
+}
+
+template <typename Stream>
+void HttpServer::handle_connection(Stream& stream) {
     try {
         boost::system::error_code error;
         
         // Get client info for logging
-        std::string client_ip = socket->remote_endpoint().address().to_string();
+        std::string client_ip = stream.lowest_layer().remote_endpoint().address().to_string();
         Logger::getInstance().debug("New connection from " + client_ip, "HttpServer.cpp");
         
         // Buffer for incoming data
@@ -92,7 +249,7 @@ void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket>
         
         // Read the initial headers
         do {
-            bytes_read = socket->read_some(boost::asio::buffer(buffer), error);
+            bytes_read = stream.read_some(boost::asio::buffer(buffer), error);
             
             if (error && error != boost::asio::error::would_block) {
                 throw boost::system::system_error(error);
@@ -110,7 +267,7 @@ void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket>
         HttpRequestPtr request = parse_request(data);
         if (!request) {
             Logger::getInstance().error("Failed to parse HTTP request", "HttpServer.cpp");
-            socket->close();
+            close_stream(stream);
             return;
         }
         
@@ -130,7 +287,7 @@ void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket>
                     
                     while (remaining > 0) {
                         size_t to_read = std::min(remaining, sizeof(body_buffer));
-                        size_t bytes = socket->read_some(boost::asio::buffer(body_buffer, to_read), error);
+                        size_t bytes = stream.read_some(boost::asio::buffer(body_buffer, to_read), error);
                         
                         if (error && error != boost::asio::error::would_block) {
                             throw boost::system::system_error(error);
@@ -155,8 +312,8 @@ void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket>
             response->set_body("WebSocket connections should be made to the WebSocket port", "text/plain");
             
             std::string response_str = response->to_string();
-            boost::asio::write(*socket, boost::asio::buffer(response_str), error);
-            socket->close();
+            boost::asio::write(stream, boost::asio::buffer(response_str), error);
+            close_stream(stream);
             return;
         }
         
@@ -164,11 +321,10 @@ void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket>
         auto response = proxy_handler_->handle_request(request, client_ip);
         
         // Send the response
-        std::string response_str = response->to_string();
-        boost::asio::write(*socket, boost::asio::buffer(response_str), error);
+        write_response(stream, response, error);
         
         // Close the connection
-        socket->close();
+        close_stream(stream);
         
         Logger::getInstance().debug("Connection from " + client_ip + " handled successfully", "HttpServer.cpp");
     }
@@ -181,19 +337,160 @@ void HttpServer::handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket>
             
             std::string response_str = response->to_string();
             boost::system::error_code error;
-            boost::asio::write(*socket, boost::asio::buffer(response_str), error);
-            socket->close();
+            boost::asio::write(stream, boost::asio::buffer(response_str), error);
+            close_stream(stream);
         }
         catch (...) {
             // If we can't send an error response, just close the socket
             try {
-                socket->close();
+                stream.lowest_layer().close();
             }
             catch (...) {}
         }
     }
 }
 
+template <typename Stream>
+void HttpServer::write_response(Stream& stream, const HttpResponsePtr& response,
+                                boost::system::error_code& error) {
+    if (!response->stream_encoding().empty()) {
+        write_encoded_response(stream, response, error);
+        return;
+    }
+    
+    const FileBody* file = response->file_body();
+    if (!file) {
+        std::string response_str = response->to_string();
+        boost::asio::write(stream, boost::asio::buffer(response_str), error);
+        return;
+    }
+    
+    std::string head = response->head_string();
+    boost::asio::write(stream, boost::asio::buffer(head), error);
+    if (!error) {
+        write_file_body(stream, *file, error);
+    }
+}
+
+void HttpServer::write_file_body(boost::asio::ip::tcp::socket& socket, const FileBody& file,
+                                 boost::system::error_code& error) {
+    // Let the kernel copy the body straight from the file
+    off_t offset = static_cast<off_t>(file.offset);
+    size_t remaining = file.length;
+    while (!error && remaining > 0) {
+        ssize_t sent = ::sendfile(socket.native_handle(), file.fd, &offset, remaining);
+        if (sent > 0) {
+            remaining -= static_cast<size_t>(sent);
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            socket.wait(boost::asio::ip::tcp::socket::wait_write, error);
+        } else {
+            error = boost::system::error_code(sent < 0 ? errno : EIO, boost::system::system_category());
+        }
+    }
+}
+
+template <typename Stream>
+void HttpServer::write_file_body(Stream& stream, const FileBody& file, boost::system::error_code& error) {
+    // Encrypted streams need the bytes in user space, the mapping already holds them
+    boost::asio::write(stream, boost::asio::buffer(file.data, file.length), error);
+}
+
+void HttpServer::write_file_body(KtlsStream& stream, const FileBody& file, boost::system::error_code& error) {
+    if (stream.ktls_send()) {
+        // The kernel encrypts while it copies from the file
+        size_t sent = 0;
+        while (!error && sent < file.length) {
+            size_t count = stream.sendfile(file.fd, file.offset + static_cast<long long>(sent), file.length - sent, error);
+            if (count == 0 && !error) {
+                error = boost::asio::error::eof;
+            }
+            sent += count;
+        }
+        return;
+    }
+    
+    // No kTLS for this connection's cipher, write from the mapping instead
+    boost::asio::write(stream, boost::asio::buffer(file.data, file.length), error);
+}
+
+void HttpServer::close_stream(boost::asio::ip::tcp::socket& socket) {
+    boost::system::error_code ignored;
+    socket.close(ignored);
+}
+
+void HttpServer::close_stream(KtlsStream& stream) {
+    boost::system::error_code ignored;
+    stream.lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_receive, ignored);
+    stream.shutdown(ignored);
+    stream.lowest_layer().close(ignored);
+}
+
+void HttpServer::close_stream(TlsStream& stream) {
+    // With the receive side shut down the close_notify is sent without waiting for the client's reply
+    boost::system::error_code ignored;
+    stream.lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_receive, ignored);
+    stream.shutdown(ignored);
+    stream.lowest_layer().close(ignored);
+}
+
+template <typename Stream>
+void HttpServer::write_encoded_response(Stream& stream, const HttpResponsePtr& response,
+                                        boost::system::error_code& error) {
+    // Input is fed to the compressor in slices so output goes out while the rest is compressed
+    const size_t INPUT_CHUNK = 65536;
+    
+    auto encoder = Compression::make_stream(response->stream_encoding(), response->stream_level());
+    if (!encoder) {
+        error = boost::system::error_code(EINVAL, boost::system::system_category());
+        return;
+    }
+    
+    std::string head = response->head_string();
+    boost::asio::write(stream, boost::asio::buffer(head), error);
+    
+    std::string_view body = response->body_view();
+    std::string output;
+    
+    auto send_chunk = [&stream, &error, &output]() {
+        if (error || output.empty()) {
+            return;
+        }
+        char size_line[24];
+        int length = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", output.size());
+        std::array<boost::asio::const_buffer, 3> buffers = {
+            boost::asio::buffer(size_line, static_cast<size_t>(length)),
+            boost::asio::buffer(output),
+            boost::asio::buffer("\r\n", 2)
+        };
+        boost::asio::write(stream, buffers, error);
+        output.clear();
+    };
+    
+    for (size_t pos = 0; !error && pos < body.size(); pos += INPUT_CHUNK) {
+        size_t size = std::min(INPUT_CHUNK, body.size() - pos);
+        if (!encoder->write(body.data() + pos, size, output)) {
+            error = boost::system::error_code(EIO, boost::system::system_category());
+            return;
+        }
+        send_chunk();
+    }
+    
+    if (error || !encoder->finish(output)) {
+        // The client sees a truncated chunked body, which it cannot mistake for a complete one
+        if (!error) {
+            error = boost::system::error_code(EIO, boost::system::system_category());
+        }
+        return;
+    }
+    send_chunk();
+    
+    if (!error) {
+        boost::asio::write(stream, boost::asio::buffer("0\r\n\r\n", 5), error);
+    }
+}
+
 HttpRequestPtr HttpServer::parse_request(const std::string& data) {
     std::istringstream stream(data);
     std::string line;
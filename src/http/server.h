@@ -1,6 +1,10 @@
 #pragma once
 
+#include <atomic>
 #include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include "RequestHandler.h"
@@ -9,10 +13,28 @@
 
 // Forward declarations
 class ProxyHandler;
+class SSLContextManager;
+class KtlsStream;
+
+/**
+ * TLS handshake counters, kept apart from request handling so slow or
+ * failing handshakes can be told from slow backends
+ */
+struct HandshakeMetrics {
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> resumed{0};    // completed handshakes that resumed a session
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> timed_out{0};
+    std::atomic<uint64_t> ktls{0};       // completed handshakes whose sends the kernel encrypts
+    std::atomic<uint64_t> total_us{0};  // time spent in completed handshakes
+};
 
 /**
  * HTTP Server class
- * Handles incoming HTTP connections, parses requests, and sends responses
+ * Handles incoming HTTP connections, parses requests, and sends responses.
+ * With an SSL context TLS is terminated here: the handshake runs
+ * asynchronously on the io_context under a timeout, and only connections
+ * that complete it get a connection thread.
  */
 class HttpServer
 {
@@ -22,9 +44,13 @@ public:
      * @param io_context Boost asio io_context
      * @param port Port to listen on
      * @param proxy_handler Handler for proxying requests
+     * @param ssl Context manager to terminate TLS with, nullptr for plaintext
+     * @param handshake_timeout How long a client may take to complete the TLS handshake
      */
     HttpServer(boost::asio::io_context &io_context, int port,
-               std::shared_ptr<ProxyHandler> proxy_handler);
+               std::shared_ptr<ProxyHandler> proxy_handler,
+               SSLContextManager *ssl = nullptr,
+               std::chrono::milliseconds handshake_timeout = std::chrono::milliseconds(10000));
 
     /**
      * Start the server
@@ -36,11 +62,31 @@ public:
      */
     void stop();
 
+    /**
+     * Get the TLS handshake counters
+     */
+    const HandshakeMetrics &handshake_metrics() const;
+
 private:
+    using TlsStream = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+    using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    /**
+     * Progress of one TLS handshake, only touched on the handshake's strand
+     */
+    struct HandshakeState {
+        bool done = false;
+        bool timed_out = false;
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    };
+
     boost::asio::io_context &io_context_;
     boost::asio::ip::tcp::acceptor acceptor_;
     std::shared_ptr<ProxyHandler> proxy_handler_;
     bool running_;
+    SSLContextManager *ssl_;
+    std::chrono::milliseconds handshake_timeout_;
+    HandshakeMetrics handshake_metrics_;
 
     /**
      * Start accepting connections
@@ -55,11 +101,95 @@ private:
     void handle_accept(std::shared_ptr<boost::asio::ip::tcp::socket> socket,
                        const boost::system::error_code &error);
 
+    /**
+     * Run the TLS handshake on an accepted socket, then hand the connection to a thread
+     * @param socket Socket for the new connection
+     */
+    void start_handshake(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+
+    /**
+     * Advance a kTLS handshake and wait for the socket until it is done
+     */
+    void continue_ktls_handshake(std::shared_ptr<KtlsStream> stream, Strand strand,
+                                 std::shared_ptr<boost::asio::steady_timer> timer,
+                                 std::shared_ptr<HandshakeState> state);
+
+    /**
+     * Close the connection if the handshake is not done in time
+     */
+    template <typename Stream>
+    void start_handshake_timer(std::shared_ptr<Stream> stream, std::shared_ptr<boost::asio::steady_timer> timer,
+                               std::shared_ptr<HandshakeState> state);
+
+    /**
+     * Record a finished handshake and hand a successful connection to a thread
+     */
+    template <typename Stream>
+    void complete_handshake(std::shared_ptr<Stream> stream, const boost::system::error_code &error,
+                            boost::asio::steady_timer &timer, HandshakeState &state);
+
+    /**
+     * Count connections whose sends the kernel encrypts
+     */
+    void count_ktls(TlsStream &stream);
+    void count_ktls(KtlsStream &stream);
+
     /**
      * Handle a new connection
-     * @param socket Socket for the connection
+     * @param stream Plain socket or TLS stream for the connection
+     */
+    template <typename Stream>
+    void handle_connection(Stream &stream);
+
+    /**
+     * Send a response, sending bodies held in a file from the file and
+     * encoding the body chunk by chunk when it has a stream encoding
+     * @param stream Plain socket or TLS stream for the connection
+     * @param response The response to send
+     * @param error Set if sending failed
+     */
+    template <typename Stream>
+    void write_response(Stream &stream, const HttpResponsePtr &response,
+                        boost::system::error_code &error);
+
+    /**
+     * Send a response whose body is compressed while it is sent
+     * @param stream Plain socket or TLS stream for the connection
+     * @param response The response to send
+     * @param error Set if sending failed
+     */
+    template <typename Stream>
+    void write_encoded_response(Stream &stream, const HttpResponsePtr &response,
+                                boost::system::error_code &error);
+
+    /**
+     * Send a file-backed body with sendfile
+     */
+    void write_file_body(boost::asio::ip::tcp::socket &socket, const FileBody &file,
+                         boost::system::error_code &error);
+
+    /**
+     * Send a file-backed body from its mapping, for streams that must see the bytes
+     */
+    template <typename Stream>
+    void write_file_body(Stream &stream, const FileBody &file, boost::system::error_code &error);
+
+    /**
+     * Send a file-backed body with SSL_sendfile when the kernel encrypts
+     * the connection, from its mapping otherwise
+     */
+    void write_file_body(KtlsStream &stream, const FileBody &file, boost::system::error_code &error);
+
+    /**
+     * Close a connection
+     */
+    void close_stream(boost::asio::ip::tcp::socket &socket);
+
+    /**
+     * Send the TLS close_notify and close a connection
      */
-    void handle_connection(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+    void close_stream(TlsStream &stream);
+    void close_stream(KtlsStream &stream);
 
     /**
      * Parse an HTTP request from data
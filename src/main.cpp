@@ -6,18 +6,27 @@
 #include <signal.h>
 
 #include "proxy/proxyHandler.h"
+#include "security/ssl.h"
 // #include "websocket/ws_server.h"
 #include "util/logger.h"
 
 // flag for shutdown
 volatile bool running = true;
 
+// flag for a certificate reload requested with SIGHUP
+volatile sig_atomic_t reload_requested = 0;
+
 // signal handler for graceful shutdown
 void signal_handler(int signal) {
     Logger::getInstance().info("Received signal " + std::to_string(signal) + ", shutting down...", "main.cpp");
     running = false;
 }
 
+// signal handler for certificate reload
+void reload_handler(int) {
+    reload_requested = 1;
+}
+
 int main(int argc, char* argv[]) {
     try {
 
@@ -34,6 +43,7 @@ int main(int argc, char* argv[]) {
         // register signal handlers for graceful shutdown
         signal(SIGINT, signal_handler);
         signal(SIGTERM, signal_handler);
+        signal(SIGHUP, reload_handler);
 
         // load configuration
         Config config;
@@ -51,8 +61,12 @@ int main(int argc, char* argv[]) {
         // smart shared pointer 
         auto proxy_handler = std::make_shared<ProxyHandler>(config, io_context);
         
+        // TLS is terminated on the main listener when enabled
+        SSLContextManager ssl_context(config);
+        
         // initialize HTTP server
-        HttpServer HttpServer(io_context, config.get_http_port(), proxy_handler);
+        HttpServer HttpServer(io_context, config.get_http_port(), proxy_handler, &ssl_context,
+                              std::chrono::milliseconds(config.get_ssl_handshake_timeout_ms()));
         
         // Initialize WebSocket server if enabled
         // std::unique_ptr<WebSocketServer> ws_server;
@@ -97,6 +111,15 @@ int main(int argc, char* argv[]) {
         // Wait for shutdown signal
         while (running) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
+            
+            // Certificates are reloaded here, off the request path
+            if (reload_requested) {
+                reload_requested = 0;
+                Logger::getInstance().info("Received SIGHUP, reloading certificates...", "main.cpp");
+                ssl_context.reload();
+            } else {
+                ssl_context.reload_if_changed();
+            }
         }
 
         // Graceful shutdown
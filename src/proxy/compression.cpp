@@ -0,0 +1,458 @@
+#include "compression.h"
+#include "../util/Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#ifdef PROXY_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef PROXY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+    const size_t OUTPUT_CHUNK = 16384;
+
+    std::string trim(const std::string& value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
+
+    /**
+     * Parse the q parameter of an Accept-Encoding element, defaulting to 1
+     */
+    double parse_quality(const std::string& params) {
+        size_t pos = 0;
+        while (pos < params.size()) {
+            size_t semicolon = params.find(';', pos);
+            if (semicolon == std::string::npos) {
+                semicolon = params.size();
+            }
+            std::string param = trim(params.substr(pos, semicolon - pos));
+            pos = semicolon + 1;
+
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                char* end = nullptr;
+                double q = std::strtod(param.c_str() + 2, &end);
+                if (end == param.c_str() + 2) {
+                    return 0.0;  // Malformed weights never select a coding
+                }
+                return std::min(1.0, std::max(0.0, q));
+            }
+        }
+        return 1.0;
+    }
+
+#ifdef PROXY_HAVE_BROTLI
+    /**
+     * Brotli compressor
+     * The encoder has no reset call, so every stream gets a fresh instance.
+     */
+    class BrotliStream : public CompressionStream {
+    public:
+        explicit BrotliStream(int level) : state_(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr)) {
+            if (state_) {
+                BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(level));
+                BrotliEncoderSetParameter(state_, BROTLI_PARAM_MODE, BROTLI_MODE_TEXT);
+            }
+        }
+
+        ~BrotliStream() override {
+            if (state_) {
+                BrotliEncoderDestroyInstance(state_);
+            }
+        }
+
+        bool write(const char* data, size_t size, std::string& out) override {
+            return compress(BROTLI_OPERATION_PROCESS, data, size, out);
+        }
+
+        bool finish(std::string& out) override {
+            return compress(BROTLI_OPERATION_FINISH, nullptr, 0, out);
+        }
+
+    private:
+        BrotliEncoderState* state_;
+
+        bool compress(BrotliEncoderOperation operation, const char* data, size_t size, std::string& out) {
+            if (!state_) {
+                return false;
+            }
+
+            const uint8_t* next_in = reinterpret_cast<const uint8_t*>(data);
+            size_t available_in = size;
+            do {
+                size_t used = out.size();
+                out.resize(used + OUTPUT_CHUNK);
+                uint8_t* next_out = reinterpret_cast<uint8_t*>(&out[used]);
+                size_t available_out = OUTPUT_CHUNK;
+
+                if (!BrotliEncoderCompressStream(state_, operation, &available_in, &next_in,
+                                                 &available_out, &next_out, nullptr)) {
+                    out.resize(used);
+                    return false;
+                }
+                out.resize(used + OUTPUT_CHUNK - available_out);
+            } while (available_in > 0 || BrotliEncoderHasMoreOutput(state_) ||
+                     (operation == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(state_)));
+            return true;
+        }
+    };
+#endif
+
+#ifdef PROXY_HAVE_ZSTD
+    /**
+     * zstd compressor
+     * Like gzip, each thread reuses one compression context between streams.
+     */
+    class ZstdStream : public CompressionStream {
+    public:
+        explicit ZstdStream(int level) : context_(nullptr), owned_(false) {
+            thread_local Context thread_context;
+
+            if (thread_context.busy || !thread_context.cctx) {
+                context_ = new Context();
+                owned_ = true;
+            } else {
+                context_ = &thread_context;
+            }
+            context_->busy = true;
+
+            ok_ = context_->cctx &&
+                  !ZSTD_isError(ZSTD_CCtx_reset(context_->cctx, ZSTD_reset_session_only)) &&
+                  !ZSTD_isError(ZSTD_CCtx_setParameter(context_->cctx, ZSTD_c_compressionLevel, level));
+        }
+
+        ~ZstdStream() override {
+            if (owned_) {
+                delete context_;
+            } else {
+                context_->busy = false;
+            }
+        }
+
+        bool write(const char* data, size_t size, std::string& out) override {
+            return compress(ZSTD_e_continue, data, size, out);
+        }
+
+        bool finish(std::string& out) override {
+            return compress(ZSTD_e_end, nullptr, 0, out);
+        }
+
+    private:
+        struct Context {
+            ZSTD_CCtx* cctx = ZSTD_createCCtx();
+            bool busy = false;
+
+            ~Context() {
+                ZSTD_freeCCtx(cctx);
+            }
+        };
+
+        Context* context_;
+        bool owned_;
+        bool ok_ = false;
+
+        bool compress(ZSTD_EndDirective directive, const char* data, size_t size, std::string& out) {
+            if (!ok_) {
+                return false;
+            }
+
+            ZSTD_inBuffer input = { data, size, 0 };
+            size_t remaining;
+            do {
+                size_t used = out.size();
+                out.resize(used + OUTPUT_CHUNK);
+                ZSTD_outBuffer output = { &out[used], OUTPUT_CHUNK, 0 };
+
+                remaining = ZSTD_compressStream2(context_->cctx, &output, &input, directive);
+                out.resize(used + output.pos);
+                if (ZSTD_isError(remaining)) {
+                    ok_ = false;
+                    return false;
+                }
+            } while (input.pos < input.size || (directive == ZSTD_e_end && remaining > 0));
+            return true;
+        }
+    };
+#endif
+}
+
+/**
+ * A deflate context producing gzip output
+ */
+struct GzipStream::Context {
+    z_stream zs;
+    bool initialized = false;
+    bool busy = false;
+    int level = Z_DEFAULT_COMPRESSION;
+    
+    Context() {
+        memset(&zs, 0, sizeof(zs));
+    }
+    
+    ~Context() {
+        if (initialized) {
+            deflateEnd(&zs);
+        }
+    }
+    
+    /**
+     * Prepare the context for a new stream, reusing its allocations when possible
+     */
+    bool begin(int new_level) {
+        if (!initialized) {
+            if (deflateInit2(&zs, new_level, Z_DEFLATED, 15 | 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            initialized = true;
+            level = new_level;
+            return true;
+        }
+        
+        if (deflateReset(&zs) != Z_OK) {
+            return false;
+        }
+        // Changing the level right after a reset does not flush anything
+        if (new_level != level) {
+            if (deflateParams(&zs, new_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            level = new_level;
+        }
+        return true;
+    }
+};
+
+GzipStream::GzipStream(int level) : context_(nullptr), owned_(false), ok_(false) {
+    thread_local Context thread_context;
+    
+    if (thread_context.busy) {
+        context_ = new Context();
+        owned_ = true;
+    } else {
+        context_ = &thread_context;
+    }
+    context_->busy = true;
+    
+    ok_ = context_->begin(level);
+    if (!ok_) {
+        Logger::getInstance().error("Failed to initialize zlib", "Compression");
+    }
+}
+
+GzipStream::~GzipStream() {
+    if (owned_) {
+        delete context_;
+    } else {
+        context_->busy = false;
+    }
+}
+
+bool GzipStream::ok() const {
+    return ok_;
+}
+
+bool GzipStream::write(const char* data, size_t size, std::string& out) {
+    if (!ok_) {
+        return false;
+    }
+    
+    context_->zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    context_->zs.avail_in = static_cast<uInt>(size);
+    return deflate_into(Z_NO_FLUSH, out);
+}
+
+bool GzipStream::finish(std::string& out) {
+    if (!ok_) {
+        return false;
+    }
+    
+    context_->zs.next_in = nullptr;
+    context_->zs.avail_in = 0;
+    return deflate_into(Z_FINISH, out);
+}
+
+bool GzipStream::deflate_into(int flush, std::string& out) {
+    z_stream& zs = context_->zs;
+    
+    // Deflate straight into the output string, growing it a chunk at a time
+    int ret;
+    do {
+        size_t used = out.size();
+        out.resize(used + OUTPUT_CHUNK);
+        zs.next_out = reinterpret_cast<Bytef*>(&out[used]);
+        zs.avail_out = OUTPUT_CHUNK;
+        
+        ret = deflate(&zs, flush);
+        out.resize(used + OUTPUT_CHUNK - zs.avail_out);
+        
+        if (ret == Z_STREAM_ERROR) {
+            ok_ = false;
+            return false;
+        }
+    } while (zs.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    
+    return true;
+}
+
+std::string Compression::negotiate(const std::string& accept_encoding, const std::vector<std::string>& preferred) {
+    // Weights the client gave each coding, "*" standing for the ones it did not list
+    std::vector<std::pair<std::string, double>> weights;
+    size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        size_t comma = accept_encoding.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = accept_encoding.size();
+        }
+        std::string element = accept_encoding.substr(pos, comma - pos);
+        pos = comma + 1;
+        
+        size_t semicolon = element.find(';');
+        std::string coding = trim(element.substr(0, semicolon));
+        if (coding.empty()) {
+            continue;
+        }
+        std::transform(coding.begin(), coding.end(), coding.begin(), ::tolower);
+        if (coding == "x-gzip") {
+            coding = "gzip";
+        }
+        
+        double q = semicolon == std::string::npos ? 1.0 : parse_quality(element.substr(semicolon + 1));
+        weights.emplace_back(coding, q);
+    }
+    
+    std::string best;
+    double best_q = 0.0;
+    for (const auto& coding : preferred) {
+        if (!is_supported(coding)) {
+            continue;
+        }
+        
+        double q = 0.0;
+        bool listed = false;
+        for (const auto& weight : weights) {
+            if (weight.first == coding) {
+                q = weight.second;
+                listed = true;
+                break;
+            }
+        }
+        if (!listed) {
+            for (const auto& weight : weights) {
+                if (weight.first == "*") {
+                    q = weight.second;
+                    break;
+                }
+            }
+        }
+        
+        if (q > best_q) {
+            best = coding;
+            best_q = q;
+        }
+    }
+    return best;
+}
+
+bool Compression::is_supported(const std::string& encoding) {
+    if (encoding == "gzip") {
+        return true;
+    }
+#ifdef PROXY_HAVE_BROTLI
+    if (encoding == "br") {
+        return true;
+    }
+#endif
+#ifdef PROXY_HAVE_ZSTD
+    if (encoding == "zstd") {
+        return true;
+    }
+#endif
+    return false;
+}
+
+int Compression::default_level(const std::string& encoding) {
+    // Levels suited to compressing on the fly, not the slow maximum ratios
+    if (encoding == "br") {
+        return 5;
+    }
+    if (encoding == "zstd") {
+        return 3;
+    }
+    return Z_DEFAULT_COMPRESSION;
+}
+
+int Compression::adaptive_level(const std::string& encoding, int level, size_t body_size, double load) {
+    // Below this load compression is cheap enough to use the configured level
+    const double LIGHT_LOAD = 0.5;
+    const size_t LARGE_BODY = 1024 * 1024;
+    const int FASTEST_LEVEL = 1;
+    
+    if (encoding == "gzip" && level == Z_DEFAULT_COMPRESSION) {
+        level = 6;
+    }
+    if (level <= FASTEST_LEVEL) {
+        return level;  // Already as cheap as it gets (or a fast mode below it)
+    }
+    
+    if (load > LIGHT_LOAD) {
+        double pressure = std::min(1.0, (load - LIGHT_LOAD) / (1.0 - LIGHT_LOAD));
+        level -= static_cast<int>((level - FASTEST_LEVEL) * pressure + 0.5);
+    }
+    
+    // The ratio gained above these levels is not worth their cost on multi-megabyte bodies
+    if (body_size >= LARGE_BODY) {
+        level = std::min(level, encoding == "zstd" ? 3 : 4);
+    }
+    return std::max(level, FASTEST_LEVEL);
+}
+
+bool Compression::is_compressible(const std::string& content_type) {
+    // Only compress text-based content
+    return content_type.find("text/") != std::string::npos ||
+           content_type.find("application/json") != std::string::npos ||
+           content_type.find("application/javascript") != std::string::npos ||
+           content_type.find("application/xml") != std::string::npos ||
+           content_type.find("application/xhtml+xml") != std::string::npos;
+}
+
+std::unique_ptr<CompressionStream> Compression::make_stream(const std::string& encoding, int level) {
+    if (encoding == "gzip") {
+        return std::make_unique<GzipStream>(level);
+    }
+#ifdef PROXY_HAVE_BROTLI
+    if (encoding == "br") {
+        return std::make_unique<BrotliStream>(level);
+    }
+#endif
+#ifdef PROXY_HAVE_ZSTD
+    if (encoding == "zstd") {
+        return std::make_unique<ZstdStream>(level);
+    }
+#endif
+    return nullptr;
+}
+
+bool Compression::compress(const std::string& encoding, const std::string& input, std::string& output, int level) {
+    auto stream = make_stream(encoding, level);
+    if (!stream) {
+        return false;
+    }
+    
+    output.clear();
+    output.reserve(input.size() / 4 + 64);
+    return stream->write(input.data(), input.size(), output) && stream->finish(output);
+}
+
+bool Compression::gzip(const std::string& input, std::string& output, int level) {
+    return compress("gzip", input, output, level);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Incremental compressor for one response body
+ */
+class CompressionStream {
+public:
+    virtual ~CompressionStream() = default;
+    
+    /**
+     * Compress a chunk of input
+     * @param data Input bytes
+     * @param size Number of input bytes
+     * @param out Compressed bytes are appended here (may stay empty while the encoder buffers)
+     * @return False on an encoder error
+     */
+    virtual bool write(const char* data, size_t size, std::string& out) = 0;
+    
+    /**
+     * Flush the remaining output and end the stream
+     * @param out Compressed bytes are appended here
+     * @return False on an encoder error
+     */
+    virtual bool finish(std::string& out) = 0;
+};
+
+/**
+ * Streaming gzip compressor
+ * Each thread keeps one deflate context that is reset (deflateReset) between
+ * streams instead of being set up and torn down for every response. A stream
+ * started while the thread's context is in use gets a private context.
+ */
+class GzipStream : public CompressionStream {
+public:
+    /**
+     * Start a gzip stream
+     * @param level zlib compression level
+     */
+    explicit GzipStream(int level);
+    ~GzipStream() override;
+    
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+    
+    /**
+     * Check if the deflate context could be set up
+     */
+    bool ok() const;
+    
+    bool write(const char* data, size_t size, std::string& out) override;
+    bool finish(std::string& out) override;
+
+private:
+    struct Context;
+    
+    Context* context_;
+    bool owned_;  // private context, used when the thread's context is busy
+    bool ok_;
+    
+    bool deflate_into(int flush, std::string& out);
+};
+
+/**
+ * Compression helpers
+ * Content-coding negotiation and body compression for responses
+ */
+class Compression {
+public:
+    /**
+     * Pick the content coding for a response
+     * Codings are ranked by the client's q-values; ties go to the earlier
+     * entry in the preference list. Codings this build cannot produce are skipped.
+     * @param accept_encoding Value of the Accept-Encoding header
+     * @param preferred Codings the route offers, most preferred first
+     * @return The chosen coding, or an empty string for identity
+     */
+    static std::string negotiate(const std::string& accept_encoding, const std::vector<std::string>& preferred);
+    
+    /**
+     * Check if this build can produce a content coding
+     * @param encoding Coding name ("gzip", "br" or "zstd")
+     */
+    static bool is_supported(const std::string& encoding);
+    
+    /**
+     * Default compression level of a content coding
+     * @param encoding Coding name
+     */
+    static int default_level(const std::string& encoding);
+    
+    /**
+     * Pick a compression level for the current load
+     * Under light load the configured level is used. As the CPU approaches
+     * saturation the level moves towards the coding's fastest level, and large
+     * bodies are capped to a moderate level whatever the load.
+     * @param encoding Coding name
+     * @param level Configured compression level
+     * @param body_size Size of the body to compress
+     * @param load Busy share of the CPU, 1.0 meaning saturated
+     * @return The level to compress with
+     */
+    static int adaptive_level(const std::string& encoding, int level, size_t body_size, double load);
+    
+    /**
+     * Check if a content type is worth compressing
+     * @param content_type Value of the Content-Type header
+     * @return True for text-based content
+     */
+    static bool is_compressible(const std::string& content_type);
+    
+    /**
+     * Start an incremental compressor
+     * @param encoding Coding name
+     * @param level Compression level for the coding
+     * @return The compressor, or nullptr if the coding is not supported
+     */
+    static std::unique_ptr<CompressionStream> make_stream(const std::string& encoding, int level);
+    
+    /**
+     * Compress data in one go
+     * @param encoding Coding name
+     * @param input Data to compress
+     * @param output Compressed data
+     * @param level Compression level for the coding
+     * @return True if compression succeeded
+     */
+    static bool compress(const std::string& encoding, const std::string& input, std::string& output, int level);
+    
+    /**
+     * Compress data with gzip
+     * @param input Data to compress
+     * @param output Compressed data
+     * @param level zlib compression level
+     * @return True if compression succeeded
+     */
+    static bool gzip(const std::string& input, std::string& output, int level);
+};
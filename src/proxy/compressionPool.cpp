@@ -0,0 +1,67 @@
+#include "compressionPool.h"
+#include "compression.h"
+#include "../util/Logger.h"
+#include <future>
+
+CompressionPool::CompressionPool(size_t threads, size_t max_queue) : max_queue_(max_queue) {
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this]() { worker(); });
+    }
+    
+    Logger::getInstance().info("Compression pool started with " + std::to_string(threads) + " threads",
+                               "CompressionPool");
+}
+
+CompressionPool::~CompressionPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+CompressionPool::Result CompressionPool::compress(const std::string& encoding, const std::string& input,
+                                                  std::string& output, int level) {
+    // The caller waits for the result, so the task can work on its buffers directly
+    std::packaged_task<bool()> task([&encoding, &input, &output, level]() {
+        return Compression::compress(encoding, input, output, level);
+    });
+    std::future<bool> result = task.get_future();
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queue_.size() >= max_queue_) {
+            return Result::REJECTED;
+        }
+        queue_.emplace_back([&task]() { task(); });
+    }
+    work_available_.notify_one();
+    
+    return result.get() ? Result::COMPRESSED : Result::FAILED;
+}
+
+size_t CompressionPool::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void CompressionPool::worker() {
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;  // Stopping and drained
+            }
+            work = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        work();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Compression Pool class
+ * Dedicated threads for compressing large bodies, so the number of
+ * multi-megabyte compressions running at once is bounded by the pool size
+ * instead of by the number of open connections. The queue is bounded too:
+ * when it is full the CPU is already the bottleneck and the caller is told
+ * to send the body uncompressed.
+ */
+class CompressionPool {
+public:
+    enum class Result {
+        COMPRESSED,  // output holds the compressed body
+        FAILED,      // the encoder failed
+        REJECTED     // the queue was full, nothing was compressed
+    };
+    
+    /**
+     * Constructor
+     * @param threads Number of compression threads
+     * @param max_queue Largest number of bodies waiting for a thread
+     */
+    CompressionPool(size_t threads, size_t max_queue);
+    
+    /**
+     * Stops the threads once queued work is done
+     */
+    ~CompressionPool();
+    
+    CompressionPool(const CompressionPool&) = delete;
+    CompressionPool& operator=(const CompressionPool&) = delete;
+    
+    /**
+     * Compress a body on a pool thread and wait for the result
+     * @param encoding Content coding
+     * @param input Data to compress
+     * @param output Compressed data
+     * @param level Compression level for the coding
+     * @return Whether the body was compressed
+     */
+    Result compress(const std::string& encoding, const std::string& input, std::string& output, int level);
+    
+    /**
+     * Number of bodies waiting for a thread
+     */
+    size_t queued() const;
+
+private:
+    size_t max_queue_;
+    bool stopping_ = false;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::thread> threads_;
+    
+    /**
+     * Run queued work until the pool is stopped
+     */
+    void worker();
+};
@@ -0,0 +1,84 @@
+#include "hedgePolicy.h"
+#include <algorithm>
+
+namespace {
+    // Samples needed before the percentile is trusted enough to hedge
+    const size_t MIN_SAMPLES = 32;
+
+    // How many new samples trigger a percentile recomputation
+    const size_t UPDATE_INTERVAL = 64;
+
+    // Request count after which the hedge rate window is halved
+    const unsigned long RATE_WINDOW = 10000;
+}
+
+HedgePolicy::HedgePolicy(size_t window_size)
+    : window_size_(std::max<size_t>(window_size, MIN_SAMPLES)) {
+}
+
+void HedgePolicy::record_latency(const RouteConfig& route, std::chrono::milliseconds latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RouteStats& stats = stats_[route.route_id];
+
+    if (stats.samples.size() < window_size_) {
+        stats.samples.push_back(latency.count());
+    } else {
+        stats.samples[stats.next_sample] = latency.count();
+    }
+    stats.next_sample = (stats.next_sample + 1) % window_size_;
+
+    // Recompute lazily so the hot path stays O(1)
+    if (++stats.samples_since_update >= UPDATE_INTERVAL || stats.cached_delay_ms < 0) {
+        update_delay(stats, route.hedge_percentile);
+    }
+}
+
+bool HedgePolicy::hedge_delay(const RouteConfig& route, std::chrono::milliseconds& delay) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RouteStats& stats = stats_[route.route_id];
+
+    if (stats.cached_delay_ms < 0) {
+        return false;
+    }
+
+    delay = std::chrono::milliseconds(std::max<long>(stats.cached_delay_ms, route.hedge_min_delay_ms));
+    return true;
+}
+
+void HedgePolicy::record_request(const RouteConfig& route) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RouteStats& stats = stats_[route.route_id];
+
+    // Halve both counters so the cap follows recent traffic
+    if (++stats.requests >= RATE_WINDOW) {
+        stats.requests /= 2;
+        stats.hedges /= 2;
+    }
+}
+
+bool HedgePolicy::try_acquire_hedge(const RouteConfig& route) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RouteStats& stats = stats_[route.route_id];
+
+    if ((stats.hedges + 1) * 100 > stats.requests * static_cast<unsigned long>(route.hedge_max_percent)) {
+        return false;
+    }
+
+    ++stats.hedges;
+    return true;
+}
+
+void HedgePolicy::update_delay(RouteStats& stats, double percentile) {
+    stats.samples_since_update = 0;
+
+    if (stats.samples.size() < MIN_SAMPLES) {
+        stats.cached_delay_ms = -1;
+        return;
+    }
+
+    std::vector<long> sorted = stats.samples;
+    double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    size_t index = static_cast<size_t>((clamped / 100.0) * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    stats.cached_delay_ms = sorted[index];
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../config/Config.h"
+
+/**
+ * Hedge Policy class
+ * Tracks upstream latency per route and decides when a second (hedged)
+ * attempt should be sent to another backend, capped to a share of traffic
+ */
+class HedgePolicy {
+public:
+    /**
+     * Constructor
+     * @param window_size Number of latency samples kept per route
+     */
+    explicit HedgePolicy(size_t window_size = 1024);
+
+    /**
+     * Record the latency of a completed upstream attempt
+     * @param route The route the attempt belongs to
+     * @param latency Time until the attempt completed
+     */
+    void record_latency(const RouteConfig& route, std::chrono::milliseconds latency);
+
+    /**
+     * Get the delay after which a hedge should be issued
+     * @param route The route configuration
+     * @param delay Output delay derived from the route's latency percentile
+     * @return False if there are not enough samples to hedge yet
+     */
+    bool hedge_delay(const RouteConfig& route, std::chrono::milliseconds& delay);
+
+    /**
+     * Count a hedge-eligible request towards the hedge rate cap
+     * @param route The route configuration
+     */
+    void record_request(const RouteConfig& route);
+
+    /**
+     * Reserve a hedge if the route is still under its hedge rate cap
+     * @param route The route configuration
+     * @return True if a hedge may be issued
+     */
+    bool try_acquire_hedge(const RouteConfig& route);
+
+private:
+    struct RouteStats {
+        std::vector<long> samples;     // ring buffer of latencies in ms
+        size_t next_sample = 0;        // ring buffer write position
+        size_t samples_since_update = 0;
+        long cached_delay_ms = -1;     // percentile computed from samples
+        unsigned long requests = 0;    // hedge-eligible requests in the current window
+        unsigned long hedges = 0;      // hedges issued in the current window
+    };
+
+    size_t window_size_;
+    std::map<std::string, RouteStats> stats_;  // route_id -> latency and rate stats
+    std::mutex mutex_;
+
+    /**
+     * Recompute the percentile delay from the current samples
+     * @param stats Stats for the route
+     * @param percentile Percentile to compute (0-100)
+     */
+    void update_delay(RouteStats& stats, double percentile);
+};
@@ -1,5 +1,6 @@
 #include "loadBalancer.h"
 #include "../util/logger.h"
+#include <algorithm>
 #include <random>
 #include <thread>
 #include <chrono>
@@ -26,6 +27,10 @@ const BackendServer* LoadBalancer::select_backend(const RouteConfig& route) {
     return select_weighted_random(route);
 }
 
+const BackendServer* LoadBalancer::select_alternate_backend(const RouteConfig& route, const BackendServer* exclude) {
+    return select_weighted_random(route, exclude);
+}
+
 void LoadBalancer::set_backend_health(const std::string& route_prefix, 
                                      const std::string& backend_name, 
                                      bool healthy) {
@@ -79,13 +84,21 @@ const BackendServer* LoadBalancer::select_round_robin(const RouteConfig& route)
     return selected;
 }
 
-const BackendServer* LoadBalancer::select_weighted_random(const RouteConfig& route) {
+const BackendServer* LoadBalancer::select_weighted_random(const RouteConfig& route, const BackendServer* exclude) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     auto healthy_backends = get_healthy_backends(route);
+    if (exclude) {
+        healthy_backends.erase(
+            std::remove(healthy_backends.begin(), healthy_backends.end(), exclude),
+            healthy_backends.end());
+    }
     if (healthy_backends.empty()) {
-        Logger::getInstance().error(
-            "No healthy backends available for route " + route.path_prefix, "LoadBalancer.cpp");
+        // Running out of alternates is expected on small routes, so only log the primary case
+        if (!exclude) {
+            Logger::getInstance().error(
+                "No healthy backends available for route " + route.path_prefix, "LoadBalancer.cpp");
+        }
         return nullptr;
     }
     
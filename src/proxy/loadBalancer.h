@@ -26,6 +26,14 @@ public:
      */
     const BackendServer* select_backend(const RouteConfig& route);
     
+    /**
+     * Select a backend server other than the given one
+     * @param route The route configuration
+     * @param exclude Backend that must not be selected
+     * @return Selected backend server or nullptr if no other is available
+     */
+    const BackendServer* select_alternate_backend(const RouteConfig& route, const BackendServer* exclude);
+    
     /**
      * Mark a backend server as healthy or unhealthy
      * @param route_prefix The route prefix
@@ -63,9 +71,10 @@ private:
     /**
      * Weighted random backend selection
      * @param route The route configuration
+     * @param exclude Optional backend to leave out of the selection
      * @return Selected backend or nullptr
      */
-    const BackendServer* select_weighted_random(const RouteConfig& route);
+    const BackendServer* select_weighted_random(const RouteConfig& route, const BackendServer* exclude = nullptr);
     
     /**
      * Get healthy backends for a route
@@ -1,9 +1,23 @@
 #include "proxyHandler.h"
 #include "../util/logger.h"
+#include "compression.h"
+#include "../http/HttpRange.h"
 #include <curl/curl.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <sstream>
-#include <zlib.h>
+#include <thread>
+#include <openssl/crypto.h>
+
+namespace {
+    const char* CACHE_PURGE_PATH = "/_proxy/cache/purge";
+    const char* CACHE_BANS_KEY = "cache-bans";
+    const char* CACHE_TAG_PREFIX = "cache-tag:";
+    const size_t PURGE_BATCH_SIZE = 500;
+    const size_t MAX_BACKGROUND_REVALIDATIONS = 64;  // refresh threads running at once
+    const long long RANGE_TAIL_BYTES = 4096;  // read first when serving ranges, usually covers the head
+}
 
 // Callback for writing CURL response data
 size_t write_callback(char* ptr, size_t size, size_t nmemb, std::string* data) {
@@ -77,12 +91,59 @@ ProxyHandler::ProxyHandler(Config& config, boost::asio::io_context& io_context)
             config.get_redis_password()
         );
         Logger::getInstance().info("Redis client initialized","proxyHandler.cpp");
+        
+        if (config.is_cache_admission_enabled()) {
+            admission_policy_ = std::make_unique<AdmissionPolicy>(
+                config.get_cache_admission_sketch_width(),
+                config.get_cache_admission_min_frequency(),
+                config.get_cache_max_object_bytes()
+            );
+            Logger::getInstance().info("Cache admission policy enabled","proxyHandler.cpp");
+        }
+        
+        // Restore the bans that may still apply, and drop the expired ones from Redis
+        long long now = CacheEntry::now();
+        std::vector<std::string> active;
+        for (const auto& line : redis_client_->list_range(CACHE_BANS_KEY)) {
+            Ban ban;
+            if (Ban::decode(line, ban) && ban.expires_at > now) {
+                ban_list_.add(ban);
+                active.push_back(line);
+            }
+        }
+        redis_client_->del({CACHE_BANS_KEY});
+        for (const auto& line : active) {
+            redis_client_->list_push(CACHE_BANS_KEY, line);
+        }
+        
+        // Large objects go to the disk tier instead of Redis
+        if (config.is_disk_cache_enabled()) {
+            disk_cache_ = std::make_unique<DiskCache>(
+                config.get_disk_cache_path(),
+                config.get_disk_cache_segment_bytes(),
+                config.get_disk_cache_max_bytes()
+            );
+            if (!disk_cache_->open()) {
+                disk_cache_.reset();
+            }
+        }
     }
     
     // Initialize load balancer
     load_balancer_ = std::make_unique<LoadBalancer>(config);
     Logger::getInstance().info("Load balancer initialized","proxyHandler.cpp");
     
+    // Initialize hedge policy
+    hedge_policy_ = std::make_unique<HedgePolicy>();
+    
+    // Large bodies are compressed on dedicated threads
+    if (config.is_gzip_enabled() && config.get_compression_offload_threads() > 0) {
+        compression_pool_ = std::make_unique<CompressionPool>(
+            config.get_compression_offload_threads(),
+            config.get_compression_offload_queue()
+        );
+    }
+    
     // Initialize CURL
     curl_global_init(CURL_GLOBAL_ALL);
     Logger::getInstance().info("CURL initialized","proxyHandler.cpp");
@@ -92,7 +153,8 @@ HttpResponsePtr ProxyHandler::handle_request(HttpRequestPtr request, const std::
     Logger::getInstance().debug("Request from " + client_ip + ": " + request->method() + " " + request->uri());
     
     // Apply security checks
-    if (!apply_security_checks(request, client_ip)) {
+    std::shared_ptr<const JwtClaims> claims;
+    if (!apply_security_checks(request, client_ip, claims)) {
         Logger::getInstance().warning("Request from " + client_ip + " failed security checks");
         auto response = std::make_shared<HttpResponse>(HttpStatus::FORBIDDEN);
         response->set_body("Forbidden", "text/plain");
@@ -100,17 +162,35 @@ HttpResponsePtr ProxyHandler::handle_request(HttpRequestPtr request, const std::
         return response;
     }
     
-    // Check rate limit
-    if (!check_rate_limit(client_ip)) {
-        Logger::getInstance().warning("Rate limit exceeded for client " + client_ip);
+    // Preflight requests are answered from the CORS policy and never reach a backend
+    if (is_preflight(request)) {
+        return handle_preflight(request);
+    }
+    
+    // Check rate limit, per authenticated identity when a claim is configured for it
+    std::string client_key = client_ip;
+    const std::string& key_claim = config_.get_rate_limit_key_claim();
+    if (claims && !key_claim.empty()) {
+        auto it = claims->find(key_claim);
+        if (it != claims->end() && !it->second.empty()) {
+            client_key = "claim:" + it->second;
+        }
+    }
+    if (!check_rate_limit(client_key)) {
+        Logger::getInstance().warning("Rate limit exceeded for client " + client_key);
         auto response = std::make_shared<HttpResponse>(HttpStatus::TOO_MANY_REQUESTS);
         response->set_body("Rate limit exceeded", "text/plain");
         apply_cors_headers(request, response);
         return response;
     }
     
+    // Cache invalidation requests from operators
+    if (request->path() == CACHE_PURGE_PATH && !config_.get_cache_admin_token().empty()) {
+        return handle_purge_request(request);
+    }
+    
     // Find a matching route
-    const RouteConfig* route = config_.find_route(request->path());
+    const RouteConfig* route = config_.find_route(request->path(), claims.get());
     if (!route) {
         Logger::getInstance().warning("No route found for path " + request->path());
         auto response = std::make_shared<HttpResponse>(HttpStatus::NOT_FOUND);
@@ -119,33 +199,104 @@ HttpResponsePtr ProxyHandler::handle_request(HttpRequestPtr request, const std::
         return response;
     }
     
+    // Before the cache lookup, so claim headers are part of the cache key
+    apply_claim_headers(request, *route, claims.get());
+    
+    // Clients get the best coding both sides accept, cached as a variant next to the identity
+    // response. Ranges are served from the identity representation.
+    bool wants_range = request->method() == "GET" && request->has_header("Range");
+    std::string encoding;
+    if (config_.is_gzip_enabled() && !wants_range) {
+        encoding = Compression::negotiate(request->get_header("Accept-Encoding"), route->compression_encodings);
+    }
+    
+    // HEAD is answered from the cached GET response, without its body
+    HttpRequestPtr cache_request = request;
+    if (request->method() == "HEAD") {
+        cache_request = std::make_shared<HttpRequest>(*request);
+        cache_request->set_method("GET");
+    }
+    
     // Try to get a cached response
+    std::shared_ptr<CacheEntry> cached_entry;
     if (redis_client_ && route->cache_enabled) {
-        auto cached_response = get_cached_response(request, route);
-        if (cached_response) {
-            Logger::getInstance().debug("Cache hit for " + request->uri());
-            apply_cors_headers(request, cached_response);
-            return cached_response;
+        if (wants_range) {
+            if (auto partial = serve_cached_range(request, route)) {
+                return partial;
+            }
+        }
+        
+        if (!encoding.empty()) {
+            auto variant = get_cached_entry(cache_request, route, encoding);
+            if (variant && variant->is_fresh(CacheEntry::now())) {
+                Logger::getInstance().debug("Cache hit for " + request->uri() + " (" + encoding + ")");
+
+                // Popularity is tracked per identity key, which this hit skips looking up
+                if (admission_policy_) {
+                    admission_policy_->record(generate_cache_key(cache_request, route));
+                }
+                return serve_cached(request, variant->response, "HIT");
+            }
+        }
+        
+        cached_entry = get_cached_entry(cache_request, route);
+        if (cached_entry) {
+            long long now = CacheEntry::now();
+            if (cached_entry->is_fresh(now)) {
+                Logger::getInstance().debug("Cache hit for " + request->uri());
+                
+                // Compress once and keep the variant for the rest of the entry's lifetime
+                if (!encoding.empty() && apply_compression(request, cached_entry->response, route, encoding)) {
+                    cache_response(cache_request, cached_entry->response, route, encoding, cached_entry.get());
+                }
+                return serve_cached(request, cached_entry->response, "HIT");
+            }
+            
+            // Serve the stale copy right away and refresh it in the background
+            if (cached_entry->is_stale_while_revalidate(now)) {
+                Logger::getInstance().debug("Serving stale response for " + request->uri() + " while revalidating");
+                schedule_revalidation(cache_request, route, cached_entry);
+                
+                // The revalidation merges into the entry's response, so encode a copy
+                auto stale = std::make_shared<HttpResponse>(*cached_entry->response);
+                if (!encoding.empty()) {
+                    apply_compression(request, stale, route, encoding, true);
+                }
+                return serve_cached(request, stale, "STALE");
+            }
         }
     }
     
-    // Forward the request to a backend server
+    // Forward the request to a backend server, revalidating the expired entry if there is one
     Logger::getInstance().debug("Forwarding request to backend");
-    auto response = forward_request(request, route);
+    std::shared_ptr<CacheEntry> stored_entry;
+    HttpResponsePtr response = fetch_upstream(request, route, cached_entry, &stored_entry);
+    
+    if (cached_entry && response->status_code() >= 500 && cached_entry->is_stale_if_error(CacheEntry::now())) {
+        Logger::getInstance().warning("Backend error for " + request->uri() + ", serving stale response");
+        if (!encoding.empty()) {
+            apply_compression(request, cached_entry->response, route, encoding, true);
+        }
+        return serve_cached(request, cached_entry->response, "STALE");
+    }
     
-    // Cache the response if appropriate
-    if (redis_client_ && 
-        route->cache_enabled && 
-        response->status() == HttpStatus::OK && 
-        request->method() == "GET") {
-        cache_response(request, response, route);
+    // Responses that were stored are compressed up front so the variant can be kept next
+    // to the identity entry it shares its lifetime with, everything else while it is sent
+    if (!encoding.empty()) {
+        bool store_variant = stored_entry != nullptr;
+        if (apply_compression(request, response, route, encoding, !store_variant) && store_variant) {
+            cache_response(request, response, route, encoding, stored_entry.get());
+        }
     }
     
-    // Apply compression if enabled
-    if (config_.is_gzip_enabled()) {
-        apply_compression(request, response);
+    // Answer the client's own conditional request, against the variant's tag if it was encoded
+    if (request->method() == "GET" && response->status() == HttpStatus::OK &&
+        Conditional::is_not_modified(*request, *response)) {
+        response = Conditional::make_not_modified(*response);
     }
     
+    response = apply_range(request, response);
+    
     // Apply CORS headers
     apply_cors_headers(request, response);
     
@@ -164,10 +315,12 @@ bool ProxyHandler::handle_websocket(HttpRequestPtr request,
     }
     
     // Apply security checks
-    if (!apply_security_checks(request, client_ip)) {
+    std::shared_ptr<const JwtClaims> claims;
+    if (!apply_security_checks(request, client_ip, claims)) {
         Logger::getInstance().warning("WebSocket request from " + client_ip + " failed security checks");
         return false;
     }
+    apply_claim_headers(request, *route, claims.get());
     
     // Get backend server
     const BackendServer* backend = load_balancer_->select_backend(*route);
@@ -187,15 +340,16 @@ bool ProxyHandler::handle_websocket(HttpRequestPtr request,
     return false;
 }
 
-HttpResponsePtr ProxyHandler::forward_request(HttpRequestPtr request, const RouteConfig* route) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        Logger::getInstance().error("Failed to initialize CURL");
-        auto response = std::make_shared<HttpResponse>(HttpStatus::INTERNAL_SERVER_ERROR);
-        response->set_body("Internal Server Error", "text/plain");
-        return response;
+ProxyHandler::UpstreamTransfer::~UpstreamTransfer() {
+    if (headers) {
+        curl_slist_free_all(headers);
     }
-    
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+}
+
+HttpResponsePtr ProxyHandler::forward_request(HttpRequestPtr request, const RouteConfig* route) {
     // Select a backend server
     const BackendServer* backend = load_balancer_->select_backend(*route);
     if (!backend) {
@@ -205,6 +359,267 @@ HttpResponsePtr ProxyHandler::forward_request(HttpRequestPtr request, const Rout
         return response;
     }
     
+    // Only idempotent requests are safe to send twice
+    bool hedgeable = route->hedging_enabled &&
+                     (request->method() == "GET" || request->method() == "HEAD");
+    if (hedgeable) {
+        return forward_hedged_request(request, route, backend);
+    }
+    
+    auto transfer = prepare_transfer(request, backend);
+    if (!transfer) {
+        auto response = std::make_shared<HttpResponse>(HttpStatus::INTERNAL_SERVER_ERROR);
+        response->set_body("Internal Server Error", "text/plain");
+        return response;
+    }
+    
+    // Perform the request
+    CURLcode res = curl_easy_perform(transfer->curl);
+    
+    return build_response(*transfer, res);
+}
+
+HttpResponsePtr ProxyHandler::serve_cached(HttpRequestPtr request, HttpResponsePtr response,
+                                           const std::string& cache_status) {
+    if (response->status() == HttpStatus::OK && Conditional::is_not_modified(*request, *response)) {
+        response = Conditional::make_not_modified(*response);
+    }
+    
+    if (response->status() == HttpStatus::OK) {
+        response->set_header("Accept-Ranges", "bytes");
+        response = apply_range(request, response);
+    }
+    
+    if (request->method() == "HEAD") {
+        response->strip_body();
+    }
+    
+    response->set_header("X-Proxy-Cache", cache_status);
+    apply_cors_headers(request, response);
+    return response;
+}
+
+HttpResponsePtr ProxyHandler::fetch_upstream(HttpRequestPtr request, const RouteConfig* route,
+                                             std::shared_ptr<CacheEntry> cached,
+                                             std::shared_ptr<CacheEntry>* stored) {
+    if (redis_client_ && route->cache_enabled && route->coalescing_enabled && request->method() == "GET") {
+        // Identical concurrent misses share a single upstream fetch
+        bool shared = false;
+        auto response = single_flight_.run(
+            generate_cache_key(request, route),
+            [this, request, route, cached, stored]() { return fetch_and_cache(request, route, cached, stored); },
+            std::chrono::milliseconds(route->coalesce_timeout_ms),
+            &shared);
+        if (shared) {
+            Logger::getInstance().debug("Coalesced with in-flight fetch for " + request->uri());
+        }
+        return response;
+    }
+    
+    return fetch_and_cache(request, route, cached, stored);
+}
+
+void ProxyHandler::schedule_revalidation(HttpRequestPtr request, const RouteConfig* route,
+                                         std::shared_ptr<CacheEntry> cached) {
+    std::string cache_key = generate_cache_key(request, route);
+    {
+        std::lock_guard<std::mutex> lock(revalidation_mutex_);
+        if (revalidating_.size() >= MAX_BACKGROUND_REVALIDATIONS) {
+            return;  // Busy, a later request for the stale entry tries again
+        }
+        if (!revalidating_.insert(cache_key).second) {
+            return;  // Already being refreshed
+        }
+    }
+    
+    // The client thread keeps using its request and entry, so refresh with copies
+    auto refresh_request = std::make_shared<HttpRequest>(*request);
+    auto refresh_entry = std::make_shared<CacheEntry>(*cached);
+    refresh_entry->response = std::make_shared<HttpResponse>(*cached->response);
+    
+    // The fetch blocks for up to the transfer timeout, so it gets its own thread rather than
+    // one of the io_context threads that accept connections and run TLS handshakes
+    auto self = shared_from_this();
+    std::thread([self, refresh_request, route, refresh_entry, cache_key]() {
+        try {
+            self->fetch_upstream(refresh_request, route, refresh_entry);
+        }
+        catch (const std::exception& e) {
+            Logger::getInstance().error("Background revalidation failed: " + std::string(e.what()));
+        }
+        
+        std::lock_guard<std::mutex> lock(self->revalidation_mutex_);
+        self->revalidating_.erase(cache_key);
+    }).detach();
+}
+
+HttpResponsePtr ProxyHandler::fetch_and_cache(HttpRequestPtr request, const RouteConfig* route,
+                                              std::shared_ptr<CacheEntry> cached,
+                                              std::shared_ptr<CacheEntry>* stored) {
+    bool cacheable = redis_client_ && route->cache_enabled && request->method() == "GET";
+    bool revalidating = cached && request->method() == "GET" && Conditional::has_validators(*cached->response);
+    
+    HttpRequestPtr upstream_request = request;
+    if (cacheable || revalidating) {
+        upstream_request = std::make_shared<HttpRequest>(*request);
+        
+        // Cache the whole identity response, compressed variants and ranges are derived from it.
+        // The client's own validators are answered locally, the backend only sees the cache's,
+        // so a 304 always refers to the cached body and is never shared with other clients.
+        if (cacheable) {
+            for (const char* name : {"Accept-Encoding", "Range", "If-Range", "If-None-Match",
+                                     "If-Modified-Since", "If-Match", "If-Unmodified-Since"}) {
+                upstream_request->remove_header(name);
+            }
+        }
+        
+        // Revalidate an expired entry with a conditional request instead of refetching the body
+        if (revalidating) {
+            Conditional::add_revalidation_headers(*upstream_request, *cached->response);
+        }
+    }
+    
+    auto response = forward_request(upstream_request, route);
+    
+    if (revalidating && response->status() == HttpStatus::NOT_MODIFIED) {
+        Logger::getInstance().debug("Revalidated cached response for " + request->uri());
+        auto refreshed = std::make_shared<HttpResponse>(*cached->response);
+        Conditional::merge_not_modified(*refreshed, *response);
+        response = refreshed;
+    }
+    
+    // Cache the response if appropriate, but never let an error replace an entry
+    // that is still allowed to stand in for it
+    bool keep_stale = cached && response->status_code() >= 500 && cached->is_stale_if_error(CacheEntry::now());
+    if (cacheable && !keep_stale && is_cacheable_status(route, response->status_code())) {
+        auto entry = cache_response(request, response, route);
+        if (stored) {
+            *stored = entry;
+        }
+    }
+    
+    return response;
+}
+
+HttpResponsePtr ProxyHandler::forward_hedged_request(HttpRequestPtr request, const RouteConfig* route,
+                                                     const BackendServer* backend) {
+    hedge_policy_->record_request(*route);
+    
+    auto primary = prepare_transfer(request, backend);
+    CURLM* multi = curl_multi_init();
+    if (!primary || !multi) {
+        Logger::getInstance().error("Failed to initialize CURL for hedged request");
+        if (multi) {
+            curl_multi_cleanup(multi);
+        }
+        auto response = std::make_shared<HttpResponse>(HttpStatus::INTERNAL_SERVER_ERROR);
+        response->set_body("Internal Server Error", "text/plain");
+        return response;
+    }
+    curl_multi_add_handle(multi, primary->curl);
+    
+    // Without enough latency samples there is no delay to hedge at
+    std::chrono::milliseconds hedge_delay(0);
+    bool may_hedge = hedge_policy_->hedge_delay(*route, hedge_delay);
+    auto start = std::chrono::steady_clock::now();
+    
+    std::unique_ptr<UpstreamTransfer> hedge;
+    UpstreamTransfer* winner = nullptr;
+    CURLcode winner_result = CURLE_OK;
+    int pending = 1;
+    
+    // Send the request to another backend, at most once per request and within the route's budget
+    auto issue_hedge = [&](const std::string& reason) {
+        may_hedge = false;
+        const BackendServer* alternate = load_balancer_->select_alternate_backend(*route, backend);
+        if (!alternate || !hedge_policy_->try_acquire_hedge(*route)) {
+            return false;
+        }
+        hedge = prepare_transfer(request, alternate);
+        if (!hedge) {
+            return false;
+        }
+        Logger::getInstance().debug("Hedging request to " + alternate->host + ":" +
+                                    std::to_string(alternate->port) + " " + reason);
+        curl_multi_add_handle(multi, hedge->curl);
+        ++pending;
+        return true;
+    };
+    
+    while (!winner) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        
+        // Collect finished attempts
+        CURLMsg* msg;
+        int msgs_left = 0;
+        while ((msg = curl_multi_info_read(multi, &msgs_left)) && !winner) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            
+            UpstreamTransfer* done = (msg->easy_handle == primary->curl) ? primary.get() : hedge.get();
+            CURLcode result = msg->data.result;
+            curl_multi_remove_handle(multi, done->curl);
+            --pending;
+            
+            if (result == CURLE_OK) {
+                record_transfer_latency(*done, route);
+            }
+            
+            // A primary that fails before the hedge delay is hedged right away,
+            // with or without enough samples to know the delay
+            if (result != CURLE_OK && done == primary.get() && !hedge && issue_hedge("after the primary failed")) {
+                continue;
+            }
+            
+            // A failed attempt only loses if nothing else is still in flight
+            if (result == CURLE_OK || pending == 0) {
+                winner = done;
+                winner_result = result;
+            }
+        }
+        if (winner) {
+            break;
+        }
+        
+        // Issue the hedge once the primary is slower than the route's percentile
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        if (may_hedge && !hedge && elapsed >= hedge_delay &&
+            issue_hedge("after " + std::to_string(elapsed.count()) + "ms")) {
+            continue;
+        }
+        
+        int wait_ms = 1000;
+        if (may_hedge && !hedge) {
+            wait_ms = static_cast<int>(std::max<long>(1, (hedge_delay - elapsed).count()));
+        }
+        curl_multi_poll(multi, nullptr, 0, wait_ms, nullptr);
+    }
+    
+    // Cancel the losing attempt
+    for (UpstreamTransfer* transfer : {primary.get(), hedge.get()}) {
+        if (transfer && transfer != winner) {
+            curl_multi_remove_handle(multi, transfer->curl);
+        }
+    }
+    curl_multi_cleanup(multi);
+    
+    return build_response(*winner, winner_result);
+}
+
+std::unique_ptr<ProxyHandler::UpstreamTransfer> ProxyHandler::prepare_transfer(HttpRequestPtr request,
+                                                                               const BackendServer* backend) {
+    auto transfer = std::make_unique<UpstreamTransfer>();
+    transfer->backend = backend;
+    transfer->curl = curl_easy_init();
+    if (!transfer->curl) {
+        Logger::getInstance().error("Failed to initialize CURL");
+        return nullptr;
+    }
+    CURL* curl = transfer->curl;
+    
     // Build the backend URL
     std::string backend_url = "http://" + backend->host + ":" + std::to_string(backend->port);
     
@@ -239,30 +654,26 @@ HttpResponsePtr ProxyHandler::forward_request(HttpRequestPtr request, const Rout
     }
     
     // Set up headers
-    struct curl_slist* curl_headers = nullptr;
     for (const auto& header : request->headers()) {
         std::string orig_name = request->get_original_header_name(header.first);
         std::string header_line = orig_name + ": " + header.second;
-        curl_headers = curl_slist_append(curl_headers, header_line.c_str());
+        transfer->headers = curl_slist_append(transfer->headers, header_line.c_str());
     }
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, curl_headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
     
     // Set request body if present
-    std::string body_copy = request->body();
-    if (!body_copy.empty()) {
+    transfer->request_body = request->body();
+    if (!transfer->request_body.empty()) {
         curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
-        curl_easy_setopt(curl, CURLOPT_READDATA, &body_copy);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, body_copy.size());
+        curl_easy_setopt(curl, CURLOPT_READDATA, &transfer->request_body);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, transfer->request_body.size());
     }
     
     // Set up response data
-    std::string response_body;
-    std::map<std::string, std::string> response_headers;
-    
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_body);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer->response_body);
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer->response_headers);
     
     // Follow redirects
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
@@ -270,61 +681,55 @@ HttpResponsePtr ProxyHandler::forward_request(HttpRequestPtr request, const Rout
     // Set timeout
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
     
-    // Perform the request
-    CURLcode res = curl_easy_perform(curl);
-    
-    // Create response
+    return transfer;
+}
+
+HttpResponsePtr ProxyHandler::build_response(UpstreamTransfer& transfer, CURLcode res) {
     auto response = std::make_shared<HttpResponse>();
     
     if (res != CURLE_OK) {
         Logger::getInstance().error("CURL error: " + std::string(curl_easy_strerror(res)));
         response->set_status(HttpStatus::BAD_GATEWAY);
         response->set_body("Error forwarding request: " + std::string(curl_easy_strerror(res)), "text/plain");
-    } else {
-        // Get HTTP status code
-        long http_code = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-        response->set_status(static_cast<HttpStatus>(http_code));
-        
-        // Set response body
-        std::string content_type = "text/plain";
-        if (response_headers.find("Content-Type") != response_headers.end()) {
-            content_type = response_headers["Content-Type"];
-        }
-        response->set_body(response_body, content_type);
-        
-        // Copy headers from backend response to client response
-        for (const auto& header : response_headers) {
-            // Skip certain headers that we'll set ourselves
-            if (header.first != "Content-Length" && header.first != "Connection") {
-                response->set_header(header.first, header.second);
-            }
-        }
+        return response;
+    }
+    
+    // Get HTTP status code
+    long http_code = 0;
+    curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &http_code);
+    response->set_status(static_cast<HttpStatus>(http_code));
+    
+    // Set response body
+    std::string content_type = "text/plain";
+    if (transfer.response_headers.find("Content-Type") != transfer.response_headers.end()) {
+        content_type = transfer.response_headers["Content-Type"];
     }
+    response->set_body(transfer.response_body, content_type);
     
-    // Clean up
-    curl_slist_free_all(curl_headers);
-    curl_easy_cleanup(curl);
+    // Copy headers from backend response to client response
+    for (const auto& header : transfer.response_headers) {
+        // Skip certain headers that we'll set ourselves
+        if (header.first != "Content-Length" && header.first != "Connection") {
+            response->set_header(header.first, header.second);
+        }
+    }
     
     return response;
 }
 
-bool ProxyHandler::apply_security_checks(HttpRequestPtr request, const std::string& client_ip) {
-    // Check IP whitelist if configured
-    const auto& allowed_ips = config_.get_allowed_ips();
-    if (!allowed_ips.empty()) {
-        bool ip_allowed = false;
-        for (const auto& allowed_ip : allowed_ips) {
-            if (allowed_ip == client_ip || allowed_ip == "0.0.0.0" || allowed_ip == "*") {
-                ip_allowed = true;
-                break;
-            }
-        }
-        
-        if (!ip_allowed) {
-            Logger::getInstance().warning("Request from non-whitelisted IP: " + client_ip);
-            return false;
-        }
+void ProxyHandler::record_transfer_latency(UpstreamTransfer& transfer, const RouteConfig* route) {
+    curl_off_t total_us = 0;
+    if (curl_easy_getinfo(transfer.curl, CURLINFO_TOTAL_TIME_T, &total_us) == CURLE_OK) {
+        hedge_policy_->record_latency(*route, std::chrono::milliseconds(total_us / 1000));
+    }
+}
+
+bool ProxyHandler::apply_security_checks(HttpRequestPtr request, const std::string& client_ip,
+                                         std::shared_ptr<const JwtClaims>& claims) {
+    // Check IP whitelist and blacklist if configured
+    if (!config_.get_ip_filter().allows(client_ip)) {
+        Logger::getInstance().warning("Request from filtered IP: " + client_ip);
+        return false;
     }
     
     // Check JWT authentication if enabled
@@ -351,45 +756,74 @@ bool ProxyHandler::apply_security_checks(HttpRequestPtr request, const std::stri
         std::string token = auth_header.substr(7);
         
         // Verify token
-        if (!auth_->verify_jwt(token)) {
+        VerifiedToken verified;
+        if (!auth_->verify_jwt(token, verified)) {
             Logger::getInstance().warning("JWT verification failed");
             return false;
         }
+        claims = verified.claims;
     }
     
     return true;
 }
 
+void ProxyHandler::apply_claim_headers(HttpRequestPtr request, const RouteConfig& route, const JwtClaims* claims) {
+    for (const auto& claim_header : route.claim_headers) {
+        request->remove_header(claim_header.second);
+        if (!claims) {
+            continue;
+        }
+        auto it = claims->find(claim_header.first);
+        if (it != claims->end()) {
+            request->set_header(claim_header.second, it->second);
+        }
+    }
+}
+
 void ProxyHandler::apply_cors_headers(HttpRequestPtr request, HttpResponsePtr response) {
+    const CorsPolicy& policy = config_.get_cors_policy();
+    if (policy.empty()) {
+        return;
+    }
+    
     // Get Origin header from request
     std::string origin = request->get_header("Origin");
     if (origin.empty()) {
         return;  // Not a CORS request
     }
     
-    const auto& allowed_origins = config_.get_allowed_origins();
-    bool origin_allowed = false;
-    
-    // Check if this origin is allowed
-    for (const auto& allowed_origin : allowed_origins) {
-        if (allowed_origin == "*" || allowed_origin == origin) {
-            origin_allowed = true;
-            break;
-        }
+    if (policy.allows_origin(origin)) {
+        // Only the origin differs per request, the other headers are formatted once
+        response->set_header("Access-Control-Allow-Origin", origin);
+        response->set_header_block(policy.response_headers());
     }
+}
+
+bool ProxyHandler::is_preflight(HttpRequestPtr request) const {
+    return request->method() == "OPTIONS" && !config_.get_cors_policy().empty() &&
+           request->has_header("Origin") && request->has_header("Access-Control-Request-Method");
+}
+
+HttpResponsePtr ProxyHandler::handle_preflight(HttpRequestPtr request) {
+    const CorsPolicy& policy = config_.get_cors_policy();
+    std::string origin = request->get_header("Origin");
     
-    if (origin_allowed) {
-        // Set CORS headers
-        response->set_header("Access-Control-Allow-Origin", origin);
-        response->set_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-        response->set_header("Access-Control-Allow-Headers", 
-                            "Origin, Content-Type, Accept, Authorization, X-Requested-With");
-        response->set_header("Access-Control-Allow-Credentials", "true");
-        response->set_header("Access-Control-Max-Age", "3600");
+    if (!policy.allows_origin(origin) ||
+        !policy.allows_request(request->get_header("Access-Control-Request-Method"),
+                               request->get_header("Access-Control-Request-Headers"))) {
+        Logger::getInstance().debug("Rejected CORS preflight from origin " + origin);
+        auto response = std::make_shared<HttpResponse>(HttpStatus::FORBIDDEN);
+        response->set_body("Forbidden", "text/plain");
+        return response;
     }
+    
+    auto response = std::make_shared<HttpResponse>(HttpStatus::NO_CONTENT);
+    response->set_header("Access-Control-Allow-Origin", origin);
+    response->set_header_block(policy.preflight_headers());
+    return response;
 }
 
-bool ProxyHandler::check_rate_limit(const std::string& client_ip) {
+bool ProxyHandler::check_rate_limit(const std::string& client_key) {
     // Skip rate limiting if Redis is not available
     if (!redis_client_) {
         return true;
@@ -403,7 +837,7 @@ bool ProxyHandler::check_rate_limit(const std::string& client_ip) {
         return true;
     }
     
-    std::string key = "rate_limit:" + client_ip;
+    std::string key = "rate_limit:" + client_key;
     
     // Get current count
     int count = redis_client_->get_int(key);
@@ -424,178 +858,421 @@ bool ProxyHandler::check_rate_limit(const std::string& client_ip) {
     return false;
 }
 
-HttpResponsePtr ProxyHandler::get_cached_response(HttpRequestPtr request, const RouteConfig* route) {
+std::shared_ptr<CacheEntry> ProxyHandler::get_cached_entry(HttpRequestPtr request, const RouteConfig* route,
+                                                           const std::string& encoding) {
     // Only cache GET requests
     if (request->method() != "GET") {
         return nullptr;
     }
     
     // Generate cache key
-    std::string cache_key = generate_cache_key(request);
+    std::string cache_key = generate_cache_key(request, route, encoding);
+    
+    // Every lookup counts towards the key's admission frequency
+    if (admission_policy_ && encoding.empty()) {
+        admission_policy_->record(cache_key);
+    }
     
     // Try to get from cache
+    auto entry = std::make_shared<CacheEntry>();
     std::string cached_data = redis_client_->get(cache_key);
     if (cached_data.empty()) {
+        // Large objects live in the disk tier
+        if (!disk_cache_ || !disk_cache_->get(cache_key, *entry)) {
+            return nullptr;
+        }
+    } else {
+        try {
+            if (!CacheEntry::deserialize(std::move(cached_data), *entry)) {
+                Logger::getInstance().error("Invalid cached response format");
+                return nullptr;
+            }
+        }
+        catch (const std::exception& e) {
+            Logger::getInstance().error("Invalid cached response format: " + std::string(e.what()));
+            return nullptr;
+        }
+    }
+    
+    // Banned entries are left to expire, they are treated as misses until then
+    if (ban_list_.is_banned(entry->uri, entry->stored_at)) {
+        Logger::getInstance().debug("Cached response for " + request->uri() + " is banned");
         return nullptr;
     }
     
-    // Parse cached data
-    size_t header_end = cached_data.find("\r\n\r\n");
-    if (header_end == std::string::npos) {
-        Logger::getInstance().error("Invalid cached response format");
+    return entry;
+}
+
+std::shared_ptr<CacheEntry> ProxyHandler::cache_response(HttpRequestPtr request, HttpResponsePtr response,
+                                                         const RouteConfig* route, const std::string& encoding,
+                                                         const CacheEntry* source) {
+    // Only cache GET responses with a cacheable status
+    if (request->method() != "GET" || !is_cacheable_status(route, response->status_code())) {
         return nullptr;
     }
     
-    std::string headers_str = cached_data.substr(0, header_end);
-    std::string body = cached_data.substr(header_end + 4);
+    // Skip caching if response says not to cache
+    CacheControl cache_control = CacheControl::parse(response->get_header("Cache-Control"));
+    if (!cache_control.is_storable()) {
+        return nullptr;
+    }
     
-    // Create response object
-    auto response = std::make_shared<HttpResponse>();
+    // Learn which request headers the response varies on, "Vary: *" is never reusable
+    std::vector<std::string> vary;
+    if (!CacheKey::parse_vary(response->get_header("Vary"), vary)) {
+        return nullptr;
+    }
+    size_t size = response->body_view().size();
+    bool to_disk = disk_cache_ && size >= config_.get_disk_cache_min_object_bytes();
+    size_t max_size = to_disk ? disk_cache_->max_object_bytes() : config_.get_cache_max_object_bytes();
+    
+    if (!source) {
+        // One-hit wonders and oversized objects are not worth storing. Variants
+        // share the admission decision of the identity key they belong to.
+        if (size > max_size ||
+            (admission_policy_ && !admission_policy_->admit(generate_cache_key(request, route), size))) {
+            Logger::getInstance().debug("Cache admission rejected " + request->uri());
+            return nullptr;
+        }
+        vary_index_.update(CacheKey::primary(*request, *route), vary);
+    }
+    
+    // Generate cache key
+    std::string cache_key = generate_cache_key(request, route, encoding);
+    
+    auto stored = std::make_shared<CacheEntry>();
+    CacheEntry& entry = *stored;
+    entry.response = response;
+    entry.uri = request->uri();
+    if (source) {
+        // Variants expire together with the entry they were derived from
+        entry.stored_at = source->stored_at;
+        entry.fresh_seconds = source->fresh_seconds;
+        entry.stale_while_revalidate_seconds = source->stale_while_revalidate_seconds;
+        entry.stale_if_error_seconds = source->stale_if_error_seconds;
+    } else {
+        // Response directives override the route's stale windows
+        auto status_ttl = route->cache_status_ttls.find(response->status_code());
+        entry.stored_at = CacheEntry::now();
+        entry.fresh_seconds = status_ttl != route->cache_status_ttls.end()
+            ? status_ttl->second : route->cache_ttl_seconds;
+        entry.stale_while_revalidate_seconds = cache_control.stale_while_revalidate >= 0
+            ? cache_control.stale_while_revalidate : route->stale_while_revalidate_seconds;
+        entry.stale_if_error_seconds = cache_control.stale_if_error >= 0
+            ? cache_control.stale_if_error : route->stale_if_error_seconds;
+    }
     
-    // Parse status code from first line
-    size_t first_line_end = headers_str.find("\r\n");
-    if (first_line_end != std::string::npos) {
-        std::string status_line = headers_str.substr(0, first_line_end);
-        size_t code_start = status_line.find(" ");
-        size_t code_end = status_line.find(" ", code_start + 1);
-        if (code_start != std::string::npos && code_end != std::string::npos) {
-            std::string code_str = status_line.substr(code_start + 1, code_end - code_start - 1);
-            int code = std::stoi(code_str);
-            response->set_status(static_cast<HttpStatus>(code));
+    // Keep the entry in Redis past its freshness for the stale grace period.
+    // Entries with validators are kept at least one more TTL so that they can
+    // be revalidated with a conditional request instead of refetched.
+    int grace = entry.grace_seconds();
+    if (Conditional::has_validators(*response)) {
+        grace = std::max(grace, entry.fresh_seconds);
+    }
+    // Response directives can stretch the stale windows past the route's, but no entry may
+    // outlive the bans that can match it, which last ban_ttl_seconds from their creation
+    long long expires_at = std::min(entry.stored_at + entry.fresh_seconds + grace,
+                                    entry.stored_at + config_.get_cache_ban_ttl_seconds());
+    long long ttl = expires_at - CacheEntry::now();
+    if (ttl <= 0) {
+        return nullptr;
+    }
+    // Lookups try Redis first, so a copy left in the other tier by an object that
+    // changed size would shadow (or be shadowed by) the new one
+    if (to_disk) {
+        disk_cache_->put(cache_key, entry, CacheEntry::now() + ttl);
+        redis_client_->del({cache_key});
+    } else {
+        redis_client_->set_with_expiry(cache_key, entry.serialize(), static_cast<int>(ttl));
+        if (disk_cache_) {
+            disk_cache_->remove(cache_key);
         }
     }
     
-    // Parse headers
-    std::istringstream headers_stream(headers_str);
-    std::string line;
+    // Index the key under each of its surrogate keys for tag purges
+    std::istringstream tags(response->get_header(config_.get_cache_tag_header()));
+    std::string tag;
+    while (tags >> tag) {
+        redis_client_->set_add(CACHE_TAG_PREFIX + tag, cache_key, static_cast<int>(ttl));
+    }
     
-    // Skip status line
-    std::getline(headers_stream, line);
+    Logger::getInstance().debug("Cached " + (encoding.empty() ? std::string("response") : encoding + " variant") +
+             " for " + request->uri() + " with TTL " + std::to_string(entry.fresh_seconds) +
+             "s (+" + std::to_string(grace) + "s stale)");
+    return stored;
+}
+
+HttpResponsePtr ProxyHandler::apply_range(HttpRequestPtr request, HttpResponsePtr response) {
+    if (request->method() != "GET" || response->status() != HttpStatus::OK || !request->has_header("Range")) {
+        return response;
+    }
     
-    // Parse header lines
-    while (std::getline(headers_stream, line) && !line.empty()) {
-        // Remove CR from end of line if present
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+    // A changed representation is sent in full
+    if (!Conditional::if_range_matches(*request, *response)) {
+        return response;
+    }
+    
+    size_t length = response->body_view().size();
+    std::vector<HttpRange::ByteRange> ranges;
+    switch (HttpRange::parse(request->get_header("Range"), length, ranges)) {
+        case HttpRange::ParseResult::SATISFIABLE:
+            return HttpRange::make_partial(*response, ranges);
+        case HttpRange::ParseResult::UNSATISFIABLE:
+            return HttpRange::make_unsatisfiable(length);
+        default:
+            return response;
+    }
+}
+
+HttpResponsePtr ProxyHandler::serve_cached_range(HttpRequestPtr request, const RouteConfig* route) {
+    std::string cache_key = generate_cache_key(request, route);
+    
+    // The head sits at the end of the value, read it without the body
+    std::string tail = redis_client_->get_range(cache_key, -RANGE_TAIL_BYTES, -1);
+    CacheEntryView view;
+    uint64_t body_length = 0;
+    uint64_t head_length = 0;
+    if (!CacheEntry::decode_head(tail, view, body_length, head_length)) {
+        if (head_length == 0 || head_length + CacheEntry::TRAILER_SIZE <= tail.size()) {
+            return nullptr;  // Miss or malformed
         }
-        
-        size_t colon_pos = line.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string name = line.substr(0, colon_pos);
-            
-            // Skip whitespace after colon
-            size_t value_start = line.find_first_not_of(" \t", colon_pos + 1);
-            std::string value;
-            
-            if (value_start != std::string::npos) {
-                value = line.substr(value_start);
+        tail = redis_client_->get_range(cache_key, -static_cast<long long>(head_length + CacheEntry::TRAILER_SIZE), -1);
+        if (!CacheEntry::decode_head(tail, view, body_length, head_length)) {
+            return nullptr;
+        }
+    }
+    
+    // Stale, banned and non-200 entries take the regular path
+    CacheEntry entry;
+    entry.stored_at = view.stored_at;
+    entry.fresh_seconds = view.fresh_seconds;
+    if (view.status != static_cast<int>(HttpStatus::OK) || !entry.is_fresh(CacheEntry::now()) ||
+        ban_list_.is_banned(std::string(view.uri), view.stored_at)) {
+        return nullptr;
+    }
+    
+    auto head = std::make_shared<HttpResponse>(HttpStatus::OK);
+    for (const auto& header : view.headers) {
+        head->set_header(std::string(header.first), std::string(header.second));
+    }
+    head->set_header("Accept-Ranges", "bytes");
+    
+    if (Conditional::is_not_modified(*request, *head) || !Conditional::if_range_matches(*request, *head)) {
+        return nullptr;
+    }
+    
+    std::vector<HttpRange::ByteRange> ranges;
+    HttpResponsePtr response;
+    switch (HttpRange::parse(request->get_header("Range"), body_length, ranges)) {
+        case HttpRange::ParseResult::SATISFIABLE: {
+            // Small entries were read whole with the tail
+            bool whole = tail.size() == head_length + body_length + CacheEntry::TRAILER_SIZE;
+            std::vector<std::string> parts;
+            for (const auto& range : ranges) {
+                parts.push_back(whole
+                    ? tail.substr(range.first, range.length())
+                    : redis_client_->get_range(cache_key, static_cast<long long>(range.first),
+                                               static_cast<long long>(range.last)));
+                if (parts.back().size() != range.length()) {
+                    return nullptr;  // Replaced or evicted in the meantime
+                }
             }
-            
-            response->set_header(name, value);
+            response = HttpRange::make_partial(*head, body_length, ranges, std::move(parts));
+            break;
         }
+        case HttpRange::ParseResult::UNSATISFIABLE:
+            response = HttpRange::make_unsatisfiable(body_length);
+            break;
+        default:
+            return nullptr;
     }
     
-    // Set body
-    std::string content_type = response->get_header("Content-Type", "text/plain");
-    response->set_body(body, content_type);
+    // Requests that fall back to the regular path are counted there
+    if (admission_policy_) {
+        admission_policy_->record(cache_key);
+    }
     
-    // Add cache indicator header
+    Logger::getInstance().debug("Cache hit for " + request->uri() + " (range)");
     response->set_header("X-Proxy-Cache", "HIT");
-    
+    apply_cors_headers(request, response);
     return response;
 }
 
-void ProxyHandler::cache_response(HttpRequestPtr request, HttpResponsePtr response, const RouteConfig* route) {
-    // Only cache successful GET responses
-    if (request->method() != "GET" || response->status() != HttpStatus::OK) {
-        return;
+bool ProxyHandler::is_cacheable_status(const RouteConfig* route, int status) const {
+    return status == static_cast<int>(HttpStatus::OK) || route->cache_status_ttls.count(status) > 0;
+}
+
+HttpResponsePtr ProxyHandler::handle_purge_request(HttpRequestPtr request) {
+    auto response = std::make_shared<HttpResponse>(HttpStatus::OK);
+    
+    const std::string expected = config_.get_cache_admin_token();
+    std::string token = request->get_header("X-Admin-Token");
+    if (token.size() != expected.size() || CRYPTO_memcmp(token.data(), expected.data(), token.size()) != 0) {
+        response->set_status(HttpStatus::UNAUTHORIZED);
+        response->set_body("Unauthorized", "text/plain");
+        return response;
     }
     
-    // Skip caching if response says not to cache
-    std::string cache_control = response->get_header("Cache-Control");
-    if (cache_control.find("no-store") != std::string::npos ||
-        cache_control.find("no-cache") != std::string::npos ||
-        cache_control.find("private") != std::string::npos) {
-        return;
+    if (request->method() != "POST") {
+        response->set_status(HttpStatus::METHOD_NOT_ALLOWED);
+        response->set_body("Method Not Allowed", "text/plain");
+        return response;
     }
     
-    // Generate cache key
-    std::string cache_key = generate_cache_key(request);
+    if (!redis_client_) {
+        response->set_status(HttpStatus::SERVICE_UNAVAILABLE);
+        response->set_body("Cache is not enabled", "text/plain");
+        return response;
+    }
     
-    // Serialize response
-    std::string serialized = response->to_string();
+    Json::CharReaderBuilder reader;
+    Json::Value body;
+    std::string errors;
+    std::istringstream stream(request->body());
+    if (!Json::parseFromStream(reader, stream, &body, &errors) || !body.isObject()) {
+        response->set_status(HttpStatus::BAD_REQUEST);
+        response->set_body("Invalid purge request: " + errors, "text/plain");
+        return response;
+    }
     
-    // Store in Redis with TTL
-    redis_client_->set_with_expiry(cache_key, serialized, route->cache_ttl_seconds);
+    // URLs and prefixes are banned, which takes effect immediately without touching the cache
+    long long now = CacheEntry::now();
+    int bans = 0;
+    for (const char* field : {"urls", "prefixes"}) {
+        for (const auto& pattern : body[field]) {
+            Ban ban;
+            ban.prefix = std::string(field) == "prefixes";
+            ban.pattern = pattern.asString();
+            ban.created_at = now;
+            ban.expires_at = now + config_.get_cache_ban_ttl_seconds();
+            if (ban.pattern.empty()) {
+                continue;
+            }
+            
+            ban_list_.add(ban);
+            redis_client_->list_push(CACHE_BANS_KEY, ban.encode());
+            ++bans;
+        }
+    }
+    
+    // Tagged entries are deleted in the background, batch by batch
+    std::vector<std::string> tags;
+    for (const auto& tag : body["tags"]) {
+        if (!tag.asString().empty()) {
+            tags.push_back(tag.asString());
+        }
+    }
+    if (!tags.empty()) {
+        auto self = shared_from_this();
+        boost::asio::post(io_context_, [self, tags]() {
+            self->purge_tags(tags);
+        });
+        response->set_status(HttpStatus::ACCEPTED);
+    }
     
-    Logger::getInstance().debug("Cached response for " + request->uri() + " with TTL " + 
-             std::to_string(route->cache_ttl_seconds) + "s");
+    Logger::getInstance().info("Cache purge: " + std::to_string(bans) + " bans, " +
+                               std::to_string(tags.size()) + " tags");
+    response->set_body("{\"bans\":" + std::to_string(bans) + ",\"tags\":" + std::to_string(tags.size()) + "}",
+                       "application/json");
+    return response;
 }
 
-std::string ProxyHandler::generate_cache_key(HttpRequestPtr request) {
-    return "cache:" + request->method() + ":" + request->uri();
+void ProxyHandler::purge_tags(const std::vector<std::string>& tags) {
+    size_t purged = 0;
+    for (const auto& tag : tags) {
+        std::string tag_key = CACHE_TAG_PREFIX + tag;
+        std::vector<std::string> keys = redis_client_->set_members(tag_key);
+        
+        for (size_t start = 0; start < keys.size(); start += PURGE_BATCH_SIZE) {
+            std::vector<std::string> batch(keys.begin() + start,
+                                           keys.begin() + std::min(keys.size(), start + PURGE_BATCH_SIZE));
+            redis_client_->del(batch);
+            if (disk_cache_) {
+                for (const auto& key : batch) {
+                    disk_cache_->remove(key);
+                }
+            }
+        }
+        
+        redis_client_->del({tag_key});
+        purged += keys.size();
+    }
+    
+    Logger::getInstance().info("Purged " + std::to_string(purged) + " cache entries by tag");
 }
 
-void ProxyHandler::apply_compression(HttpRequestPtr request, HttpResponsePtr response) {
-    // Check if client accepts gzip
-    std::string accept_encoding = request->get_header("Accept-Encoding");
-    if (accept_encoding.find("gzip") == std::string::npos) {
-        return;  // Client doesn't support gzip
+std::string ProxyHandler::generate_cache_key(HttpRequestPtr request, const RouteConfig* route,
+                                             const std::string& encoding) {
+    std::string key = CacheKey::primary(*request, *route);
+    
+    // Include the request's values of the headers the resource varies on
+    for (const auto& name : vary_index_.lookup(key)) {
+        key += "\n" + name + ": " + request->get_header(name);
+    }
+    
+    if (!encoding.empty()) {
+        key += "\n#" + encoding;
+    }
+    return CacheKey::hash(key);
+}
+
+bool ProxyHandler::apply_compression(HttpRequestPtr request, HttpResponsePtr response, const RouteConfig* route,
+                                     const std::string& encoding, bool streaming) {
+    // Already encoded, e.g. a cached variant or a backend that compresses itself.
+    // Bodies served from the disk tier are sent as they are.
+    if (!response->get_header("Content-Encoding").empty() || response->file_body()) {
+        return false;
     }
     
     // Get content type
     std::string content_type = response->get_header("Content-Type");
-    
-    // Only compress text-based content
-    bool should_compress = 
-        content_type.find("text/") != std::string::npos ||
-        content_type.find("application/json") != std::string::npos ||
-        content_type.find("application/javascript") != std::string::npos ||
-        content_type.find("application/xml") != std::string::npos ||
-        content_type.find("application/xhtml+xml") != std::string::npos;
-    
-    if (!should_compress || response->body().size() < 1024) {
-        return;  // Don't compress small responses or binary data
+    if (!Compression::is_compressible(content_type) || response->body().size() < 1024) {
+        return false;  // Don't compress small responses or binary data
     }
     
-    // Compress the body with zlib
     const std::string& original_body = response->body();
-    z_stream zs;
-    memset(&zs, 0, sizeof(zs));
-    
-    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 | 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
-        Logger::getInstance().error("Failed to initialize zlib");
-        return;
+    auto level = route->compression_levels.find(encoding);
+    int compression_level = level != route->compression_levels.end() ? level->second
+                                                                      : Compression::default_level(encoding);
+    if (config_.is_compression_adaptive()) {
+        compression_level = Compression::adaptive_level(encoding, compression_level, original_body.size(),
+                                                        cpu_load_.current());
     }
     
-    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(original_body.data()));
-    zs.avail_in = original_body.size();
+    // Large bodies go to the compression pool rather than being compressed while they are sent
+    bool offload = compression_pool_ && original_body.size() >= config_.get_compression_offload_min_bytes();
     
-    int ret;
-    char outbuffer[32768];
-    std::string compressed_body;
+    // Chunked transfer needs HTTP/1.1, and HEAD responses carry no body to encode
+    if (streaming && !offload && request->http_version() == "HTTP/1.1" && request->method() != "HEAD") {
+        response->set_stream_encoding(encoding, compression_level);
+        Conditional::tag_variant(*response, encoding);
+        return true;
+    }
     
-    // Compress data
-    do {
-        zs.next_out = reinterpret_cast<Bytef*>(outbuffer);
-        zs.avail_out = sizeof(outbuffer);
-        
-        ret = deflate(&zs, Z_FINISH);
-        
-        if (compressed_body.size() < zs.total_out) {
-            compressed_body.append(outbuffer, zs.total_out - compressed_body.size());
+    // Compress the whole body up front
+    std::string compressed_body;
+    if (offload) {
+        CompressionPool::Result result = compression_pool_->compress(encoding, original_body, compressed_body,
+                                                                     compression_level);
+        if (result == CompressionPool::Result::REJECTED) {
+            Logger::getInstance().debug("Compression pool is full, sending " + request->uri() + " uncompressed");
+            return false;
         }
-    } while (ret == Z_OK);
+        if (result != CompressionPool::Result::COMPRESSED || compressed_body.size() >= original_body.size()) {
+            return false;
+        }
+    } else if (!Compression::compress(encoding, original_body, compressed_body, compression_level) ||
+               compressed_body.size() >= original_body.size()) {
+        return false;
+    }
     
-    deflateEnd(&zs);
+    Logger::getInstance().debug("Compressed response with " + encoding + " from " +
+             std::to_string(original_body.size()) + " to " + std::to_string(compressed_body.size()) + " bytes");
     
-    // If compression succeeded and resulted in smaller data
-    if (ret == Z_STREAM_END && compressed_body.size() < original_body.size()) {
-        // Update body and headers
-        response->set_body(compressed_body, content_type);
-        response->set_header("Content-Encoding", "gzip");
-        
-        Logger::getInstance().debug("Compressed response from " + std::to_string(original_body.size()) + 
-                 " to " + std::to_string(compressed_body.size()) + " bytes");
-    }
+    // Update body and headers
+    response->set_body(std::move(compressed_body), content_type);
+    response->set_header("Content-Encoding", encoding);
+    response->add_vary("Accept-Encoding");
+    Conditional::tag_variant(*response, encoding);
+    return true;
 }
@@ -1,14 +1,28 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <boost/asio.hpp>
+#include <curl/curl.h>
 #include "../http/RequestHandler.h"
 #include "../http/ResponseHandler.h"
 #include "../config/config.h"
 #include "../security/auth.h"
 #include "../cache/redis.h"
+#include "../cache/singleFlight.h"
+#include "../cache/cacheEntry.h"
+#include "../cache/cacheControl.h"
+#include "../cache/cacheKey.h"
+#include "../cache/admissionPolicy.h"
+#include "../cache/diskCache.h"
+#include "../cache/banList.h"
+#include "../cache/conditional.h"
 #include "loadBalancer.h"
+#include "hedgePolicy.h"
+#include "compressionPool.h"
+#include "../util/CpuLoad.h"
 
 /**
  * Proxy Handler class
@@ -43,11 +57,35 @@ public:
                          const std::string& client_ip);
 
 private:
+    /**
+     * State for a single upstream attempt
+     */
+    struct UpstreamTransfer {
+        CURL* curl = nullptr;
+        struct curl_slist* headers = nullptr;
+        const BackendServer* backend = nullptr;
+        std::string request_body;
+        std::string response_body;
+        std::map<std::string, std::string> response_headers;
+        
+        ~UpstreamTransfer();
+    };
+    
     Config& config_;
     boost::asio::io_context& io_context_;
     std::unique_ptr<Authentication> auth_;
     std::unique_ptr<RedisClient> redis_client_;
     std::unique_ptr<LoadBalancer> load_balancer_;
+    std::unique_ptr<HedgePolicy> hedge_policy_;
+    std::unique_ptr<AdmissionPolicy> admission_policy_;
+    std::unique_ptr<DiskCache> disk_cache_;
+    std::unique_ptr<CompressionPool> compression_pool_;
+    CpuLoad cpu_load_;                    // drives adaptive compression levels
+    SingleFlight single_flight_;
+    VaryIndex vary_index_;                // Vary header names of cached resources
+    BanList ban_list_;                    // URI bans evaluated on lookup
+    std::set<std::string> revalidating_;  // cache keys with a background refresh in flight
+    std::mutex revalidation_mutex_;
     
     /**
      * Forward a request to a backend server
@@ -57,13 +95,135 @@ private:
      */
     HttpResponsePtr forward_request(HttpRequestPtr request, const RouteConfig* route);
     
+    /**
+     * Fetch a response from upstream, coalescing identical cacheable requests
+     * @param request The request to forward
+     * @param route The matched route
+     * @param cached Expired cache entry to revalidate, if any
+     * @param stored Set to the entry the response was cached as, left alone if it was not
+     *               or if the response came from another caller's fetch
+     * @return The response from the backend
+     */
+    HttpResponsePtr fetch_upstream(HttpRequestPtr request, const RouteConfig* route,
+                                   std::shared_ptr<CacheEntry> cached = nullptr,
+                                   std::shared_ptr<CacheEntry>* stored = nullptr);
+    
+    /**
+     * Forward a request and store the response in the cache if it is cacheable
+     * An expired entry with validators is revalidated with a conditional request
+     * and reused when the backend answers 304 Not Modified. A 5xx response is not
+     * cached while that entry is within its stale-if-error window
+     * @param request The request to forward
+     * @param route The matched route
+     * @param cached Expired cache entry to revalidate, if any
+     * @param stored Set to the entry the response was cached as, left alone if it was not
+     * @return The response from the backend
+     */
+    HttpResponsePtr fetch_and_cache(HttpRequestPtr request, const RouteConfig* route,
+                                    std::shared_ptr<CacheEntry> cached = nullptr,
+                                    std::shared_ptr<CacheEntry>* stored = nullptr);
+    
+    /**
+     * Finish a response served from the cache
+     * Answers the client's conditional headers with 304 and marks the cache status
+     * @param request The client request
+     * @param response The cached response
+     * @param cache_status Value for the X-Proxy-Cache header
+     * @return The response to send back
+     */
+    HttpResponsePtr serve_cached(HttpRequestPtr request, HttpResponsePtr response, const std::string& cache_status);
+    
+    /**
+     * Answer a Range request for a full response
+     * @param request The client request
+     * @param response The full response
+     * @return 206 or 416 response, or the full response if no range applies
+     */
+    HttpResponsePtr apply_range(HttpRequestPtr request, HttpResponsePtr response);
+    
+    /**
+     * Serve a Range request for a fresh Redis entry without fetching its whole body
+     * Reads the entry's head from the end of the value, then only the requested ranges
+     * @param request The client request
+     * @param route The matched route
+     * @return The response, or nullptr to fall back to a regular lookup
+     */
+    HttpResponsePtr serve_cached_range(HttpRequestPtr request, const RouteConfig* route);
+    
+    /**
+     * Check if responses with a status code may be cached on a route
+     * @param route The matched route
+     * @param status HTTP status code
+     * @return True for 200 and for statuses listed in the route's cache_status_ttls
+     */
+    bool is_cacheable_status(const RouteConfig* route, int status) const;
+    
+    /**
+     * Handle a cache invalidation request from an operator
+     * The JSON body may list "urls" and "prefixes" to ban and "tags" to purge
+     * @param request The admin request
+     * @return Summary of the scheduled invalidations
+     */
+    HttpResponsePtr handle_purge_request(HttpRequestPtr request);
+    
+    /**
+     * Delete every cache entry carrying one of the given tags
+     * @param tags Surrogate keys to purge
+     */
+    void purge_tags(const std::vector<std::string>& tags);
+    
+    /**
+     * Forward a request and hedge it to a second backend if the first is slow
+     * or fails outright. The first successful attempt wins and the other one is cancelled
+     * @param request The request to forward
+     * @param route The matched route
+     * @param backend The backend for the first attempt
+     * @return The response from the winning backend
+     */
+    HttpResponsePtr forward_hedged_request(HttpRequestPtr request, const RouteConfig* route,
+                                           const BackendServer* backend);
+    
+    /**
+     * Set up a CURL transfer of a request to a backend
+     * @param request The request to forward
+     * @param backend The backend to send it to
+     * @return Prepared transfer or nullptr if CURL failed to initialize
+     */
+    std::unique_ptr<UpstreamTransfer> prepare_transfer(HttpRequestPtr request, const BackendServer* backend);
+    
+    /**
+     * Build a client response from a finished transfer
+     * @param transfer The finished transfer
+     * @param res CURL result of the transfer
+     * @return The response to send back
+     */
+    HttpResponsePtr build_response(UpstreamTransfer& transfer, CURLcode res);
+    
+    /**
+     * Feed the latency of a finished transfer into the hedge policy
+     * @param transfer The finished transfer
+     * @param route The matched route
+     */
+    void record_transfer_latency(UpstreamTransfer& transfer, const RouteConfig* route);
+    
     /**
      * Apply security checks to a request
      * @param request The request to check
      * @param client_ip The IP address of the client
+     * @param claims Output claims of the request's JWT, nullptr without one
      * @return True if the request passes security checks
      */
-    bool apply_security_checks(HttpRequestPtr request, const std::string& client_ip);
+    bool apply_security_checks(HttpRequestPtr request, const std::string& client_ip,
+                               std::shared_ptr<const JwtClaims>& claims);
+    
+    /**
+     * Replace the route's claim headers with the request's claims
+     * Headers from the client are always removed so they cannot be spoofed
+     * @param request The request to modify
+     * @param route The matched route
+     * @param claims Claims of the request's JWT, may be nullptr
+     */
+    void apply_claim_headers(HttpRequestPtr request, const RouteConfig& route, const JwtClaims* claims);
     
     /**
      * Apply CORS headers to a response
@@ -72,40 +232,81 @@ private:
      */
     void apply_cors_headers(HttpRequestPtr request, HttpResponsePtr response);
     
+    /**
+     * Check if a request is a CORS preflight the proxy answers itself
+     * @param request The request to check
+     * @return True for OPTIONS requests with Origin and Access-Control-Request-Method
+     *         when CORS origins are configured
+     */
+    bool is_preflight(HttpRequestPtr request) const;
+    
+    /**
+     * Answer a CORS preflight request from the CORS policy
+     * @param request The preflight request
+     * @return 204 with the preflight headers, or 403 if the origin, method or headers are not allowed
+     */
+    HttpResponsePtr handle_preflight(HttpRequestPtr request);
+    
     /**
      * Check if a request exceeds rate limits
-     * @param client_ip The IP address of the client
+     * @param client_key The client IP, or the configured claim identifying the client
      * @return True if the request is allowed
      */
-    bool check_rate_limit(const std::string& client_ip);
+    bool check_rate_limit(const std::string& client_key);
     
     /**
-     * Try to get a cached response
+     * Try to get a cached entry, fresh or stale
      * @param request The request
      * @param route The matched route
-     * @return Cached response or nullptr if not found
+     * @param encoding Content coding of the variant to look up (empty for identity)
+     * @return Cached entry or nullptr if not found
+     */
+    std::shared_ptr<CacheEntry> get_cached_entry(HttpRequestPtr request, const RouteConfig* route,
+                                                 const std::string& encoding = "");
+    
+    /**
+     * Refresh a cached entry in the background
+     * Only one refresh per cache key runs at a time, on a thread of its own, and
+     * refreshes beyond a fixed number in flight are skipped
+     * @param request The request whose response should be refreshed
+     * @param route The matched route
+     * @param cached The stale entry being refreshed
      */
-    HttpResponsePtr get_cached_response(HttpRequestPtr request, const RouteConfig* route);
+    void schedule_revalidation(HttpRequestPtr request, const RouteConfig* route,
+                               std::shared_ptr<CacheEntry> cached);
     
     /**
      * Store a response in the cache
      * @param request The original request
      * @param response The response to cache
      * @param route The matched route
+     * @param encoding Content coding of the response (empty for identity)
+     * @param source Entry a variant was derived from, whose lifetime it shares
+     * @return The stored entry, or nullptr if the response was not stored
      */
-    void cache_response(HttpRequestPtr request, HttpResponsePtr response, const RouteConfig* route);
+    std::shared_ptr<CacheEntry> cache_response(HttpRequestPtr request, HttpResponsePtr response,
+                                               const RouteConfig* route, const std::string& encoding = "",
+                                               const CacheEntry* source = nullptr);
     
     /**
      * Apply compression to a response if appropriate
      * @param request The original request
      * @param response The response to compress
+     * @param route The matched route, holding the compression levels
+     * @param encoding Content coding negotiated with the client
+     * @param streaming Compress while the response is sent instead of up front
+     * @return True if the response body was compressed (or will be when sent)
      */
-    void apply_compression(HttpRequestPtr request, HttpResponsePtr response);
+    bool apply_compression(HttpRequestPtr request, HttpResponsePtr response, const RouteConfig* route,
+                           const std::string& encoding, bool streaming = false);
     
     /**
      * Generate a key for caching a request
      * @param request The request
+     * @param route The matched route, whose cache key options apply
+     * @param encoding Content coding of the cached variant (empty for identity)
      * @return Cache key string
      */
-    std::string generate_cache_key(HttpRequestPtr request);
+    std::string generate_cache_key(HttpRequestPtr request, const RouteConfig* route,
+                                   const std::string& encoding = "");
 };
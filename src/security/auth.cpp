@@ -1,24 +1,65 @@
 #include "auth.h"
 #include "../util/logger.h"
 #include <json/json.h>
-#include <openssl/hmac.h>
-#include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
-#include <openssl/sha.h>
+#include "base64url.h"
+#include <algorithm>
 #include <chrono>
-#include <vector>
 #include <sstream>
 
-Authentication::Authentication(Config& config) : config_(config) {
-    secret_ = config.get_jwt_secret();
+Authentication::Authentication(Config& config)
+    : config_(config), secret_(config.get_jwt_secret()), signer_(secret_) {
+    
+    // Only the claims something uses are extracted: validation, forwarding, routing and rate limiting
+    claim_names_ = {"exp", "nbf", "sub", "aud"};
+    auto add_claim = [this](const std::string& name) {
+        if (!name.empty() && std::find(claim_names_.begin(), claim_names_.end(), name) == claim_names_.end()) {
+            claim_names_.push_back(name);
+        }
+    };
+    for (const auto& route : config.get_routes()) {
+        for (const auto& claim : route.claim_headers) {
+            add_claim(claim.first);
+        }
+        for (const auto& claim : route.match_claims) {
+            add_claim(claim.first);
+        }
+    }
+    add_claim(config.get_rate_limit_key_claim());
     
-    if (secret_.empty()) {
+    if (config.get_jwt_cache_size() > 0) {
+        token_cache_ = std::make_unique<TokenCache>(config.get_jwt_cache_size());
+    }
+    
+    // Public keys for RS256, ES256 and EdDSA tokens
+    if (!config.get_jwks_source().empty()) {
+        jwks_ = std::make_unique<JwkSet>(config.get_jwks_source());
+        jwks_->load();
+        
+        // Tokens signed with a key that was rotated out must be verified again
+        jwks_->start_refresh(std::chrono::seconds(config.get_jwks_refresh_seconds()), [this]() {
+            if (token_cache_) {
+                token_cache_->clear();
+            }
+        });
+    }
+    
+    if (secret_.empty() && !jwks_) {
         Logger::getInstance().error("JWT secret is empty", "Auth");
     }
 }
 
 bool Authentication::verify_jwt(const std::string& token) {
+    VerifiedToken verified;
+    return verify_jwt(token, verified);
+}
+
+bool Authentication::verify_jwt(const std::string& token, VerifiedToken& verified) {
+    auto now_sec = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (token_cache_ && token_cache_->lookup(token, now_sec, verified)) {
+        return true;
+    }
+    
     try {
         // Split token into parts
         size_t first_dot = token.find('.');
@@ -29,37 +70,39 @@ bool Authentication::verify_jwt(const std::string& token) {
             return false;
         }
         
-        std::string header_b64 = token.substr(0, first_dot);
-        std::string payload_b64 = token.substr(first_dot + 1, second_dot - first_dot - 1);
-        std::string signature_b64 = token.substr(second_dot + 1);
-        
-        // Verify signature
-        std::string data_to_sign = header_b64 + "." + payload_b64;
-        
-        // Calculate HMAC-SHA256
-        unsigned char hmac[EVP_MAX_MD_SIZE];
-        unsigned int hmac_len;
-        
-        HMAC(EVP_sha256(), secret_.c_str(), secret_.length(),
-             reinterpret_cast<const unsigned char*>(data_to_sign.c_str()),
-             data_to_sign.length(), hmac, &hmac_len);
-        
-        // Base64 URL encode the HMAC
-        std::string computed_signature_b64 = base64_url_encode(
-            std::string(reinterpret_cast<char*>(hmac), hmac_len)
-        );
-        
-        // Compare signatures
-        if (computed_signature_b64 != signature_b64) {
+        std::string_view token_view(token);
+        std::string_view signed_part = token_view.substr(0, second_dot);
+        std::string_view payload_b64 = token_view.substr(first_dot + 1, second_dot - first_dot - 1);
+        std::string_view signature_b64 = token_view.substr(second_dot + 1);
+        
+        // Decode the signature once into a buffer large enough for RSA-4096
+        unsigned char signature[512];
+        long signature_size = Base64Url::decode(signature_b64, signature, sizeof(signature));
+        if (signature_size < 0 ||
+            !verify_signature(token_view.substr(0, first_dot), signed_part, signature,
+                              static_cast<size_t>(signature_size))) {
             Logger::getInstance().warning("JWT signature verification failed", "Auth");
             return false;
         }
         
         // Decode payload
-        std::string payload_json = base64_url_decode(payload_b64);
+        std::string payload_json;
+        if (!Base64Url::decode(payload_b64, payload_json)) {
+            Logger::getInstance().warning("Invalid JWT payload encoding", "Auth");
+            return false;
+        }
         
         // Validate payload contents (expiry, etc.)
-        return validate_payload(payload_json);
+        auto claims = std::make_shared<JwtClaims>();
+        if (!validate_payload(payload_json, *claims, verified.expires_at)) {
+            return false;
+        }
+        
+        verified.claims = claims;
+        if (token_cache_) {
+            token_cache_->insert(token, verified);
+        }
+        return true;
     }
     catch (const std::exception& e) {
         Logger::getInstance().error("Exception during JWT verification: " + std::string(e.what()), "Auth");
@@ -99,24 +142,21 @@ std::string Authentication::generate_jwt(const std::string& subject, int expiry_
         }
         
         // Base64 URL encode
-        std::string header_b64 = base64_url_encode(header_json);
-        std::string payload_b64 = base64_url_encode(payload_json);
+        std::string header_b64 = Base64Url::encode(header_json);
+        std::string payload_b64 = Base64Url::encode(payload_json);
         
         // Data to sign
         std::string data_to_sign = header_b64 + "." + payload_b64;
         
         // Calculate HMAC-SHA256
-        unsigned char hmac[EVP_MAX_MD_SIZE];
-        unsigned int hmac_len;
-        
-        HMAC(EVP_sha256(), secret_.c_str(), secret_.length(),
-             reinterpret_cast<const unsigned char*>(data_to_sign.c_str()),
-             data_to_sign.length(), hmac, &hmac_len);
+        unsigned char hmac[HmacSigner::MAC_SIZE];
+        if (!signer_.sign(data_to_sign, hmac)) {
+            Logger::getInstance().error("Failed to sign JWT", "Auth");
+            return "";
+        }
         
         // Base64 URL encode the HMAC
-        std::string signature_b64 = base64_url_encode(
-            std::string(reinterpret_cast<char*>(hmac), hmac_len)
-        );
+        std::string signature_b64 = Base64Url::encode(hmac, sizeof(hmac));
         
         // Assemble JWT
         return data_to_sign + "." + signature_b64;
@@ -127,85 +167,45 @@ std::string Authentication::generate_jwt(const std::string& subject, int expiry_
     }
 }
 
-std::string Authentication::base64_url_decode(const std::string& input) {
-    // Convert base64url to base64
-    std::string base64 = input;
-    std::replace(base64.begin(), base64.end(), '-', '+');
-    std::replace(base64.begin(), base64.end(), '_', '/');
+bool Authentication::verify_signature(std::string_view header_b64, std::string_view signed_part,
+                                      const unsigned char* signature, size_t signature_size) {
+    static const std::vector<std::string> header_names = {"alg", "kid"};
     
-    // Add padding if needed
-    switch (base64.size() % 4) {
-        case 0: break;
-        case 2: base64 += "=="; break;
-        case 3: base64 += "="; break;
-        default: throw std::runtime_error("Illegal base64url string");
+    std::string header_json;
+    JwtClaims header;
+    if (!Base64Url::decode(header_b64, header_json) || !ClaimScanner::scan(header_json, header_names, header)) {
+        return false;
     }
     
-    // Decode base64
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    
-    BIO* bmem = BIO_new_mem_buf(base64.c_str(), base64.length());
-    bmem = BIO_push(b64, bmem);
-    
-    std::vector<char> buffer(base64.size());
-    int decoded_size = BIO_read(bmem, buffer.data(), buffer.size());
-    
-    BIO_free_all(bmem);
-    
-    if (decoded_size <= 0) {
-        throw std::runtime_error("Failed to decode base64url");
+    // The algorithm is only trusted as far as the key it selects allows
+    const std::string& alg = header["alg"];
+    if (alg == "HS256") {
+        return !secret_.empty() && signer_.verify(signed_part, signature, signature_size);
     }
-    
-    return std::string(buffer.data(), decoded_size);
-}
-
-std::string Authentication::base64_url_encode(const std::string& input) {
-    BIO* bmem = BIO_new(BIO_s_mem());
-    BIO* b64 = BIO_new(BIO_f_base64());
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    bmem = BIO_push(b64, bmem);
-    
-    BIO_write(bmem, input.c_str(), input.length());
-    BIO_flush(bmem);
-    
-    BUF_MEM* bptr;
-    BIO_get_mem_ptr(bmem, &bptr);
-    
-    std::string result(bptr->data, bptr->length);
-    
-    BIO_free_all(bmem);
-    
-    // Convert base64 to base64url
-    std::replace(result.begin(), result.end(), '+', '-');
-    std::replace(result.begin(), result.end(), '/', '_');
-    
-    // Remove padding
-    while (!result.empty() && result.back() == '=') {
-        result.pop_back();
+    if (!jwks_) {
+        return false;
     }
     
-    return result;
+    auto key = jwks_->find(header["kid"]);
+    return key && key->alg == alg && key->verify(signed_part, signature, signature_size);
 }
 
-bool Authentication::validate_payload(const std::string& payload_json) {
-    Json::CharReaderBuilder reader;
-    Json::Value payload;
-    std::string errors;
-    
-    std::istringstream stream(payload_json);
-    if (!Json::parseFromStream(reader, stream, &payload, &errors)) {
-        Logger::getInstance().warning("Failed to parse JWT payload: " + errors, "Auth");
+bool Authentication::validate_payload(std::string_view payload_json, JwtClaims& claims, long long& expires_at) {
+    NumericDates dates;
+    if (!ClaimScanner::scan(payload_json, claim_names_, claims, &dates)) {
+        Logger::getInstance().warning("Failed to parse JWT payload", "Auth");
         return false;
     }
     
     // Check expiry time
-    if (!payload.isMember("exp") || !payload["exp"].isInt64()) {
+    auto exp_claim = dates.find("exp");
+    if (exp_claim == dates.end()) {
         Logger::getInstance().warning("JWT missing expiry time", "Auth");
         return false;
     }
+    long long exp = exp_claim->second;
+    expires_at = exp;
     
-    Json::Value::Int64 exp = payload["exp"].asInt64();
     auto now = std::chrono::system_clock::now();
     auto now_sec = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
     
@@ -214,7 +214,22 @@ bool Authentication::validate_payload(const std::string& payload_json) {
         return false;
     }
     
-    // Add additional validation as needed
+    // Tokens that are not valid yet
+    auto nbf = dates.find("nbf");
+    if (nbf != dates.end() && now_sec < nbf->second) {
+        Logger::getInstance().warning("JWT is not valid yet", "Auth");
+        return false;
+    }
+    
+    // The audience may be a single string or a list, which the scanner joins with ','
+    const std::string& audience = config_.get_jwt_audience();
+    if (!audience.empty()) {
+        std::string aud = "," + claims["aud"] + ",";
+        if (aud.find("," + audience + ",") == std::string::npos) {
+            Logger::getInstance().warning("JWT is not meant for this audience", "Auth");
+            return false;
+        }
+    }
     
     return true;
 }
@@ -2,7 +2,13 @@
 
 #include <string>
 #include <memory>
+#include <string_view>
+#include <vector>
 #include "../config/config.h"
+#include "claimScanner.h"
+#include "tokenCache.h"
+#include "hmacSigner.h"
+#include "jwks.h"
 
 /**
  * Authentication class
@@ -18,11 +24,20 @@ public:
     
     /**
      * Verify a JWT token
+     * Tokens verified before are accepted from the token cache until they expire
      * @param token JWT token to verify
      * @return True if token is valid
      */
     bool verify_jwt(const std::string& token);
     
+    /**
+     * Verify a JWT token and get its claims
+     * @param token JWT token to verify
+     * @param verified Output expiry and claims of a valid token
+     * @return True if token is valid
+     */
+    bool verify_jwt(const std::string& token, VerifiedToken& verified);
+    
     /**
      * Generate a JWT token for testing
      * @param subject Subject identifier
@@ -34,25 +49,30 @@ public:
 private:
     Config& config_;
     std::string secret_;
+    HmacSigner signer_;
+    std::unique_ptr<TokenCache> token_cache_;  // nullptr when disabled
+    std::unique_ptr<JwkSet> jwks_;             // nullptr without a JWKS source
+    std::vector<std::string> claim_names_;     // claims extracted from payloads
     
     /**
-     * Base64 URL decode a string
-     * @param input Base64 URL encoded string
-     * @return Decoded string
-     */
-    std::string base64_url_decode(const std::string& input);
-    
-    /**
-     * Base64 URL encode a string
-     * @param input String to encode
-     * @return Base64 URL encoded string
+     * Verify a token's signature with the key its header selects
+     * HS256 uses the shared secret; RS256, ES256 and EdDSA a key from the JWKS
+     * @param header_b64 Encoded token header
+     * @param signed_part The "header.payload" part of the token
+     * @param signature Decoded signature
+     * @param signature_size Size of the signature
+     * @return True if the signature is valid
      */
-    std::string base64_url_encode(const std::string& input);
+    bool verify_signature(std::string_view header_b64, std::string_view signed_part,
+                          const unsigned char* signature, size_t signature_size);
     
     /**
-     * Parse and validate JWT payload
+     * Extract the claims the proxy uses from a JWT payload and validate them
+     * Checks exp, nbf and, when an audience is configured, aud
      * @param payload_json JSON payload string
+     * @param claims Output claims
+     * @param expires_at Output exp claim, seconds since the epoch
      * @return True if payload is valid
      */
-    bool validate_payload(const std::string& payload_json);
+    bool validate_payload(std::string_view payload_json, JwtClaims& claims, long long& expires_at);
 };
\ No newline at end of file
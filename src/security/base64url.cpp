@@ -0,0 +1,105 @@
+#include "base64url.h"
+#include <array>
+#include <cstdint>
+
+namespace {
+    const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    const unsigned char INVALID = 0xff;
+
+    constexpr std::array<unsigned char, 256> make_decode_table() {
+        std::array<unsigned char, 256> table{};
+        for (auto& value : table) {
+            value = INVALID;
+        }
+        for (unsigned char i = 0; i < 64; ++i) {
+            table[static_cast<unsigned char>(ALPHABET[i])] = i;
+        }
+        return table;
+    }
+
+    constexpr std::array<unsigned char, 256> DECODE = make_decode_table();
+}
+
+namespace Base64Url {
+    long decode(std::string_view input, unsigned char* output, size_t capacity) {
+        // A single leftover character cannot encode a whole byte
+        if (input.size() % 4 == 1 || decoded_size(input.size()) > capacity) {
+            return -1;
+        }
+
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(input.data());
+        size_t full = input.size() / 4 * 4;
+        unsigned char* out = output;
+
+        for (size_t i = 0; i < full; i += 4) {
+            unsigned a = DECODE[in[i]], b = DECODE[in[i + 1]], c = DECODE[in[i + 2]], d = DECODE[in[i + 3]];
+            if ((a | b | c | d) & 0xc0) {  // INVALID has the high bits set
+                return -1;
+            }
+            uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+            out[0] = static_cast<unsigned char>(group >> 16);
+            out[1] = static_cast<unsigned char>(group >> 8);
+            out[2] = static_cast<unsigned char>(group);
+            out += 3;
+        }
+
+        size_t rest = input.size() - full;
+        if (rest > 0) {
+            unsigned a = DECODE[in[full]], b = DECODE[in[full + 1]];
+            unsigned c = rest == 3 ? DECODE[in[full + 2]] : 0;
+            if ((a | b | c) & 0xc0) {
+                return -1;
+            }
+            uint32_t group = (a << 18) | (b << 12) | (c << 6);
+            *out++ = static_cast<unsigned char>(group >> 16);
+            if (rest == 3) {
+                *out++ = static_cast<unsigned char>(group >> 8);
+            }
+        }
+
+        return static_cast<long>(out - output);
+    }
+
+    bool decode(std::string_view input, std::string& output) {
+        output.resize(decoded_size(input.size()));
+        long size = decode(input, reinterpret_cast<unsigned char*>(&output[0]), output.size());
+        if (size < 0) {
+            output.clear();
+            return false;
+        }
+        output.resize(static_cast<size_t>(size));
+        return true;
+    }
+
+    std::string encode(const unsigned char* data, size_t size) {
+        std::string output;
+        output.resize((size * 4 + 2) / 3);
+
+        char* out = &output[0];
+        size_t i = 0;
+        for (; i + 3 <= size; i += 3) {
+            uint32_t group = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            *out++ = ALPHABET[(group >> 18) & 0x3f];
+            *out++ = ALPHABET[(group >> 12) & 0x3f];
+            *out++ = ALPHABET[(group >> 6) & 0x3f];
+            *out++ = ALPHABET[group & 0x3f];
+        }
+
+        if (i < size) {
+            uint32_t group = data[i] << 16;
+            if (i + 1 < size) {
+                group |= data[i + 1] << 8;
+            }
+            *out++ = ALPHABET[(group >> 18) & 0x3f];
+            *out++ = ALPHABET[(group >> 12) & 0x3f];
+            if (i + 1 < size) {
+                *out++ = ALPHABET[(group >> 6) & 0x3f];
+            }
+        }
+        return output;
+    }
+
+    std::string encode(std::string_view data) {
+        return encode(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * Base64url coding (RFC 4648 section 5) without padding, as used by JWTs
+ * Table driven and working on caller buffers, so decoding a signature
+ * needs no allocation.
+ */
+namespace Base64Url {
+    /**
+     * Size of the decoded form of an encoded string
+     * @param encoded_size Length of the encoded string
+     */
+    constexpr size_t decoded_size(size_t encoded_size) {
+        return encoded_size / 4 * 3 + (encoded_size % 4 == 0 ? 0 : encoded_size % 4 - 1);
+    }
+
+    /**
+     * Decode into a caller buffer
+     * @param input Encoded string, without padding
+     * @param output Buffer for the decoded bytes
+     * @param capacity Size of the buffer
+     * @return Number of decoded bytes, or -1 if the input is malformed or does not fit
+     */
+    long decode(std::string_view input, unsigned char* output, size_t capacity);
+
+    /**
+     * Decode into a string
+     * @param input Encoded string, without padding
+     * @param output Decoded bytes
+     * @return False if the input is malformed
+     */
+    bool decode(std::string_view input, std::string& output);
+
+    /**
+     * Encode bytes
+     * @param data Bytes to encode
+     * @param size Number of bytes
+     * @return Encoded string without padding
+     */
+    std::string encode(const unsigned char* data, size_t size);
+
+    /**
+     * Encode a string
+     */
+    std::string encode(std::string_view data);
+}
@@ -0,0 +1,349 @@
+#include "claimScanner.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+    // Deeper payloads are rejected rather than skipped
+    const int MAX_DEPTH = 32;
+
+    // Kinds of claim values the scanner keeps
+    enum class ValueKind { SKIPPED, STRING, LITERAL };
+
+    /**
+     * Check a literal against the JSON number grammar
+     */
+    bool is_json_number(const std::string& text) {
+        size_t pos = 0;
+        auto digits = [&text, &pos]() {
+            size_t start = pos;
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                ++pos;
+            }
+            return pos - start;
+        };
+
+        if (pos < text.size() && text[pos] == '-') {
+            ++pos;
+        }
+        if (pos < text.size() && text[pos] == '0') {
+            ++pos;
+        } else if (digits() == 0) {
+            return false;
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            if (digits() == 0) {
+                return false;
+            }
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+                ++pos;
+            }
+            if (digits() == 0) {
+                return false;
+            }
+        }
+        return pos == text.size();
+    }
+
+    /**
+     * Convert a JSON number to whole seconds, rejecting values outside long long
+     */
+    bool to_seconds(const std::string& text, long long& value) {
+        if (!is_json_number(text)) {
+            return false;
+        }
+        double number = std::strtod(text.c_str(), nullptr);
+        if (!(number > -9.2e18 && number < 9.2e18)) {
+            return false;
+        }
+        value = static_cast<long long>(number);
+        return true;
+    }
+
+    /**
+     * Check for bytes that cannot appear in a header value, such as CR, LF and NUL
+     */
+    bool has_control_characters(const std::string& value) {
+        return std::any_of(value.begin(), value.end(), [](char c) {
+            return static_cast<unsigned char>(c) < 0x20 || c == 0x7f;
+        });
+    }
+
+    class Scanner {
+    public:
+        explicit Scanner(std::string_view text) : text_(text), pos_(0) {}
+
+        void skip_whitespace() {
+            while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+                ++pos_;
+            }
+        }
+
+        bool consume(char c) {
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == c) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        bool peek(char c) {
+            skip_whitespace();
+            return pos_ < text_.size() && text_[pos_] == c;
+        }
+
+        /**
+         * Read a string, unescaping it only if it contains escapes
+         */
+        bool read_string(std::string& out) {
+            if (!consume('"')) {
+                return false;
+            }
+
+            size_t start = pos_;
+            while (pos_ < text_.size() && text_[pos_] != '"' && text_[pos_] != '\\') {
+                ++pos_;
+            }
+            out.assign(text_.data() + start, pos_ - start);
+
+            while (pos_ < text_.size() && text_[pos_] != '"') {
+                char c = text_[pos_++];
+                if (c != '\\') {
+                    out.push_back(c);
+                    continue;
+                }
+                if (pos_ >= text_.size()) {
+                    return false;
+                }
+                char escape = text_[pos_++];
+                switch (escape) {
+                    case '"': out.push_back('"'); break;
+                    case '\\': out.push_back('\\'); break;
+                    case '/': out.push_back('/'); break;
+                    case 'b': out.push_back('\b'); break;
+                    case 'f': out.push_back('\f'); break;
+                    case 'n': out.push_back('\n'); break;
+                    case 'r': out.push_back('\r'); break;
+                    case 't': out.push_back('\t'); break;
+                    case 'u': {
+                        unsigned long code;
+                        if (!read_hex4(code)) {
+                            return false;
+                        }
+                        // Surrogate pair
+                        if (code >= 0xd800 && code <= 0xdbff && text_.substr(pos_, 2) == "\\u") {
+                            pos_ += 2;
+                            unsigned long low;
+                            if (!read_hex4(low) || low < 0xdc00 || low > 0xdfff) {
+                                return false;
+                            }
+                            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        }
+                        append_utf8(out, code);
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+            return consume_raw('"');
+        }
+
+        /**
+         * Read a scalar or an array of strings as claim text
+         * @return False on malformed JSON
+         */
+        bool read_value(std::string& out, ValueKind& kind) {
+            kind = ValueKind::SKIPPED;
+            skip_whitespace();
+            if (peek('"')) {
+                kind = ValueKind::STRING;
+                return read_string(out);
+            }
+            if (peek('[')) {
+                size_t start = pos_;
+                if (read_string_array(out)) {
+                    kind = ValueKind::STRING;
+                    return true;
+                }
+                pos_ = start;
+                return skip_value();
+            }
+            if (peek('{')) {
+                return skip_value();
+            }
+
+            std::string_view literal = read_literal();
+            out.assign(literal.data(), literal.size());
+            kind = ValueKind::LITERAL;
+            return !out.empty();
+        }
+
+        /**
+         * Skip any value, tracking nesting but not interpreting it
+         */
+        bool skip_value() {
+            skip_whitespace();
+            if (pos_ >= text_.size()) {
+                return false;
+            }
+            std::string ignored;
+            if (text_[pos_] == '"') {
+                return read_string(ignored);
+            }
+            if (text_[pos_] != '{' && text_[pos_] != '[') {
+                return !read_literal().empty();
+            }
+
+            int depth = 0;
+            do {
+                if (pos_ >= text_.size()) {
+                    return false;
+                }
+                char c = text_[pos_];
+                if (c == '"') {
+                    if (!read_string(ignored)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (c == '{' || c == '[') {
+                    if (++depth > MAX_DEPTH) {
+                        return false;
+                    }
+                } else if (c == '}' || c == ']') {
+                    --depth;
+                }
+                ++pos_;
+            } while (depth > 0);
+            return true;
+        }
+
+        /**
+         * Read a number, true, false or null as written
+         */
+        std::string_view read_literal() {
+            skip_whitespace();
+            size_t start = pos_;
+            while (pos_ < text_.size() && text_[pos_] != ',' && text_[pos_] != '}' && text_[pos_] != ']' &&
+                   text_[pos_] != '"' && !std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+                ++pos_;
+            }
+            return text_.substr(start, pos_ - start);
+        }
+
+    private:
+        std::string_view text_;
+        size_t pos_;
+
+        bool consume_raw(char c) {
+            if (pos_ < text_.size() && text_[pos_] == c) {
+                ++pos_;
+                return true;
+            }
+            return false;
+        }
+
+        bool read_hex4(unsigned long& code) {
+            if (pos_ + 4 > text_.size()) {
+                return false;
+            }
+            std::string hex(text_.substr(pos_, 4));
+            if (!std::all_of(hex.begin(), hex.end(), ::isxdigit)) {
+                return false;
+            }
+            code = std::strtoul(hex.c_str(), nullptr, 16);
+            pos_ += 4;
+            return true;
+        }
+
+        static void append_utf8(std::string& out, unsigned long code) {
+            if (code < 0x80) {
+                out.push_back(static_cast<char>(code));
+            } else if (code < 0x800) {
+                out.push_back(static_cast<char>(0xc0 | (code >> 6)));
+                out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+            } else if (code < 0x10000) {
+                out.push_back(static_cast<char>(0xe0 | (code >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+            } else {
+                out.push_back(static_cast<char>(0xf0 | (code >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+            }
+        }
+
+        bool read_string_array(std::string& out) {
+            consume('[');
+            out.clear();
+            if (consume(']')) {
+                return true;
+            }
+            std::string element;
+            do {
+                if (!peek('"') || !read_string(element)) {
+                    return false;
+                }
+                if (!out.empty()) {
+                    out.push_back(',');
+                }
+                out += element;
+            } while (consume(','));
+            return consume(']');
+        }
+    };
+}
+
+namespace ClaimScanner {
+    bool scan(std::string_view payload, const std::vector<std::string>& names, JwtClaims& claims,
+              NumericDates* dates) {
+        Scanner scanner(payload);
+        if (!scanner.consume('{')) {
+            return false;
+        }
+        if (scanner.consume('}')) {
+            return true;
+        }
+
+        std::string name;
+        std::string value;
+        do {
+            if (!scanner.read_string(name) || !scanner.consume(':')) {
+                return false;
+            }
+
+            if (std::find(names.begin(), names.end(), name) == names.end()) {
+                if (!scanner.skip_value()) {
+                    return false;
+                }
+                continue;
+            }
+
+            ValueKind kind;
+            if (!scanner.read_value(value, kind)) {
+                return false;
+            }
+            // Claims end up in upstream request headers and rate-limit keys, where a
+            // "\r\n" from a user-controlled claim would inject headers
+            if (kind == ValueKind::SKIPPED || has_control_characters(value)) {
+                continue;
+            }
+
+            // Only JSON numbers are dates, "exp": "1900000000" is not
+            long long seconds;
+            if (dates && kind == ValueKind::LITERAL && to_seconds(value, seconds)) {
+                (*dates)[name] = seconds;
+            }
+            claims[name] = value;
+        } while (scanner.consume(','));
+
+        return scanner.consume('}');
+    }
+}
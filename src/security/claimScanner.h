@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Claims taken from a JWT payload, by claim name
+ * Strings are unescaped, numbers and booleans kept as written, and arrays
+ * of strings (such as aud) joined with ','. Values never contain control
+ * characters, so they can be forwarded as header values.
+ */
+using JwtClaims = std::map<std::string, std::string>;
+
+/**
+ * Numeric claims such as exp and nbf, in whole seconds since the epoch
+ */
+using NumericDates = std::map<std::string, long long>;
+
+/**
+ * Single-pass scanner for JWT payloads
+ * Walks the top-level object once and copies out only the requested
+ * claims, skipping every other value without building a document.
+ */
+namespace ClaimScanner {
+    /**
+     * Extract claims from a payload
+     * Requested claims holding objects, arrays of non-strings or control characters are skipped.
+     * @param payload JSON text of the payload
+     * @param names Claims to extract
+     * @param claims Output claims that were present
+     * @param dates Optional output of the extracted claims that are JSON numbers, as NumericDates
+     * @return False if the payload is not a JSON object
+     */
+    bool scan(std::string_view payload, const std::vector<std::string>& names, JwtClaims& claims,
+              NumericDates* dates = nullptr);
+}
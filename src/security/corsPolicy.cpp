@@ -0,0 +1,131 @@
+#include "corsPolicy.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    std::string to_lower(std::string_view value) {
+        std::string lower(value);
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        return lower;
+    }
+
+    std::string_view trim(std::string_view value) {
+        size_t start = value.find_first_not_of(" \t");
+        if (start == std::string_view::npos) {
+            return std::string_view();
+        }
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(start, end - start + 1);
+    }
+
+    std::string join(const std::vector<std::string>& values) {
+        std::string joined;
+        for (const auto& value : values) {
+            if (!joined.empty()) {
+                joined += ", ";
+            }
+            joined += value;
+        }
+        return joined;
+    }
+}
+
+CorsPolicy::CorsPolicy() : any_origin_(false),
+    response_headers_(std::make_shared<const std::string>()),
+    preflight_headers_(std::make_shared<const std::string>()) {
+}
+
+CorsPolicy::CorsPolicy(const std::vector<std::string>& origins, const std::vector<std::string>& methods,
+                       const std::vector<std::string>& headers, bool allow_credentials, int max_age_seconds)
+    : any_origin_(false) {
+    for (const auto& origin : origins) {
+        std::string lower = to_lower(origin);
+        size_t scheme_end = lower.find("://");
+        if (lower == "*") {
+            any_origin_ = true;
+        } else if (scheme_end != std::string::npos && lower.compare(scheme_end + 3, 2, "*.") == 0) {
+            wildcard_parents_.insert(lower.substr(0, scheme_end + 3) + lower.substr(scheme_end + 4));
+        } else {
+            origins_.insert(lower);
+        }
+    }
+    for (const auto& method : methods) {
+        methods_.insert(method);
+    }
+    for (const auto& header : headers) {
+        headers_.insert(to_lower(header));
+    }
+
+    // The allowed origin itself is echoed per request, so caches must key on it
+    std::string response_block = "Vary: Origin\r\n";
+    if (allow_credentials) {
+        response_block += "Access-Control-Allow-Credentials: true\r\n";
+    }
+
+    std::string preflight_block = response_block;
+    preflight_block += "Access-Control-Allow-Methods: " + join(methods) + "\r\n";
+    preflight_block += "Access-Control-Allow-Headers: " + join(headers) + "\r\n";
+    preflight_block += "Access-Control-Max-Age: " + std::to_string(max_age_seconds) + "\r\n";
+
+    response_headers_ = std::make_shared<const std::string>(std::move(response_block));
+    preflight_headers_ = std::make_shared<const std::string>(std::move(preflight_block));
+}
+
+bool CorsPolicy::empty() const {
+    return !any_origin_ && origins_.empty() && wildcard_parents_.empty();
+}
+
+bool CorsPolicy::allows_origin(std::string_view origin) const {
+    if (any_origin_) {
+        return !origin.empty();
+    }
+
+    // Browsers send origins in lowercase, anything else is compared as-is
+    std::string key(origin);
+    if (origins_.count(key) > 0) {
+        return true;
+    }
+    if (wildcard_parents_.empty()) {
+        return false;
+    }
+
+    // Try every parent domain of the host: a.b.example.com -> .b.example.com, .example.com, .com
+    size_t host_start = key.find("://");
+    if (host_start == std::string::npos) {
+        return false;
+    }
+    host_start += 3;
+    std::string parent = key.substr(0, host_start);
+    for (size_t dot = key.find('.', host_start + 1); dot != std::string::npos; dot = key.find('.', dot + 1)) {
+        parent.resize(host_start);
+        parent.append(key, dot, std::string::npos);
+        if (wildcard_parents_.count(parent) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CorsPolicy::allows_request(std::string_view method, std::string_view headers) const {
+    if (methods_.count(std::string(trim(method))) == 0) {
+        return false;
+    }
+
+    while (!headers.empty()) {
+        size_t comma = headers.find(',');
+        std::string_view header = trim(headers.substr(0, comma));
+        if (!header.empty() && headers_.count(to_lower(header)) == 0) {
+            return false;
+        }
+        headers = comma == std::string_view::npos ? std::string_view() : headers.substr(comma + 1);
+    }
+    return true;
+}
+
+const std::shared_ptr<const std::string>& CorsPolicy::response_headers() const {
+    return response_headers_;
+}
+
+const std::shared_ptr<const std::string>& CorsPolicy::preflight_headers() const {
+    return preflight_headers_;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * CORS Policy class
+ * The CORS configuration compiled once at config load.
+ *
+ * Origins are kept in a hash set. Wildcard subdomain patterns, an origin
+ * whose host is "*.example.com", are kept in a second set keyed by scheme
+ * and parent domain (".example.com"), so an origin is checked with one
+ * lookup per label of its host instead of a scan over the configured list.
+ * The headers that are the same for every allowed request are formatted
+ * once into blocks that responses append when their head is serialized.
+ */
+class CorsPolicy {
+public:
+    CorsPolicy();
+
+    /**
+     * Compile a policy
+     * @param origins Allowed origins: exact origins, "*" or origins with a "*." host prefix
+     * @param methods Methods allowed in preflight requests
+     * @param headers Request headers allowed in preflight requests
+     * @param allow_credentials Whether responses allow credentials
+     * @param max_age_seconds How long browsers may cache a preflight result
+     */
+    CorsPolicy(const std::vector<std::string>& origins, const std::vector<std::string>& methods,
+               const std::vector<std::string>& headers, bool allow_credentials, int max_age_seconds);
+
+    /**
+     * True if no origins are configured, so the proxy does not answer CORS itself
+     */
+    bool empty() const;
+
+    /**
+     * Check whether an origin is allowed
+     * @param origin Value of the request's Origin header
+     */
+    bool allows_origin(std::string_view origin) const;
+
+    /**
+     * Check whether a preflight request may be allowed
+     * @param method Value of Access-Control-Request-Method
+     * @param headers Value of Access-Control-Request-Headers, may be empty
+     */
+    bool allows_request(std::string_view method, std::string_view headers) const;
+
+    /**
+     * Headers added to every response to an allowed origin
+     * Formatted as header lines, each ending with CRLF
+     */
+    const std::shared_ptr<const std::string>& response_headers() const;
+
+    /**
+     * Headers added to preflight responses, including those of response_headers()
+     */
+    const std::shared_ptr<const std::string>& preflight_headers() const;
+
+private:
+    bool any_origin_;
+    std::unordered_set<std::string> origins_;
+    std::unordered_set<std::string> wildcard_parents_;  // scheme and ".domain" for "*.domain" hosts
+    std::unordered_set<std::string> methods_;
+    std::unordered_set<std::string> headers_;           // lowercase
+    std::shared_ptr<const std::string> response_headers_;
+    std::shared_ptr<const std::string> preflight_headers_;
+};
@@ -0,0 +1,62 @@
+#include "hmacSigner.h"
+#include <atomic>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+
+namespace {
+    std::atomic<uint64_t> next_signer_id{1};
+
+    /**
+     * The calling thread's HMAC context and the signer it is keyed for
+     */
+    struct ThreadContext {
+        EVP_MAC* mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+        EVP_MAC_CTX* ctx = mac ? EVP_MAC_CTX_new(mac) : nullptr;
+
+        ~ThreadContext() {
+            EVP_MAC_CTX_free(ctx);
+            EVP_MAC_free(mac);
+        }
+        uint64_t signer_id = 0;
+    };
+}
+
+HmacSigner::HmacSigner(const std::string& secret) : secret_(secret), id_(next_signer_id++) {
+}
+
+bool HmacSigner::sign(std::string_view data, unsigned char* mac) const {
+    thread_local ThreadContext context;
+    if (!context.ctx) {
+        return false;
+    }
+    
+    // Keying derives the pads from the secret; afterwards a null key just resets to them
+    bool rekey = context.signer_id != id_;
+    context.signer_id = 0;
+    const unsigned char* key = rekey ? reinterpret_cast<const unsigned char*>(secret_.data()) : nullptr;
+    size_t key_size = rekey ? secret_.size() : 0;
+    
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+        OSSL_PARAM_construct_end()
+    };
+    size_t mac_size = 0;
+    if (!EVP_MAC_init(context.ctx, key, key_size, rekey ? params : nullptr) ||
+        !EVP_MAC_update(context.ctx, reinterpret_cast<const unsigned char*>(data.data()), data.size()) ||
+        !EVP_MAC_final(context.ctx, mac, &mac_size, MAC_SIZE)) {
+        return false;
+    }
+    
+    context.signer_id = id_;
+    return mac_size == MAC_SIZE;
+}
+
+bool HmacSigner::verify(std::string_view data, const unsigned char* mac, size_t mac_size) const {
+    unsigned char expected[MAC_SIZE];
+    if (mac_size != MAC_SIZE || !sign(data, expected)) {
+        return false;
+    }
+    return CRYPTO_memcmp(expected, mac, MAC_SIZE) == 0;
+}
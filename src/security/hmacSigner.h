@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * HMAC-SHA256 Signer class
+ * Each thread keeps an HMAC context keyed with the signer's secret, so
+ * signing only resets the context instead of fetching the digest and
+ * deriving the key pads again.
+ */
+class HmacSigner {
+public:
+    static constexpr size_t MAC_SIZE = 32;
+    
+    /**
+     * Constructor
+     * @param secret HMAC key
+     */
+    explicit HmacSigner(const std::string& secret);
+    
+    /**
+     * Compute the MAC of some data
+     * @param data Data to sign
+     * @param mac Output buffer of MAC_SIZE bytes
+     * @return False on an OpenSSL error
+     */
+    bool sign(std::string_view data, unsigned char* mac) const;
+    
+    /**
+     * Check a MAC in constant time
+     * @param data Signed data
+     * @param mac MAC to check
+     * @param mac_size Size of the MAC to check
+     * @return True if the MAC matches
+     */
+    bool verify(std::string_view data, const unsigned char* mac, size_t mac_size) const;
+
+private:
+    std::string secret_;
+    uint64_t id_;  // tells thread contexts keyed for another signer apart
+};
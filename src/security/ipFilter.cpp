@@ -0,0 +1,135 @@
+#include "ipFilter.h"
+#include <arpa/inet.h>
+#include <cstring>
+
+namespace {
+    const uint32_t IPV4_ROOT = 0;
+    const uint32_t IPV6_ROOT = 1;
+
+    const unsigned char IPV4_MAPPED_PREFIX[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+    int bit_at(const unsigned char* address, int index) {
+        return (address[index / 8] >> (7 - index % 8)) & 1;
+    }
+
+    /**
+     * Parse a textual address into network byte order
+     * @return Address size (4 or 16), or 0 if it cannot be parsed
+     */
+    size_t parse_address(std::string_view text, unsigned char* address) {
+        // inet_pton needs a terminated string, addresses are at most INET6_ADDRSTRLEN long
+        char buffer[INET6_ADDRSTRLEN];
+        if (text.empty() || text.size() >= sizeof(buffer)) {
+            return 0;
+        }
+        std::memcpy(buffer, text.data(), text.size());
+        buffer[text.size()] = '\0';
+
+        if (inet_pton(AF_INET, buffer, address) == 1) {
+            return 4;
+        }
+        if (inet_pton(AF_INET6, buffer, address) == 1) {
+            return 16;
+        }
+        return 0;
+    }
+}
+
+IpFilter::IpFilter() : nodes_(2), allow_rules_(0), deny_rules_(0) {
+}
+
+bool IpFilter::add(const std::string& rule, bool allow) {
+    Verdict verdict = allow ? ALLOW : DENY;
+
+    if (rule == "*" || rule == "0.0.0.0") {
+        nodes_[IPV4_ROOT].verdict = verdict;
+        nodes_[IPV6_ROOT].verdict = verdict;
+        ++(allow ? allow_rules_ : deny_rules_);
+        return true;
+    }
+
+    size_t slash = rule.find('/');
+    unsigned char address[16];
+    size_t size = parse_address(std::string_view(rule).substr(0, slash), address);
+    if (size == 0) {
+        return false;
+    }
+
+    int max_length = static_cast<int>(size * 8);
+    int prefix_length = max_length;
+    if (slash != std::string::npos) {
+        std::string digits = rule.substr(slash + 1);
+        if (digits.empty() || digits.size() > 3 || digits.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        prefix_length = std::stoi(digits);
+        if (prefix_length > max_length) {
+            return false;
+        }
+    }
+
+    // Mapped IPv6 ranges that stay inside ::ffff:0:0/96 are IPv4 ranges
+    if (size == 16 && prefix_length >= 96 && std::memcmp(address, IPV4_MAPPED_PREFIX, 12) == 0) {
+        insert(IPV4_ROOT, address + 12, prefix_length - 96, verdict);
+    } else {
+        insert(size == 4 ? IPV4_ROOT : IPV6_ROOT, address, prefix_length, verdict);
+    }
+    ++(allow ? allow_rules_ : deny_rules_);
+    return true;
+}
+
+void IpFilter::insert(uint32_t root, const unsigned char* address, int prefix_length, Verdict verdict) {
+    uint32_t node = root;
+    for (int i = 0; i < prefix_length; ++i) {
+        int bit = bit_at(address, i);
+        if (nodes_[node].child[bit] == 0) {
+            nodes_[node].child[bit] = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        node = nodes_[node].child[bit];
+    }
+    nodes_[node].verdict = verdict;
+}
+
+bool IpFilter::allows(std::string_view address) const {
+    if (empty()) {
+        return true;
+    }
+
+    unsigned char binary[16];
+    size_t size = parse_address(address, binary);
+    return size != 0 && allows(binary, size);
+}
+
+bool IpFilter::allows(const unsigned char* address, size_t size) const {
+    if (size == 16 && std::memcmp(address, IPV4_MAPPED_PREFIX, 12) == 0) {
+        address += 12;
+        size = 4;
+    }
+    if (size != 4 && size != 16) {
+        return false;
+    }
+
+    // Walk the address bits, the deepest node with a verdict is the most specific rule
+    uint32_t node = size == 4 ? IPV4_ROOT : IPV6_ROOT;
+    Verdict verdict = nodes_[node].verdict;
+    int bits = static_cast<int>(size * 8);
+    for (int i = 0; i < bits; ++i) {
+        node = nodes_[node].child[bit_at(address, i)];
+        if (node == 0) {
+            break;
+        }
+        if (nodes_[node].verdict != NONE) {
+            verdict = nodes_[node].verdict;
+        }
+    }
+
+    if (verdict == NONE) {
+        return allow_rules_ == 0;
+    }
+    return verdict == ALLOW;
+}
+
+bool IpFilter::empty() const {
+    return allow_rules_ == 0 && deny_rules_ == 0;
+}
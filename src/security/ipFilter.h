@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * IP Filter class
+ * Allow and deny rules for client addresses, given as single addresses or
+ * CIDR ranges (e.g. "10.0.0.0/8", "2001:db8::/32"), IPv4 and IPv6.
+ *
+ * Rules are compiled into one binary prefix trie per address family, so a
+ * lookup walks at most 32 (IPv4) or 128 (IPv6) nodes whatever the number
+ * of rules. The most specific rule covering an address decides, so a deny
+ * range can carve a hole out of an allow range and the other way round.
+ * Addresses no rule covers are allowed only when there are no allow rules.
+ *
+ * IPv4-mapped IPv6 addresses (::ffff:a.b.c.d) are looked up as IPv4.
+ * The filter is built once and only read afterwards, so lookups take no lock.
+ */
+class IpFilter {
+public:
+    IpFilter();
+
+    /**
+     * Add a rule
+     * "*" covers every address, as does "0.0.0.0" for compatibility with
+     * older whitelists that used it as a wildcard.
+     * @param rule Address or CIDR range
+     * @param allow True for an allow rule, false for a deny rule
+     * @return False if the rule cannot be parsed
+     */
+    bool add(const std::string& rule, bool allow);
+
+    /**
+     * Check whether a client address is allowed
+     * @param address Textual IPv4 or IPv6 address
+     * @return False if a deny rule matches, an allow rule is required but
+     *         none matches, or the address cannot be parsed
+     */
+    bool allows(std::string_view address) const;
+
+    /**
+     * Check whether a binary address is allowed
+     * @param address Address in network byte order
+     * @param size 4 for IPv4, 16 for IPv6
+     */
+    bool allows(const unsigned char* address, size_t size) const;
+
+    /**
+     * True if there are no rules, so every address is allowed
+     */
+    bool empty() const;
+
+private:
+    enum Verdict : uint8_t { NONE, ALLOW, DENY };
+
+    /**
+     * Trie node, children are indices into nodes_ (0 means none, the root is never a child)
+     */
+    struct Node {
+        uint32_t child[2] = {0, 0};
+        Verdict verdict = NONE;
+    };
+
+    std::vector<Node> nodes_;  // nodes_[0] is the IPv4 root, nodes_[1] the IPv6 root
+    size_t allow_rules_;
+    size_t deny_rules_;
+
+    /**
+     * Insert a prefix below a root, later rules for the same prefix replace earlier ones
+     */
+    void insert(uint32_t root, const unsigned char* address, int prefix_length, Verdict verdict);
+};
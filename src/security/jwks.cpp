@@ -0,0 +1,330 @@
+#include "jwks.h"
+#include "base64url.h"
+#include "../util/Logger.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <curl/curl.h>
+#include <json/json.h>
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/ec.h>
+#include <openssl/param_build.h>
+
+namespace {
+    const long FETCH_TIMEOUT_SECONDS = 5;
+    const int MIN_RSA_BITS = 2048;
+    const size_t P256_COORDINATE_SIZE = 32;
+
+    size_t append_to_string(char* ptr, size_t size, size_t nmemb, std::string* data) {
+        data->append(ptr, size * nmemb);
+        return size * nmemb;
+    }
+
+    /**
+     * Read a string member, the fallback if it is missing and empty if it is not a string
+     */
+    std::string string_member(const Json::Value& jwk, const char* name, const char* fallback = "") {
+        const Json::Value& member = jwk[name];
+        return member.isString() ? member.asString() : (member.isNull() ? fallback : "");
+    }
+
+    std::vector<unsigned char> decode_member(const Json::Value& jwk, const char* name) {
+        std::string decoded;
+        if (!jwk[name].isString() || !Base64Url::decode(jwk[name].asString(), decoded)) {
+            return {};
+        }
+        return std::vector<unsigned char>(decoded.begin(), decoded.end());
+    }
+
+    /**
+     * Build a public key from OpenSSL key parameters
+     */
+    EVP_PKEY* key_from_params(const char* type, OSSL_PARAM_BLD* builder) {
+        EVP_PKEY* pkey = nullptr;
+        OSSL_PARAM* params = OSSL_PARAM_BLD_to_param(builder);
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(nullptr, type, nullptr);
+        if (!params || !ctx || EVP_PKEY_fromdata_init(ctx) <= 0 ||
+            EVP_PKEY_fromdata(ctx, &pkey, EVP_PKEY_PUBLIC_KEY, params) <= 0) {
+            pkey = nullptr;
+        }
+        EVP_PKEY_CTX_free(ctx);
+        OSSL_PARAM_free(params);
+        return pkey;
+    }
+
+    EVP_PKEY* rsa_key(const Json::Value& jwk) {
+        std::vector<unsigned char> n = decode_member(jwk, "n");
+        std::vector<unsigned char> e = decode_member(jwk, "e");
+        if (n.empty() || e.empty()) {
+            return nullptr;
+        }
+
+        BIGNUM* modulus = BN_bin2bn(n.data(), static_cast<int>(n.size()), nullptr);
+        BIGNUM* exponent = BN_bin2bn(e.data(), static_cast<int>(e.size()), nullptr);
+        OSSL_PARAM_BLD* builder = OSSL_PARAM_BLD_new();
+        EVP_PKEY* pkey = nullptr;
+        if (modulus && exponent && builder &&
+            OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_N, modulus) &&
+            OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_E, exponent)) {
+            pkey = key_from_params("RSA", builder);
+        }
+        OSSL_PARAM_BLD_free(builder);
+        BN_free(modulus);
+        BN_free(exponent);
+
+        if (pkey && EVP_PKEY_get_bits(pkey) < MIN_RSA_BITS) {
+            EVP_PKEY_free(pkey);
+            return nullptr;
+        }
+        return pkey;
+    }
+
+    EVP_PKEY* p256_key(const Json::Value& jwk) {
+        std::vector<unsigned char> x = decode_member(jwk, "x");
+        std::vector<unsigned char> y = decode_member(jwk, "y");
+        if (string_member(jwk, "crv") != "P-256" || x.size() != P256_COORDINATE_SIZE || y.size() != P256_COORDINATE_SIZE) {
+            return nullptr;
+        }
+
+        // Uncompressed point encoding
+        std::vector<unsigned char> point;
+        point.push_back(0x04);
+        point.insert(point.end(), x.begin(), x.end());
+        point.insert(point.end(), y.begin(), y.end());
+
+        OSSL_PARAM_BLD* builder = OSSL_PARAM_BLD_new();
+        EVP_PKEY* pkey = nullptr;
+        if (builder &&
+            OSSL_PARAM_BLD_push_utf8_string(builder, OSSL_PKEY_PARAM_GROUP_NAME, "prime256v1", 0) &&
+            OSSL_PARAM_BLD_push_octet_string(builder, OSSL_PKEY_PARAM_PUB_KEY, point.data(), point.size())) {
+            pkey = key_from_params("EC", builder);
+        }
+        OSSL_PARAM_BLD_free(builder);
+        return pkey;
+    }
+
+    EVP_PKEY* ed25519_key(const Json::Value& jwk) {
+        std::vector<unsigned char> x = decode_member(jwk, "x");
+        if (string_member(jwk, "crv") != "Ed25519" || x.empty()) {
+            return nullptr;
+        }
+        return EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, x.data(), x.size());
+    }
+
+    /**
+     * Convert a JWS ES256 signature (r || s) to the DER form OpenSSL verifies
+     */
+    bool ecdsa_to_der(const unsigned char* signature, size_t size, std::vector<unsigned char>& der) {
+        if (size != 2 * P256_COORDINATE_SIZE) {
+            return false;
+        }
+
+        ECDSA_SIG* sig = ECDSA_SIG_new();
+        BIGNUM* r = BN_bin2bn(signature, P256_COORDINATE_SIZE, nullptr);
+        BIGNUM* s = BN_bin2bn(signature + P256_COORDINATE_SIZE, P256_COORDINATE_SIZE, nullptr);
+        if (!sig || !r || !s || !ECDSA_SIG_set0(sig, r, s)) {
+            BN_free(r);
+            BN_free(s);
+            ECDSA_SIG_free(sig);
+            return false;
+        }
+
+        int length = i2d_ECDSA_SIG(sig, nullptr);
+        if (length > 0) {
+            der.resize(static_cast<size_t>(length));
+            unsigned char* out = der.data();
+            i2d_ECDSA_SIG(sig, &out);
+        }
+        ECDSA_SIG_free(sig);
+        return length > 0;
+    }
+}
+
+bool JwkKey::verify(std::string_view signed_part, const unsigned char* signature, size_t signature_size) const {
+    std::vector<unsigned char> der;
+    if (alg == "ES256") {
+        if (!ecdsa_to_der(signature, signature_size, der)) {
+            return false;
+        }
+        signature = der.data();
+        signature_size = der.size();
+    }
+
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    if (!ctx) {
+        return false;
+    }
+
+    // EdDSA signs the message itself, the other algorithms a SHA-256 digest of it
+    const EVP_MD* digest = alg == "EdDSA" ? nullptr : EVP_sha256();
+    bool valid = EVP_DigestVerifyInit(ctx, nullptr, digest, nullptr, pkey.get()) == 1 &&
+                 EVP_DigestVerify(ctx, signature, signature_size,
+                                  reinterpret_cast<const unsigned char*>(signed_part.data()), signed_part.size()) == 1;
+    EVP_MD_CTX_free(ctx);
+    return valid;
+}
+
+JwkSet::JwkSet(const std::string& source) : source_(source), keys_(std::make_shared<KeyMap>()) {
+}
+
+JwkSet::~JwkSet() {
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+        stopping_ = true;
+    }
+    refresh_stop_.notify_all();
+    if (refresh_thread_.joinable()) {
+        refresh_thread_.join();
+    }
+}
+
+bool JwkSet::load() {
+    std::string document;
+    if (!fetch(document)) {
+        Logger::getInstance().error("Cannot read JWKS from " + source_, "JwkSet");
+        return false;
+    }
+    if (!loaded_document_.empty() && document == loaded_document_) {
+        return true;
+    }
+
+    // A malformed document, e.g. a member of the wrong type, must not take down the refresh thread
+    auto keys = std::make_shared<KeyMap>();
+    bool parsed = false;
+    try {
+        parsed = parse(document, *keys);
+    } catch (const std::exception& e) {
+        Logger::getInstance().error("Invalid JWKS from " + source_ + ": " + e.what(), "JwkSet");
+    }
+    if (!parsed) {
+        Logger::getInstance().error("No usable keys in JWKS from " + source_ + ", keeping the current keys", "JwkSet");
+        return false;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(keys_mutex_);
+        keys_ = keys;
+    }
+    bool replaced = !loaded_document_.empty();
+    loaded_document_ = std::move(document);
+
+    Logger::getInstance().info("Loaded " + std::to_string(keys->size()) + " JWKS keys from " + source_, "JwkSet");
+    if (replaced && on_change_) {
+        on_change_();
+    }
+    return true;
+}
+
+void JwkSet::start_refresh(std::chrono::seconds interval, std::function<void()> on_change) {
+    if (refresh_thread_.joinable() || interval.count() <= 0) {
+        return;
+    }
+
+    on_change_ = std::move(on_change);
+    refresh_thread_ = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(refresh_mutex_);
+        while (!refresh_stop_.wait_for(lock, interval, [this]() { return stopping_; })) {
+            lock.unlock();
+            try {
+                load();
+            } catch (const std::exception& e) {
+                Logger::getInstance().error(std::string("JWKS refresh failed: ") + e.what(), "JwkSet");
+            }
+            lock.lock();
+        }
+    });
+}
+
+std::shared_ptr<const JwkKey> JwkSet::find(const std::string& kid) const {
+    std::shared_ptr<const KeyMap> keys;
+    {
+        std::shared_lock<std::shared_mutex> lock(keys_mutex_);
+        keys = keys_;
+    }
+
+    if (kid.empty()) {
+        return keys->size() == 1 ? keys->begin()->second : nullptr;
+    }
+    auto it = keys->find(kid);
+    return it != keys->end() ? it->second : nullptr;
+}
+
+size_t JwkSet::size() const {
+    std::shared_lock<std::shared_mutex> lock(keys_mutex_);
+    return keys_->size();
+}
+
+bool JwkSet::fetch(std::string& document) const {
+    if (source_.compare(0, 7, "http://") != 0 && source_.compare(0, 8, "https://") != 0) {
+        std::ifstream file(source_);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        document = contents.str();
+        return true;
+    }
+
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        return false;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, source_.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append_to_string);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &document);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, FETCH_TIMEOUT_SECONDS);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    CURLcode result = curl_easy_perform(curl);
+    curl_easy_cleanup(curl);
+    return result == CURLE_OK;
+}
+
+bool JwkSet::parse(const std::string& document, KeyMap& keys) {
+    Json::CharReaderBuilder reader;
+    Json::Value root;
+    std::string errors;
+    std::istringstream stream(document);
+    if (!Json::parseFromStream(reader, stream, &root, &errors) || !root.isObject() || !root["keys"].isArray()) {
+        return false;
+    }
+
+    for (const auto& jwk : root["keys"]) {
+        if (!jwk.isObject()) {
+            Logger::getInstance().warning("Skipping JWKS key that is not an object", "JwkSet");
+            continue;
+        }
+        std::string kty = string_member(jwk, "kty");
+        std::string use = string_member(jwk, "use", "sig");
+        if (use != "sig") {
+            continue;
+        }
+
+        auto key = std::make_shared<JwkKey>();
+        key->kid = string_member(jwk, "kid");
+        EVP_PKEY* pkey = nullptr;
+        if (kty == "RSA") {
+            key->alg = "RS256";
+            pkey = rsa_key(jwk);
+        } else if (kty == "EC") {
+            key->alg = "ES256";
+            pkey = p256_key(jwk);
+        } else if (kty == "OKP") {
+            key->alg = "EdDSA";
+            pkey = ed25519_key(jwk);
+        }
+
+        // A key bound to another algorithm is never used, so tokens cannot switch algorithms
+        if (!pkey || (jwk.isMember("alg") && string_member(jwk, "alg") != key->alg)) {
+            EVP_PKEY_free(pkey);
+            Logger::getInstance().warning("Skipping unsupported JWKS key '" + key->kid + "'", "JwkSet");
+            continue;
+        }
+
+        key->pkey = std::shared_ptr<EVP_PKEY>(pkey, EVP_PKEY_free);
+        keys[key->kid] = key;
+    }
+    return !keys.empty();
+}
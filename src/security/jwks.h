@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <openssl/evp.h>
+
+/**
+ * A public key from a JWKS document, ready to verify signatures with
+ */
+struct JwkKey {
+    std::string kid;
+    std::string alg;  // JWS algorithm the key verifies: RS256, ES256 or EdDSA
+    std::shared_ptr<EVP_PKEY> pkey;
+    
+    /**
+     * Verify a JWS signature
+     * @param signed_part The "header.payload" part of the token
+     * @param signature Raw signature bytes (r || s for ES256)
+     * @param signature_size Number of signature bytes
+     * @return True if the signature is valid for this key
+     */
+    bool verify(std::string_view signed_part, const unsigned char* signature, size_t signature_size) const;
+};
+
+/**
+ * JWK Set class
+ * Holds the public keys JWTs are verified with, loaded from a JWKS file or
+ * a local HTTP endpoint. Keys are parsed once into EVP_PKEY objects indexed
+ * by kid and replaced as a whole on refresh, so verification only looks a
+ * key up and never parses key material on the request path.
+ */
+class JwkSet {
+public:
+    /**
+     * Constructor
+     * @param source JWKS file path, or an http(s):// URL
+     */
+    explicit JwkSet(const std::string& source);
+    
+    /**
+     * Stops the background refresh
+     */
+    ~JwkSet();
+    
+    JwkSet(const JwkSet&) = delete;
+    JwkSet& operator=(const JwkSet&) = delete;
+    
+    /**
+     * Load the keys from the source
+     * The current keys are kept if the source cannot be read or holds no usable key
+     * @return True if the keys were loaded
+     */
+    bool load();
+    
+    /**
+     * Reload the keys periodically on a background thread
+     * @param interval Time between reloads
+     * @param on_change Called after a reload that changed the keys
+     */
+    void start_refresh(std::chrono::seconds interval, std::function<void()> on_change = nullptr);
+    
+    /**
+     * Find the key for a token
+     * @param kid Key id from the token header, may be empty
+     * @return The key, or nullptr if there is none. Without a kid only a sole key matches.
+     */
+    std::shared_ptr<const JwkKey> find(const std::string& kid) const;
+    
+    /**
+     * Number of loaded keys
+     */
+    size_t size() const;
+
+private:
+    using KeyMap = std::map<std::string, std::shared_ptr<const JwkKey>>;
+    
+    std::string source_;
+    std::string loaded_document_;     // last document read, to detect changes
+    std::function<void()> on_change_;
+    
+    mutable std::shared_mutex keys_mutex_;
+    std::shared_ptr<const KeyMap> keys_;
+    
+    std::mutex refresh_mutex_;
+    std::condition_variable refresh_stop_;
+    bool stopping_ = false;
+    std::thread refresh_thread_;
+    
+    /**
+     * Read the JWKS document from the file or URL
+     */
+    bool fetch(std::string& document) const;
+    
+    /**
+     * Parse a JWKS document, skipping keys that are not supported
+     */
+    static bool parse(const std::string& document, KeyMap& keys);
+};
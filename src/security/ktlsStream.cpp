@@ -0,0 +1,112 @@
+#include "ktlsStream.h"
+#include <boost/asio/ssl/error.hpp>
+#include <cerrno>
+#include <openssl/err.h>
+
+KtlsStream::KtlsStream(boost::asio::ip::tcp::socket socket, SSL_CTX* ctx)
+    : socket_(std::move(socket)), ssl_(SSL_new(ctx)) {
+    if (!ssl_ || SSL_set_fd(ssl_, socket_.native_handle()) != 1) {
+        // The destructor does not run when the constructor throws
+        SSL_free(ssl_);
+        ssl_ = nullptr;
+        throw boost::system::system_error(make_error(0), "KtlsStream");
+    }
+    SSL_set_accept_state(ssl_);
+    socket_.native_non_blocking(true);
+}
+
+KtlsStream::~KtlsStream() {
+    SSL_free(ssl_);
+}
+
+KtlsStream::HandshakeStep KtlsStream::handshake_step() {
+    ERR_clear_error();
+    int result = SSL_do_handshake(ssl_);
+    if (result == 1) {
+        // Requests are served with blocking I/O
+        boost::system::error_code ignored;
+        socket_.native_non_blocking(false, ignored);
+        return HandshakeStep::DONE;
+    }
+
+    switch (SSL_get_error(ssl_, result)) {
+        case SSL_ERROR_WANT_READ:
+            return HandshakeStep::WANT_READ;
+        case SSL_ERROR_WANT_WRITE:
+            return HandshakeStep::WANT_WRITE;
+        default:
+            return HandshakeStep::FAILED;
+    }
+}
+
+bool KtlsStream::ktls_send() const {
+    return BIO_get_ktls_send(SSL_get_wbio(ssl_));
+}
+
+size_t KtlsStream::read(void* data, size_t size, boost::system::error_code& error) {
+    ERR_clear_error();
+    size_t read = 0;
+    int result = SSL_read_ex(ssl_, data, size, &read);
+    error = result == 1 ? boost::system::error_code() : make_error(result);
+    return read;
+}
+
+size_t KtlsStream::write(const void* data, size_t size, boost::system::error_code& error) {
+    ERR_clear_error();
+    size_t written = 0;
+    int result = SSL_write_ex(ssl_, data, size, &written);
+    error = result == 1 ? boost::system::error_code() : make_error(result);
+    return written;
+}
+
+size_t KtlsStream::sendfile(int fd, long long offset, size_t size, boost::system::error_code& error) {
+#ifndef OPENSSL_NO_KTLS
+    ERR_clear_error();
+    ossl_ssize_t sent = SSL_sendfile(ssl_, fd, static_cast<off_t>(offset), size, 0);
+    if (sent >= 0) {
+        error = boost::system::error_code();
+        return static_cast<size_t>(sent);
+    }
+    error = make_error(-1);
+#else
+    (void)fd;
+    (void)offset;
+    (void)size;
+    error = boost::asio::error::operation_not_supported;
+#endif
+    return 0;
+}
+
+void KtlsStream::shutdown(boost::system::error_code& error) {
+    ERR_clear_error();
+    int result = SSL_shutdown(ssl_);
+    error = result >= 0 ? boost::system::error_code() : make_error(result);
+}
+
+boost::asio::ip::tcp::socket& KtlsStream::lowest_layer() {
+    return socket_;
+}
+
+SSL* KtlsStream::native_handle() {
+    return ssl_;
+}
+
+boost::system::error_code KtlsStream::make_error(int result) const {
+    int ssl_error = ssl_ ? SSL_get_error(ssl_, result) : SSL_ERROR_SSL;
+    switch (ssl_error) {
+        case SSL_ERROR_ZERO_RETURN:
+            return boost::asio::error::eof;
+        case SSL_ERROR_SYSCALL:
+            if (errno != 0) {
+                return boost::system::error_code(errno, boost::system::system_category());
+            }
+            return boost::asio::error::eof;
+        default: {
+            unsigned long code = ERR_get_error();
+            if (code == 0) {
+                return boost::system::error_code(EIO, boost::system::system_category());
+            }
+            return boost::system::error_code(static_cast<int>(code), boost::asio::error::get_ssl_category());
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <openssl/ssl.h>
+
+/**
+ * Kernel TLS Stream class
+ * A TLS connection whose SSL object works on the socket itself instead of
+ * Boost.Asio's memory BIO pair, so OpenSSL can hand the session keys to
+ * the kernel (kTLS) once the handshake completes. Encryption of writes and
+ * of sendfile then happens in the kernel.
+ *
+ * The handshake is driven step by step on a non-blocking socket, so it
+ * can run under the io_context like ssl::stream::async_handshake. After
+ * it the socket is blocking again and the stream meets Asio's
+ * SyncReadStream and SyncWriteStream requirements. Without kTLS in the
+ * kernel, or for ciphers it does not support, OpenSSL encrypts in user
+ * space and the stream works the same, only without the offload.
+ */
+class KtlsStream {
+public:
+    enum class HandshakeStep { DONE, WANT_READ, WANT_WRITE, FAILED };
+
+    /**
+     * Constructor
+     * @param socket Accepted socket, taken over by the stream
+     * @param ctx Context to create the SSL object from
+     */
+    KtlsStream(boost::asio::ip::tcp::socket socket, SSL_CTX* ctx);
+    ~KtlsStream();
+
+    KtlsStream(const KtlsStream&) = delete;
+    KtlsStream& operator=(const KtlsStream&) = delete;
+
+    /**
+     * Advance the server handshake as far as the socket allows
+     * @return DONE once finished, WANT_READ / WANT_WRITE to wait for the socket, FAILED on error
+     */
+    HandshakeStep handshake_step();
+
+    /**
+     * True if the kernel encrypts what is sent
+     */
+    bool ktls_send() const;
+
+    /**
+     * Read some decrypted data
+     */
+    template <typename MutableBufferSequence>
+    size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& error) {
+        for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers); ++it) {
+            boost::asio::mutable_buffer buffer(*it);
+            if (buffer.size() > 0) {
+                return read(buffer.data(), buffer.size(), error);
+            }
+        }
+        error = boost::system::error_code();
+        return 0;
+    }
+
+    /**
+     * Write some data, encrypted by the kernel when kTLS is active
+     */
+    template <typename ConstBufferSequence>
+    size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& error) {
+        for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers); ++it) {
+            boost::asio::const_buffer buffer(*it);
+            if (buffer.size() > 0) {
+                return write(buffer.data(), buffer.size(), error);
+            }
+        }
+        error = boost::system::error_code();
+        return 0;
+    }
+
+    /**
+     * Send part of a file, encrypted by the kernel
+     * Only available when ktls_send() is true.
+     * @return Bytes sent
+     */
+    size_t sendfile(int fd, long long offset, size_t size, boost::system::error_code& error);
+
+    /**
+     * Send the close_notify alert
+     */
+    void shutdown(boost::system::error_code& error);
+
+    boost::asio::ip::tcp::socket& lowest_layer();
+    SSL* native_handle();
+
+private:
+    boost::asio::ip::tcp::socket socket_;
+    SSL* ssl_;
+
+    size_t read(void* data, size_t size, boost::system::error_code& error);
+    size_t write(const void* data, size_t size, boost::system::error_code& error);
+
+    /**
+     * Translate the result of an SSL call into an error code
+     */
+    boost::system::error_code make_error(int result) const;
+};
@@ -1,53 +1,95 @@
 #include "ssl.h"
 #include "../util/logger.h"
 #include <boost/asio/ssl/context.hpp>
+#include <algorithm>
+#include <cctype>
 #include <fstream>
+#include <openssl/x509v3.h>
+#include <sys/stat.h>
+
+namespace {
+    std::string to_lower(std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        return value;
+    }
+
+    std::time_t file_mtime(const std::string& path) {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+    }
+
+    /**
+     * Read the host name from the server_name extension of a ClientHello
+     */
+    bool client_hello_server_name(SSL* ssl, std::string& name) {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        if (!SSL_client_hello_get0_ext(ssl, TLSEXT_TYPE_server_name, &data, &size) || size < 5) {
+            return false;
+        }
+
+        // ServerNameList length, then entries of type, length, name; only host_name (0) is defined
+        size_t list_size = (static_cast<size_t>(data[0]) << 8) | data[1];
+        if (list_size + 2 != size || data[2] != TLSEXT_NAMETYPE_host_name) {
+            return false;
+        }
+        size_t name_size = (static_cast<size_t>(data[3]) << 8) | data[4];
+        if (name_size == 0 || name_size + 5 > size) {
+            return false;
+        }
+        name.assign(reinterpret_cast<const char*>(data + 5), name_size);
+        return true;
+    }
+}
 
 SSLContextManager::SSLContextManager(Config& config)
-    : config_(config), enabled_(config.is_ssl_enabled()) {
-    
+    : config_(config), enabled_(config.is_ssl_enabled()), ktls_(false) {
+#ifndef OPENSSL_NO_KTLS
+    ktls_ = enabled_ && config.is_ssl_ktls_enabled();
+#else
+    if (enabled_ && config.is_ssl_ktls_enabled()) {
+        Logger::getInstance().warning("ssl_ktls is set but OpenSSL has no kTLS support, using user-space TLS", "SSL");
+    }
+#endif
+
     if (enabled_) {
         initialize_context();
     }
 }
 
-boost::asio::ssl::context& SSLContextManager::get_context() {
-    if (!ssl_context_) {
+std::shared_ptr<boost::asio::ssl::context> SSLContextManager::get_context() const {
+    auto certificates = std::atomic_load(&certificates_);
+    if (!certificates) {
         throw std::runtime_error("SSL context not initialized");
     }
-    
-    return *ssl_context_;
+
+    return certificates->default_context;
 }
 
 bool SSLContextManager::is_enabled() const {
     return enabled_;
 }
 
+bool SSLContextManager::is_ktls_enabled() const {
+    return ktls_;
+}
+
 void SSLContextManager::initialize_context() {
     try {
-        // Create SSL context
-        ssl_context_ = std::make_unique<boost::asio::ssl::context>(
-            boost::asio::ssl::context::sslv23_server
-        );
-        
-        // Set options
-        ssl_context_->set_options(
-            boost::asio::ssl::context::default_workarounds |
-            boost::asio::ssl::context::no_sslv2 |
-            boost::asio::ssl::context::no_sslv3 |
-            boost::asio::ssl::context::no_tlsv1 |
-            boost::asio::ssl::context::single_dh_use
-        );
-        
-        // Set certificate file
-        ssl_context_->use_certificate_chain_file(config_.get_ssl_cert_path());
-        
-        // Set private key file
-        ssl_context_->use_private_key_file(
-            config_.get_ssl_key_path(),
-            boost::asio::ssl::context::pem
-        );
-        
+        // Ticket keys outlive every generation of contexts, so reloads do not invalidate tickets
+        if (config_.is_ssl_session_tickets_enabled()) {
+            ticket_keys_ = std::make_unique<SessionTicketKeys>(
+                config_.get_ssl_session_ticket_key_file(),
+                std::chrono::seconds(std::max(60, config_.get_ssl_session_ticket_rotate_seconds()))
+            );
+            if (!ticket_keys_->load()) {
+                throw std::runtime_error("Cannot load session ticket keys");
+            }
+        }
+
+        std::atomic_store(&certificates_, load_certificates());
+        next_check_ = std::chrono::steady_clock::now() + std::chrono::seconds(config_.get_ssl_reload_check_seconds());
+
         Logger::getInstance().info("SSL context initialized successfully", "SSL");
     }
     catch (const std::exception& e) {
@@ -55,3 +97,165 @@ void SSLContextManager::initialize_context() {
         throw;  // Re-throw to prevent starting server with invalid SSL settings
     }
 }
+
+SSLContextManager::ContextPtr SSLContextManager::create_context(const std::string& cert_path,
+                                                                const std::string& key_path,
+                                                                std::vector<std::string>& names) {
+    // Create SSL context
+    auto context = std::make_shared<boost::asio::ssl::context>(
+        boost::asio::ssl::context::sslv23_server
+    );
+
+    // Set options
+    context->set_options(
+        boost::asio::ssl::context::default_workarounds |
+        boost::asio::ssl::context::no_sslv2 |
+        boost::asio::ssl::context::no_sslv3 |
+        boost::asio::ssl::context::no_tlsv1 |
+        boost::asio::ssl::context::single_dh_use
+    );
+
+    // Set certificate file
+    context->use_certificate_chain_file(cert_path);
+
+    // Set private key file
+    context->use_private_key_file(
+        key_path,
+        boost::asio::ssl::context::pem
+    );
+
+    configure_session_resumption(context->native_handle());
+#ifndef OPENSSL_NO_KTLS
+    // OpenSSL moves the session into the kernel when the cipher allows it and falls back otherwise
+    if (ktls_) {
+        SSL_CTX_set_options(context->native_handle(), SSL_OP_ENABLE_KTLS);
+    }
+#endif
+    SSL_CTX_set_client_hello_cb(context->native_handle(), client_hello_callback, this);
+
+    // DNS names of the certificate, used when no server names are configured
+    X509* certificate = SSL_CTX_get0_certificate(context->native_handle());
+    auto* alt_names = certificate ? static_cast<GENERAL_NAMES*>(
+        X509_get_ext_d2i(certificate, NID_subject_alt_name, nullptr, nullptr)) : nullptr;
+    for (int i = 0; alt_names && i < sk_GENERAL_NAME_num(alt_names); ++i) {
+        const GENERAL_NAME* name = sk_GENERAL_NAME_value(alt_names, i);
+        if (name->type == GEN_DNS) {
+            const ASN1_STRING* dns = name->d.dNSName;
+            names.emplace_back(reinterpret_cast<const char*>(ASN1_STRING_get0_data(dns)),
+                               static_cast<size_t>(ASN1_STRING_length(dns)));
+        }
+    }
+    GENERAL_NAMES_free(alt_names);
+
+    return context;
+}
+
+std::shared_ptr<const SSLContextManager::CertificateSet> SSLContextManager::load_certificates() {
+    auto certificates = std::make_shared<CertificateSet>();
+    std::vector<std::string> names;
+
+    certificates->default_context = create_context(config_.get_ssl_cert_path(), config_.get_ssl_key_path(), names);
+    certificates->files.emplace_back(config_.get_ssl_cert_path(), file_mtime(config_.get_ssl_cert_path()));
+    certificates->files.emplace_back(config_.get_ssl_key_path(), file_mtime(config_.get_ssl_key_path()));
+
+    for (const auto& certificate : config_.get_ssl_certificates()) {
+        names.clear();
+        ContextPtr context = create_context(certificate.cert_path, certificate.key_path, names);
+        if (!certificate.server_names.empty()) {
+            names = certificate.server_names;
+        }
+
+        // The first certificate listed for a name wins
+        for (const auto& name : names) {
+            certificates->by_name.emplace(to_lower(name), context);
+        }
+        certificates->files.emplace_back(certificate.cert_path, file_mtime(certificate.cert_path));
+        certificates->files.emplace_back(certificate.key_path, file_mtime(certificate.key_path));
+    }
+
+    Logger::getInstance().info("Loaded " + std::to_string(config_.get_ssl_certificates().size() + 1) +
+                               " certificates for " + std::to_string(certificates->by_name.size()) +
+                               " server names", "SSL");
+    return certificates;
+}
+
+void SSLContextManager::configure_session_resumption(SSL_CTX* ctx) {
+    // Sessions are shared by every connection thread through the context's cache
+    static const unsigned char session_id_context[] = "reverse-proxy";
+    SSL_CTX_set_session_id_context(ctx, session_id_context, sizeof(session_id_context) - 1);
+    SSL_CTX_set_timeout(ctx, config_.get_ssl_session_timeout_seconds());
+    if (config_.get_ssl_session_cache_size() > 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, config_.get_ssl_session_cache_size());
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    if (!ticket_keys_) {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+        return;
+    }
+    ticket_keys_->install(ctx);
+}
+
+bool SSLContextManager::reload() {
+    if (!enabled_) {
+        return false;
+    }
+
+    // Everything is built before the swap, handshakes never wait for a reload
+    try {
+        std::atomic_store(&certificates_, load_certificates());
+    }
+    catch (const std::exception& e) {
+        Logger::getInstance().error("Failed to reload certificates, keeping the current ones: " +
+                                    std::string(e.what()), "SSL");
+        return false;
+    }
+
+    Logger::getInstance().info("Certificates reloaded", "SSL");
+    return true;
+}
+
+bool SSLContextManager::reload_if_changed() {
+    auto now = std::chrono::steady_clock::now();
+    if (!enabled_ || now < next_check_) {
+        return false;
+    }
+    next_check_ = now + std::chrono::seconds(config_.get_ssl_reload_check_seconds());
+
+    auto certificates = std::atomic_load(&certificates_);
+    for (const auto& file : certificates->files) {
+        if (file_mtime(file.first) != file.second) {
+            Logger::getInstance().info("Certificate file " + file.first + " changed", "SSL");
+            return reload();
+        }
+    }
+    return false;
+}
+
+int SSLContextManager::client_hello_callback(SSL* ssl, int* alert, void* arg) {
+    (void)alert;
+    auto* self = static_cast<SSLContextManager*>(arg);
+
+    std::string name;
+    if (!client_hello_server_name(ssl, name)) {
+        return SSL_CLIENT_HELLO_SUCCESS;  // No SNI, keep the default certificate
+    }
+    name = to_lower(name);
+
+    auto certificates = std::atomic_load(&self->certificates_);
+    auto it = certificates->by_name.find(name);
+    if (it == certificates->by_name.end()) {
+        // A wildcard covers exactly one label
+        size_t dot = name.find('.');
+        if (dot != std::string::npos) {
+            it = certificates->by_name.find("*" + name.substr(dot));
+        }
+    }
+
+    if (it != certificates->by_name.end() && it->second->native_handle() != SSL_get_SSL_CTX(ssl)) {
+        SSL_set_SSL_CTX(ssl, it->second->native_handle());
+    }
+    return SSL_CLIENT_HELLO_SUCCESS;
+}
@@ -2,12 +2,27 @@
 
 #include <string>
 #include <memory>
+#include <chrono>
+#include <ctime>
+#include <unordered_map>
+#include <vector>
 #include <boost/asio/ssl.hpp>
 #include "../config/config.h"
+#include "ticketKeys.h"
 
 /**
  * SSL Context Manager
- * Creates and configures an SSL context for the server
+ * Creates and configures the SSL contexts for the server.
+ *
+ * The default certificate (ssl_cert_path) and every entry of
+ * ssl_certificates get their own context, built when certificates are
+ * loaded. During the handshake a ClientHello callback reads the SNI name
+ * and moves the connection to the matching context, so choosing a
+ * certificate is a hash lookup and never builds anything.
+ *
+ * Reloading builds a complete new set of contexts and swaps it in
+ * atomically. Connections already established keep the context they
+ * were created with, since OpenSSL reference-counts it.
  */
 class SSLContextManager {
 public:
@@ -16,26 +31,83 @@ public:
      * @param config Application configuration
      */
     explicit SSLContextManager(Config& config);
-    
+
     /**
-     * Get the SSL context
-     * @return SSL context
+     * Get the context new connections start with
+     * @return SSL context, held until the caller releases it even across reloads
      */
-    boost::asio::ssl::context& get_context();
-    
+    std::shared_ptr<boost::asio::ssl::context> get_context() const;
+
     /**
      * Check if SSL is enabled
      * @return True if SSL is enabled
      */
     bool is_enabled() const;
 
+    /**
+     * Check if connections should be handed to kernel TLS after the handshake
+     * @return True if kTLS is configured and OpenSSL was built with it
+     */
+    bool is_ktls_enabled() const;
+
+    /**
+     * Load every certificate again and swap them in
+     * The current certificates stay in use if any certificate fails to load.
+     * @return True if the new certificates are in use
+     */
+    bool reload();
+
+    /**
+     * Reload if a certificate or key file changed
+     * Files are checked at most every ssl_reload_check_seconds.
+     * @return True if certificates were reloaded
+     */
+    bool reload_if_changed();
+
 private:
+    using ContextPtr = std::shared_ptr<boost::asio::ssl::context>;
+
+    /**
+     * One loaded generation of certificates
+     */
+    struct CertificateSet {
+        ContextPtr default_context;
+        std::unordered_map<std::string, ContextPtr> by_name;      // lowercase names, "*.example.com" for wildcards
+        std::vector<std::pair<std::string, std::time_t>> files;   // certificate and key files with their mtimes
+    };
+
     Config& config_;
-    std::unique_ptr<boost::asio::ssl::context> ssl_context_;
+    std::shared_ptr<const CertificateSet> certificates_;  // read and swapped with std::atomic_load/store
+    std::unique_ptr<SessionTicketKeys> ticket_keys_;       // nullptr with tickets disabled
     bool enabled_;
-    
+    bool ktls_;
+    std::chrono::steady_clock::time_point next_check_;
+
     /**
-     * Initialize the SSL context with certificates and settings
+     * Initialize the SSL contexts with certificates and settings
      */
     void initialize_context();
+
+    /**
+     * Build a context for a certificate and key
+     * @param names Output DNS names from the certificate
+     */
+    ContextPtr create_context(const std::string& cert_path, const std::string& key_path,
+                              std::vector<std::string>& names);
+
+    /**
+     * Build contexts for every configured certificate
+     * @throws std::exception if a certificate or key cannot be loaded
+     */
+    std::shared_ptr<const CertificateSet> load_certificates();
+
+    /**
+     * Enable session resumption through the session cache and session tickets
+     */
+    void configure_session_resumption(SSL_CTX* ctx);
+
+    /**
+     * Select the context for the SNI name in a ClientHello
+     */
+    static int client_hello_callback(SSL* ssl, int* alert, void* arg);
 };
@@ -0,0 +1,181 @@
+#include "ticketKeys.h"
+#include "../util/Logger.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
+#include <sys/stat.h>
+
+namespace {
+    /**
+     * Index of the SSL_CTX ex_data slot holding the keys (app data is taken by Boost.Asio)
+     */
+    int keys_index() {
+        static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+}
+
+SessionTicketKeys::SessionTicketKeys(const std::string& key_file, std::chrono::seconds rotate_interval)
+    : key_file_(key_file), rotate_interval_(rotate_interval),
+      keys_(std::make_shared<const KeyList>()) {
+}
+
+bool SessionTicketKeys::load() {
+    auto keys = std::make_shared<KeyList>();
+    std::time_t mtime = 0;
+
+    if (!key_file_.empty()) {
+        if (!read_key_file(*keys, mtime)) {
+            Logger::getInstance().error("Cannot read session ticket keys from " + key_file_, "SSL");
+            return false;
+        }
+    } else {
+        Key key;
+        if (RAND_bytes(reinterpret_cast<unsigned char*>(&key), sizeof(key)) != 1) {
+            return false;
+        }
+        keys->push_back(key);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    keys_ = keys;
+    file_mtime_ = mtime;
+    next_rotation_ = std::chrono::steady_clock::now() + rotate_interval_;
+    Logger::getInstance().info("Loaded " + std::to_string(keys->size()) + " session ticket keys", "SSL");
+    return true;
+}
+
+bool SessionTicketKeys::read_key_file(KeyList& keys, std::time_t& mtime) const {
+    struct stat info;
+    if (stat(key_file_.c_str(), &info) != 0) {
+        return false;
+    }
+    mtime = info.st_mtime;
+
+    std::ifstream file(key_file_, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file.good() && !file.eof()) {
+        return false;
+    }
+    if (data.empty() || data.size() % KEY_SIZE != 0) {
+        return false;
+    }
+
+    static_assert(sizeof(Key) == KEY_SIZE, "Key must match the file layout");
+    keys.resize(data.size() / KEY_SIZE);
+    std::memcpy(keys.data(), data.data(), data.size());
+    return true;
+}
+
+void SessionTicketKeys::maybe_rotate() {
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (now < next_rotation_) {
+            return;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (now < next_rotation_) {
+        return;  // Another handshake rotated first
+    }
+    next_rotation_ = now + rotate_interval_;
+
+    auto keys = std::make_shared<KeyList>();
+    if (!key_file_.empty()) {
+        // The fleet rotates by rewriting the file, keep the old keys if it is unreadable
+        struct stat info;
+        if (stat(key_file_.c_str(), &info) != 0 || info.st_mtime == file_mtime_) {
+            return;
+        }
+        std::time_t mtime = 0;
+        if (!read_key_file(*keys, mtime)) {
+            Logger::getInstance().warning("Cannot reload session ticket keys from " + key_file_, "SSL");
+            return;
+        }
+        file_mtime_ = mtime;
+    } else {
+        Key key;
+        if (RAND_bytes(reinterpret_cast<unsigned char*>(&key), sizeof(key)) != 1) {
+            return;
+        }
+        keys->push_back(key);
+        for (const auto& old_key : *keys_) {
+            if (keys->size() >= KEPT_KEYS) {
+                break;
+            }
+            keys->push_back(old_key);
+        }
+    }
+
+    keys_ = keys;
+    Logger::getInstance().info("Rotated session ticket keys", "SSL");
+}
+
+std::shared_ptr<const SessionTicketKeys::KeyList> SessionTicketKeys::current() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return keys_;
+}
+
+size_t SessionTicketKeys::size() const {
+    return current()->size();
+}
+
+void SessionTicketKeys::install(SSL_CTX* ctx) {
+    SSL_CTX_set_ex_data(ctx, keys_index(), this);
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_callback);
+}
+
+int SessionTicketKeys::ticket_callback(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                                       EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int encrypt) {
+    auto* self = static_cast<SessionTicketKeys*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), keys_index()));
+    if (!self) {
+        return -1;
+    }
+
+    const Key* key = nullptr;
+    int result = 1;
+    std::shared_ptr<const KeyList> keys;
+
+    if (encrypt) {
+        self->maybe_rotate();
+        keys = self->current();
+        if (keys->empty() || RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+            return -1;
+        }
+        key = &keys->front();
+        std::memcpy(key_name, key->name.data(), key->name.size());
+        if (EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key->aes_key.data(), iv) != 1) {
+            return -1;
+        }
+    } else {
+        keys = self->current();
+        for (size_t i = 0; i < keys->size(); ++i) {
+            if (std::memcmp(key_name, (*keys)[i].name.data(), (*keys)[i].name.size()) == 0) {
+                key = &(*keys)[i];
+                result = i == 0 ? 1 : 2;  // 2 asks OpenSSL to issue a ticket under the current key
+                break;
+            }
+        }
+        if (!key) {
+            return 0;  // Unknown key, fall back to a full handshake
+        }
+        if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key->aes_key.data(), iv) != 1) {
+            return -1;
+        }
+    }
+
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+        OSSL_PARAM_construct_end()
+    };
+    if (EVP_MAC_CTX_set_params(mac, params) != 1 ||
+        EVP_MAC_init(mac, key->hmac_key.data(), key->hmac_key.size(), nullptr) != 1) {
+        return -1;
+    }
+    return result;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+
+/**
+ * Session Ticket Keys class
+ * Encrypts and decrypts stateless TLS session tickets (RFC 5077, and the
+ * tickets TLS 1.3 uses for resumption) with keys the proxy controls.
+ *
+ * Keys are either generated in memory or read from a file. A key file
+ * holds one or more 80-byte keys, laid out like nginx's
+ * ssl_session_ticket_key: a 16-byte name, a 32-byte HMAC-SHA256 key and a
+ * 32-byte AES-256 key. The first key encrypts new tickets and all keys
+ * decrypt, so writing the same file to every node lets any node resume
+ * any other node's sessions.
+ *
+ * Keys rotate lazily on the schedule: generated keys are replaced by a
+ * new key and a key file is read again if it changed. Tickets under a
+ * retired key that is still kept are accepted and then renewed.
+ */
+class SessionTicketKeys {
+public:
+    static constexpr size_t KEY_SIZE = 80;
+    static constexpr size_t KEPT_KEYS = 3;  // current key and the ones it replaced
+
+    /**
+     * Constructor
+     * @param key_file File holding the keys, or empty to generate them
+     * @param rotate_interval How often keys are rotated or the file is checked
+     */
+    SessionTicketKeys(const std::string& key_file, std::chrono::seconds rotate_interval);
+
+    /**
+     * Load the initial keys
+     * @return False if the key file cannot be read or holds no keys
+     */
+    bool load();
+
+    /**
+     * Have an SSL context encrypt its session tickets with these keys
+     * The keys must outlive the context.
+     * @param ctx The context
+     */
+    void install(SSL_CTX* ctx);
+
+    /**
+     * Number of keys that can decrypt tickets
+     */
+    size_t size() const;
+
+private:
+    struct Key {
+        std::array<unsigned char, 16> name;
+        std::array<unsigned char, 32> hmac_key;
+        std::array<unsigned char, 32> aes_key;
+    };
+    using KeyList = std::vector<Key>;
+
+    std::string key_file_;
+    std::chrono::seconds rotate_interval_;
+
+    mutable std::shared_mutex mutex_;
+    std::shared_ptr<const KeyList> keys_;  // keys_->front() encrypts
+    std::chrono::steady_clock::time_point next_rotation_;
+    std::time_t file_mtime_ = 0;
+
+    /**
+     * Read the key file
+     * @param keys Output keys, in file order
+     * @return False if the file cannot be read or its size is not a multiple of KEY_SIZE
+     */
+    bool read_key_file(KeyList& keys, std::time_t& mtime) const;
+
+    /**
+     * Rotate the keys if the rotation interval has passed
+     */
+    void maybe_rotate();
+
+    /**
+     * Get the current keys
+     */
+    std::shared_ptr<const KeyList> current() const;
+
+    /**
+     * OpenSSL ticket key callback, see SSL_CTX_set_tlsext_ticket_key_evp_cb
+     */
+    static int ticket_callback(SSL* ssl, unsigned char* key_name, unsigned char* iv,
+                               EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int encrypt);
+};
@@ -0,0 +1,76 @@
+#include "tokenCache.h"
+#include <algorithm>
+#include <cstring>
+#include <openssl/sha.h>
+
+TokenCache::TokenCache(size_t capacity, size_t shards)
+    : shard_capacity_(std::max<size_t>(1, capacity / std::max<size_t>(1, shards))) {
+    shards = std::max<size_t>(1, shards);
+    shards_.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+size_t TokenCache::DigestHash::operator()(const Digest& digest) const {
+    // The digest is already uniformly distributed
+    size_t value;
+    std::memcpy(&value, digest.data() + 8, sizeof(value));
+    return value;
+}
+
+TokenCache::Shard& TokenCache::shard_for(const std::string& token, Digest& digest) {
+    SHA256(reinterpret_cast<const unsigned char*>(token.data()), token.size(), digest.data());
+    return *shards_[digest[0] % shards_.size()];
+}
+
+bool TokenCache::lookup(const std::string& token, long long now, VerifiedToken& verified) {
+    Digest digest;
+    Shard& shard = shard_for(token, digest);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.tokens.find(digest);
+    if (it == shard.tokens.end()) {
+        return false;
+    }
+    if (now > it->second.expires_at) {
+        shard.tokens.erase(it);  // Its slot in the order queue goes when it reaches the front
+        return false;
+    }
+    verified = it->second;
+    return true;
+}
+
+void TokenCache::insert(const std::string& token, const VerifiedToken& verified) {
+    Digest digest;
+    Shard& shard = shard_for(token, digest);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.tokens.emplace(digest, verified).second) {
+        return;  // Verified concurrently by another request
+    }
+    shard.order.push_back(digest);
+    
+    // The queue may hold digests already erased on expiry, so it is trimmed against its own size too
+    while (shard.tokens.size() > shard_capacity_ || shard.order.size() > 2 * shard_capacity_) {
+        shard.tokens.erase(shard.order.front());
+        shard.order.pop_front();
+    }
+}
+
+void TokenCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->tokens.clear();
+        shard->order.clear();
+    }
+}
+
+size_t TokenCache::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->tokens.size();
+    }
+    return total;
+}
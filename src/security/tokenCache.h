@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "claimScanner.h"
+
+/**
+ * A token whose signature and claims have been checked
+ */
+struct VerifiedToken {
+    long long expires_at = 0;                  // exp claim, the token is valid up to and including this second
+    std::shared_ptr<const JwtClaims> claims;   // claims the proxy uses, see Authentication
+};
+
+/**
+ * Token Cache class
+ * Remembers verified JWTs so a token presented again is accepted with a
+ * hash lookup instead of another HMAC and JSON parse. Tokens are keyed by
+ * their SHA-256, so the cache never holds a usable credential, and the
+ * key space is split into shards with their own lock to keep request
+ * threads from contending. Each shard holds a bounded number of tokens and
+ * drops the oldest when full; entries stop matching at their exp.
+ */
+class TokenCache {
+public:
+    /**
+     * Constructor
+     * @param capacity Total number of tokens kept
+     * @param shards Number of independently locked shards
+     */
+    explicit TokenCache(size_t capacity, size_t shards = 16);
+    
+    /**
+     * Look up a verified token
+     * @param token The raw token
+     * @param now Current Unix time
+     * @param verified Output verification result
+     * @return False if the token is unknown or has expired
+     */
+    bool lookup(const std::string& token, long long now, VerifiedToken& verified);
+    
+    /**
+     * Remember a verified token
+     * @param token The raw token
+     * @param verified Its verification result
+     */
+    void insert(const std::string& token, const VerifiedToken& verified);
+    
+    /**
+     * Forget every token, e.g. after the verification keys changed
+     */
+    void clear();
+    
+    /**
+     * Number of cached tokens
+     */
+    size_t size() const;
+
+private:
+    using Digest = std::array<unsigned char, 32>;
+    
+    struct DigestHash {
+        size_t operator()(const Digest& digest) const;
+    };
+    
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<Digest, VerifiedToken, DigestHash> tokens;
+        std::deque<Digest> order;  // insertion order, oldest first
+    };
+    
+    size_t shard_capacity_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    
+    /**
+     * Hash a token and find its shard
+     */
+    Shard& shard_for(const std::string& token, Digest& digest);
+};
@@ -0,0 +1,42 @@
+#include "CpuLoad.h"
+#include <algorithm>
+#include <thread>
+#include <time.h>
+
+CpuLoad::CpuLoad(std::chrono::milliseconds interval)
+    : interval_(interval), cores_(std::max(1u, std::thread::hardware_concurrency())),
+      last_wall_(std::chrono::steady_clock::now()), last_cpu_seconds_(process_cpu_seconds()) {
+}
+
+double CpuLoad::current() {
+    auto now = std::chrono::steady_clock::now();
+    if (now.time_since_epoch().count() < next_sample_.load(std::memory_order_relaxed)) {
+        return load_.load(std::memory_order_relaxed);
+    }
+    
+    // One caller takes the sample, the others keep using the last value
+    std::unique_lock<std::mutex> lock(sample_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return load_.load(std::memory_order_relaxed);
+    }
+    
+    double cpu_seconds = process_cpu_seconds();
+    double wall_seconds = std::chrono::duration<double>(now - last_wall_).count();
+    if (wall_seconds > 0) {
+        double load = (cpu_seconds - last_cpu_seconds_) / (wall_seconds * cores_);
+        load_.store(std::min(1.0, std::max(0.0, load)), std::memory_order_relaxed);
+    }
+    
+    last_wall_ = now;
+    last_cpu_seconds_ = cpu_seconds;
+    next_sample_.store((now + interval_).time_since_epoch().count(), std::memory_order_relaxed);
+    return load_.load(std::memory_order_relaxed);
+}
+
+double CpuLoad::process_cpu_seconds() {
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) {
+        return 0.0;
+    }
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/**
+ * CPU Load class
+ * Tracks how busy the process keeps the machine's cores, from the process
+ * CPU time consumed between samples. Sampling is rate limited, so reading
+ * the load on every request is cheap.
+ */
+class CpuLoad {
+public:
+    /**
+     * Constructor
+     * @param interval Minimum time between two samples
+     */
+    explicit CpuLoad(std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+    
+    /**
+     * Get the current load
+     * @return Share of all cores used by the process, 1.0 meaning every core is busy
+     */
+    double current();
+
+private:
+    std::chrono::steady_clock::duration interval_;
+    unsigned int cores_;
+    
+    std::atomic<double> load_{0.0};
+    std::atomic<long long> next_sample_{0};  // steady clock ticks
+    std::mutex sample_mutex_;
+    std::chrono::steady_clock::time_point last_wall_;
+    double last_cpu_seconds_;
+    
+    /**
+     * CPU time used by the process so far, in seconds
+     */
+    static double process_cpu_seconds();
+};
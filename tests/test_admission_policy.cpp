@@ -0,0 +1,65 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/admissionPolicy.h"
+
+TEST_CASE("TinyLFU admission") {
+    SUBCASE("Keys are admitted once requested often enough") {
+        AdmissionPolicy policy(1024, 2, 1024 * 1024);
+        CHECK(policy.frequency("a") == 0);
+        CHECK(policy.admit("a", 100) == false);
+
+        policy.record("a");
+        CHECK(policy.frequency("a") == 1);
+        CHECK(policy.admit("a", 100) == false);
+
+        policy.record("a");
+        CHECK(policy.frequency("a") == 2);
+        CHECK(policy.admit("a", 100) == true);
+        CHECK(policy.admit("b", 100) == false);
+    }
+
+    SUBCASE("Counters saturate at 15") {
+        AdmissionPolicy policy(1024, 1, 1024 * 1024);
+        for (int i = 0; i < 40; ++i) {
+            policy.record("hot");
+        }
+        CHECK(policy.frequency("hot") == 15);
+    }
+
+    SUBCASE("Minimum frequency is clamped to the counter range") {
+        AdmissionPolicy policy(1024, 100, 1024 * 1024);
+        for (int i = 0; i < 15; ++i) {
+            policy.record("a");
+        }
+        CHECK(policy.admit("a", 10) == true);
+    }
+
+    SUBCASE("Larger objects need more requests and oversized ones are never admitted") {
+        AdmissionPolicy policy(1024, 1, 1024 * 1024, 64 * 1024);
+        policy.record("big");
+        CHECK(policy.admit("big", 64 * 1024) == true);
+        CHECK(policy.admit("big", 64 * 1024 + 1) == false);
+        policy.record("big");
+        CHECK(policy.admit("big", 128 * 1024) == true);
+        CHECK(policy.admit("big", 200 * 1024) == false);
+
+        for (int i = 0; i < 15; ++i) {
+            policy.record("huge");
+        }
+        CHECK(policy.admit("huge", 1024 * 1024 + 1) == false);
+    }
+
+    SUBCASE("Aging halves old popularity") {
+        // 16 counters per row, aged after 160 accesses
+        AdmissionPolicy policy(16, 1, 1024 * 1024);
+        for (int i = 0; i < 8; ++i) {
+            policy.record("old");
+        }
+        CHECK(policy.frequency("old") == 8);
+
+        for (int i = 0; i < 152; ++i) {
+            policy.record("filler" + std::to_string(i % 4));
+        }
+        CHECK(policy.frequency("old") <= 4);
+    }
+}
@@ -0,0 +1,81 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/banList.h"
+#include "../src/cache/cacheEntry.h"
+
+static Ban make_ban(const std::string& pattern, bool prefix, long long created_at, long long lifetime = 3600) {
+    Ban ban;
+    ban.pattern = pattern;
+    ban.prefix = prefix;
+    ban.created_at = created_at;
+    ban.expires_at = created_at + lifetime;
+    return ban;
+}
+
+TEST_CASE("Cache bans") {
+    long long now = CacheEntry::now();
+
+    SUBCASE("Exact bans only match their URI and older entries") {
+        BanList bans;
+        bans.add(make_ban("/api/items?page=1", false, now));
+        CHECK(bans.is_banned("/api/items?page=1", now - 10) == true);
+        CHECK(bans.is_banned("/api/items?page=1", now) == true);
+        CHECK(bans.is_banned("/api/items?page=1", now + 1) == false);
+        CHECK(bans.is_banned("/api/items?page=10", now - 10) == false);
+    }
+
+    SUBCASE("Prefix bans of different lengths") {
+        BanList bans;
+        bans.add(make_ban("/static/css/", true, now));
+        bans.add(make_ban("/img", true, now - 100));
+        CHECK(bans.is_banned("/static/css/site.css", now - 1) == true);
+        CHECK(bans.is_banned("/static/js/app.js", now - 1) == false);
+        CHECK(bans.is_banned("/img/logo.png", now - 200) == true);
+        CHECK(bans.is_banned("/img/logo.png", now - 50) == false);
+        CHECK(bans.is_banned("/im", now - 200) == false);
+    }
+
+    SUBCASE("The newest ban of a pattern wins") {
+        BanList bans;
+        bans.add(make_ban("/a", false, now));
+        bans.add(make_ban("/a", false, now - 100));
+        CHECK(bans.size() == 1);
+        CHECK(bans.is_banned("/a", now - 50) == true);
+    }
+
+    SUBCASE("Expired bans are dropped when a ban is added") {
+        BanList bans;
+        bans.add(make_ban("/old/", true, now - 100, 50));
+        CHECK(bans.size() == 1);
+        bans.add(make_ban("/old", false, now - 100, 50));
+        CHECK(bans.size() == 1);
+        CHECK(bans.is_banned("/old/x", now - 200) == false);
+        bans.add(make_ban("/new", false, now));
+        CHECK(bans.size() == 1);
+        CHECK(bans.is_banned("/old", now - 200) == false);
+        CHECK(bans.is_banned("/new", now - 200) == true);
+    }
+
+    SUBCASE("Thousands of bans") {
+        BanList bans;
+        for (int i = 0; i < 5000; ++i) {
+            bans.add(make_ban("/items/" + std::to_string(i), false, now));
+            bans.add(make_ban("/users/" + std::to_string(i) + "/", true, now));
+        }
+        CHECK(bans.size() == 10000);
+        CHECK(bans.is_banned("/items/4999", now - 1) == true);
+        CHECK(bans.is_banned("/users/17/avatar", now - 1) == true);
+        CHECK(bans.is_banned("/users/x/avatar", now - 1) == false);
+    }
+
+    SUBCASE("Encoding round trip") {
+        Ban ban = make_ban("/static/a b", true, 1700000000);
+        Ban decoded;
+        REQUIRE(Ban::decode(ban.encode(), decoded) == true);
+        CHECK(decoded.prefix == true);
+        CHECK(decoded.pattern == "/static/a b");
+        CHECK(decoded.created_at == 1700000000);
+        CHECK(decoded.expires_at == 1700003600);
+        CHECK(Ban::decode("garbage", decoded) == false);
+    }
+}
@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/cacheEntry.h"
+
+static CacheEntry make_entry(const std::string& body) {
+    CacheEntry entry;
+    entry.response = std::make_shared<HttpResponse>(HttpStatus::OK);
+    entry.response->set_body(body, "application/json");
+    entry.response->set_header("ETag", "\"v1\"");
+    entry.stored_at = 1700000000;
+    entry.fresh_seconds = 300;
+    entry.stale_while_revalidate_seconds = 30;
+    entry.stale_if_error_seconds = 600;
+    entry.uri = "/api/items?page=2";
+    return entry;
+}
+
+TEST_CASE("Cache entry binary format") {
+    SUBCASE("Round trip keeps status, headers, body and metadata") {
+        std::string body("{\"a\":1}\r\n\r\n\0binary", 19);
+        CacheEntry entry = make_entry(body);
+
+        CacheEntry restored;
+        REQUIRE(CacheEntry::deserialize(entry.serialize(), restored) == true);
+        CHECK(restored.response->status() == HttpStatus::OK);
+        CHECK(restored.response->body() == body);
+        CHECK(restored.response->get_header("ETag") == "\"v1\"");
+        CHECK(restored.response->get_header("Content-Type") == "application/json");
+        CHECK(restored.response->get_header("Content-Length") == std::to_string(body.size()));
+        CHECK(restored.stored_at == 1700000000);
+        CHECK(restored.fresh_seconds == 300);
+        CHECK(restored.stale_while_revalidate_seconds == 30);
+        CHECK(restored.stale_if_error_seconds == 600);
+        CHECK(restored.uri == "/api/items?page=2");
+    }
+
+    SUBCASE("Decoded view points into the serialized buffer") {
+        std::string serialized = make_entry(std::string(4096, 'x')).serialize();
+
+        CacheEntryView view;
+        REQUIRE(CacheEntry::decode(serialized, view) == true);
+        CHECK(view.status == 200);
+        CHECK(view.body.size() == 4096);
+        CHECK(view.body.data() == serialized.data());
+    }
+
+    SUBCASE("Head can be decoded from the tail alone") {
+        std::string serialized = make_entry(std::string(4096, 'x')).serialize();
+        CacheEntryView view;
+        uint64_t body_length = 0;
+        uint64_t head_length = 0;
+
+        CHECK(CacheEntry::decode_head(serialized.substr(serialized.size() - 30), view, body_length, head_length) == false);
+        CHECK(body_length == 4096);
+        REQUIRE(head_length > 0);
+
+        std::string tail = serialized.substr(serialized.size() - head_length - CacheEntry::TRAILER_SIZE);
+        REQUIRE(CacheEntry::decode_head(tail, view, body_length, head_length) == true);
+        CHECK(view.status == 200);
+        CHECK(view.fresh_seconds == 300);
+        CHECK(view.uri == "/api/items?page=2");
+        CHECK(view.body.empty());
+    }
+
+    SUBCASE("Malformed data is rejected") {
+        std::string serialized = make_entry("hello").serialize();
+        CacheEntryView view;
+
+        CHECK(CacheEntry::decode("", view) == false);
+        CHECK(CacheEntry::decode("HTTP/1.1 200 OK\r\n\r\nhello", view) == false);
+        CHECK(CacheEntry::decode(serialized.substr(1), view) == false);
+
+        std::string corrupted = serialized;
+        corrupted[corrupted.size() - 1] = 'X';
+        CHECK(CacheEntry::decode(corrupted, view) == false);
+    }
+
+    SUBCASE("Freshness windows") {
+        CacheEntry entry = make_entry("hello");
+        CHECK(entry.is_fresh(entry.stored_at + 299) == true);
+        CHECK(entry.is_fresh(entry.stored_at + 300) == false);
+        CHECK(entry.is_stale_while_revalidate(entry.stored_at + 329) == true);
+        CHECK(entry.is_stale_while_revalidate(entry.stored_at + 330) == false);
+        CHECK(entry.is_stale_if_error(entry.stored_at + 899) == true);
+        CHECK(entry.grace_seconds() == 600);
+    }
+}
+
+TEST_CASE("Compressed variants keep the backend's Vary") {
+    HttpResponse response(HttpStatus::OK);
+    response.set_header("vary", "Accept-Language");
+    response.add_vary("Accept-Encoding");
+    CHECK(response.get_header("Vary") == "Accept-Language, Accept-Encoding");
+    CHECK(response.headers().count("vary") == 0);
+
+    response.add_vary("accept-encoding");
+    CHECK(response.get_header("Vary") == "Accept-Language, Accept-Encoding");
+
+    HttpResponse streamed(HttpStatus::OK);
+    streamed.set_stream_encoding("gzip", 6);
+    CHECK(streamed.get_header("Vary") == "Accept-Encoding");
+
+    HttpResponse everything(HttpStatus::OK);
+    everything.set_header("Vary", "*");
+    everything.add_vary("Accept-Encoding");
+    CHECK(everything.get_header("Vary") == "*");
+}
@@ -0,0 +1,102 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/cacheKey.h"
+
+static HttpRequest make_request(const std::string& uri) {
+    return HttpRequest("GET", uri, "HTTP/1.1");
+}
+
+TEST_CASE("Cache key normalization") {
+    SUBCASE("Query parameters are sorted by name, keeping repeated ones in order") {
+        RouteConfig route("/api");
+        CHECK(CacheKey::normalize_query("b=2&a=1&b=1", route) == "a=1&b=2&b=1");
+        CHECK(CacheKey::normalize_query("&&a&b=", route) == "a&b=");
+        CHECK(CacheKey::normalize_query("", route) == "");
+
+        route.cache_key_sort_query = false;
+        CHECK(CacheKey::normalize_query("b=2&a=1", route) == "b=2&a=1");
+    }
+
+    SUBCASE("Allow and deny lists with prefix patterns") {
+        RouteConfig route("/api");
+        route.cache_key_query_denylist = {"utm_*", "fbclid"};
+        CHECK(CacheKey::normalize_query("id=7&utm_source=x&fbclid=y&utm=z", route) == "id=7&utm=z");
+
+        route.cache_key_query_allowlist = {"id", "page"};
+        CHECK(CacheKey::normalize_query("page=2&id=7&utm=z&sort=asc", route) == "id=7&page=2");
+    }
+
+    SUBCASE("Primary key holds method, path, query and selected headers") {
+        RouteConfig route("/api");
+        route.cache_key_query_denylist = {"utm_*"};
+        route.cache_key_headers = {"Accept-Language"};
+
+        HttpRequest first = make_request("/api/items?b=2&a=1&utm_source=mail");
+        first.set_header("Accept-Language", "de");
+        HttpRequest second = make_request("/api/items?a=1&b=2");
+        second.set_header("Accept-Language", "de");
+        HttpRequest other_language = make_request("/api/items?a=1&b=2");
+        other_language.set_header("Accept-Language", "fr");
+
+        CHECK(CacheKey::primary(first, route) == "GET /api/items?a=1&b=2\nAccept-Language: de");
+        CHECK(CacheKey::primary(first, route) == CacheKey::primary(second, route));
+        CHECK(CacheKey::primary(first, route) != CacheKey::primary(other_language, route));
+        CHECK(CacheKey::primary(make_request("/api/items"), RouteConfig("/api")) == "GET /api/items");
+    }
+
+    SUBCASE("Claim-restricted routes do not share keys with the route they shadow") {
+        RouteConfig generic("/api");
+        RouteConfig tenant("/api");
+        tenant.match_claims = {{"tenant", "acme"}};
+        tenant.route_id = "/api\ntenant=acme";
+
+        HttpRequest request = make_request("/api/items");
+        CHECK(CacheKey::primary(request, generic) == "GET /api/items");
+        CHECK(CacheKey::primary(request, tenant) == "GET /api/items\n@/api\ntenant=acme");
+    }
+
+    SUBCASE("Hashed keys are fixed width") {
+        std::string key = CacheKey::hash("GET /api/items");
+        CHECK(key.size() == 6 + 32);
+        CHECK(key.compare(0, 6, "cache:") == 0);
+        CHECK(key == CacheKey::hash("GET /api/items"));
+        CHECK(key != CacheKey::hash("GET /api/item"));
+    }
+}
+
+TEST_CASE("Vary parsing") {
+    std::vector<std::string> names;
+
+    SUBCASE("Names are lowercased, sorted and deduplicated") {
+        REQUIRE(CacheKey::parse_vary(" Accept-Language ,X-Tenant, accept-language", names) == true);
+        CHECK(names == std::vector<std::string>{"accept-language", "x-tenant"});
+    }
+
+    SUBCASE("Accept-Encoding and empty entries are left out") {
+        REQUIRE(CacheKey::parse_vary("Accept-Encoding,, ", names) == true);
+        CHECK(names.empty());
+        REQUIRE(CacheKey::parse_vary("", names) == true);
+        CHECK(names.empty());
+    }
+
+    SUBCASE("A wildcard is never reusable") {
+        CHECK(CacheKey::parse_vary("Accept-Language, *", names) == false);
+    }
+}
+
+TEST_CASE("Vary index") {
+    VaryIndex index(2);
+    index.update("a", {"accept-language"});
+    CHECK(index.lookup("a") == std::vector<std::string>{"accept-language"});
+    CHECK(index.lookup("b").empty());
+
+    index.update("a", {});
+    CHECK(index.lookup("a").empty());
+
+    // A full index starts over rather than tracking recency
+    index.update("a", {"x"});
+    index.update("b", {"y"});
+    index.update("c", {"z"});
+    CHECK(index.lookup("a").empty());
+    CHECK(index.lookup("c") == std::vector<std::string>{"z"});
+}
@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/claimScanner.h"
+
+static const std::vector<std::string> names = {"exp", "nbf", "sub", "aud", "role"};
+
+TEST_CASE("Claim scanner") {
+    SUBCASE("Numbers, booleans and nulls around the requested claims are skipped") {
+        JwtClaims claims;
+        NumericDates dates;
+        REQUIRE(ClaimScanner::scan("{\"exp\":1900000000,\"iat\":1700000000,\"sub\":\"u\"}", names, claims, &dates) == true);
+        CHECK(claims["sub"] == "u");
+        CHECK(dates["exp"] == 1900000000);
+        CHECK(dates.count("iat") == 0);
+
+        claims.clear();
+        REQUIRE(ClaimScanner::scan("{\"admin\":true,\"exp\":1900000000}", names, claims) == true);
+        CHECK(claims["exp"] == "1900000000");
+        CHECK(claims.count("admin") == 0);
+
+        claims.clear();
+        REQUIRE(ClaimScanner::scan("{ \"x\" : null , \"y\" : -1.5e3 , \"z\" : false , \"sub\" : \"a\" }",
+                                   names, claims) == true);
+        CHECK(claims["sub"] == "a");
+    }
+
+    SUBCASE("Nested values are skipped as a whole") {
+        JwtClaims claims;
+        REQUIRE(ClaimScanner::scan("{\"ctx\":{\"a\":[1,{\"b\":\"}]\"}],\"c\":null},\"tags\":[[1],[]],\"sub\":\"u\"}",
+                                   names, claims) == true);
+        CHECK(claims.size() == 1);
+        CHECK(claims["sub"] == "u");
+
+        claims.clear();
+        REQUIRE(ClaimScanner::scan("{\"role\":{\"name\":\"admin\"},\"sub\":\"u\"}", names, claims) == true);
+        CHECK(claims.count("role") == 0);
+        CHECK(claims["sub"] == "u");
+    }
+
+    SUBCASE("Escapes are decoded") {
+        JwtClaims claims;
+        REQUIRE(ClaimScanner::scan("{\"sub\":\"a\\\"b\\\\c\\/d\\u00e9\\ud83d\\ude00\",\"x\\\"y\":1}",
+                                   names, claims) == true);
+        CHECK(claims["sub"] == "a\"b\\c/d\xc3\xa9\xf0\x9f\x98\x80");
+    }
+
+    SUBCASE("Values with control characters are dropped") {
+        JwtClaims claims;
+        REQUIRE(ClaimScanner::scan("{\"sub\":\"u\\r\\nX-Admin: 1\",\"role\":\"ok\"}", names, claims) == true);
+        CHECK(claims.count("sub") == 0);
+        CHECK(claims["role"] == "ok");
+
+        for (const std::string& escaped : {"\\n", "\\u0000", "\\u000d", "\\t", "\\u007f"}) {
+            claims.clear();
+            REQUIRE(ClaimScanner::scan("{\"sub\":\"a" + escaped + "b\"}", names, claims) == true);
+            CHECK(claims.count("sub") == 0);
+        }
+
+        claims.clear();
+        REQUIRE(ClaimScanner::scan(std::string("{\"sub\":\"a\rb\",\"aud\":[\"api\",\"x\\ny\"]}"), names, claims) == true);
+        CHECK(claims.empty());
+    }
+
+    SUBCASE("Audience arrays are joined") {
+        JwtClaims claims;
+        REQUIRE(ClaimScanner::scan("{\"aud\":[\"api\", \"admin\"]}", names, claims) == true);
+        CHECK(claims["aud"] == "api,admin");
+
+        claims.clear();
+        REQUIRE(ClaimScanner::scan("{\"aud\":[]}", names, claims) == true);
+        CHECK(claims["aud"] == "");
+
+        claims.clear();
+        REQUIRE(ClaimScanner::scan("{\"aud\":[\"api\",1],\"sub\":\"u\"}", names, claims) == true);
+        CHECK(claims.count("aud") == 0);
+        CHECK(claims["sub"] == "u");
+    }
+
+    SUBCASE("Only JSON numbers in range are dates") {
+        JwtClaims claims;
+        NumericDates dates;
+        REQUIRE(ClaimScanner::scan("{\"exp\":\"1900000000\",\"nbf\":1.7e9}", names, claims, &dates) == true);
+        CHECK(claims["exp"] == "1900000000");
+        CHECK(dates.count("exp") == 0);
+        CHECK(dates["nbf"] == 1700000000);
+
+        dates.clear();
+        REQUIRE(ClaimScanner::scan("{\"exp\":1e300,\"nbf\":-1e300}", names, claims, &dates) == true);
+        CHECK(dates.empty());
+
+        dates.clear();
+        REQUIRE(ClaimScanner::scan("{\"exp\":inf,\"nbf\":nan,\"sub\":0x10}", names, claims, &dates) == true);
+        CHECK(dates.empty());
+
+        dates.clear();
+        REQUIRE(ClaimScanner::scan("{\"exp\":true,\"nbf\":01}", names, claims, &dates) == true);
+        CHECK(dates.empty());
+    }
+
+    SUBCASE("Malformed payloads are rejected") {
+        JwtClaims claims;
+        CHECK(ClaimScanner::scan("", names, claims) == false);
+        CHECK(ClaimScanner::scan("[1,2]", names, claims) == false);
+        CHECK(ClaimScanner::scan("{\"sub\":\"u\"", names, claims) == false);
+        CHECK(ClaimScanner::scan("{\"sub\" \"u\"}", names, claims) == false);
+        CHECK(ClaimScanner::scan("{\"x\":{\"y\":1}", names, claims) == false);
+        CHECK(ClaimScanner::scan("{\"x\":,\"sub\":\"u\"}", names, claims) == false);
+        CHECK(ClaimScanner::scan(std::string(40, '[') + std::string(40, ']'), names, claims) == false);
+        CHECK(ClaimScanner::scan("{\"x\":" + std::string(40, '[') + std::string(40, ']') + "}", names, claims) == false);
+        CHECK(ClaimScanner::scan("{}", names, claims) == true);
+    }
+}
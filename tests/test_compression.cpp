@@ -0,0 +1,106 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/proxy/compression.h"
+#include <zlib.h>
+
+static const std::vector<std::string> offered = {"br", "zstd", "gzip"};
+
+static std::string gunzip(const std::string& data) {
+    z_stream stream{};
+    inflateInit2(&stream, 15 + 16);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    std::string out;
+    char buffer[4096];
+    int result;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (result == Z_OK);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END ? out : "";
+}
+
+TEST_CASE("Content-coding negotiation") {
+    SUBCASE("Identity without an acceptable coding") {
+        CHECK(Compression::negotiate("", offered) == "");
+        CHECK(Compression::negotiate("identity", offered) == "");
+        CHECK(Compression::negotiate("deflate", offered) == "");
+        CHECK(Compression::negotiate("gzip;q=0", offered) == "");
+        CHECK(Compression::negotiate("gzip;q=abc", offered) == "");
+    }
+
+    SUBCASE("Names are case-insensitive and x-gzip is gzip") {
+        CHECK(Compression::negotiate("GZip", offered) == "gzip");
+        CHECK(Compression::negotiate("x-gzip", offered) == "gzip");
+        CHECK(Compression::negotiate(" deflate , gzip ; q=0.5", offered) == "gzip");
+    }
+
+    SUBCASE("Wildcards cover the codings that are not listed") {
+        CHECK(Compression::negotiate("*", offered) != "");
+        CHECK(Compression::negotiate("*;q=0.2", {"gzip"}) == "gzip");
+        CHECK(Compression::negotiate("gzip;q=0, *", {"gzip"}) == "");
+    }
+
+    SUBCASE("Only offered codings are chosen") {
+        CHECK(Compression::negotiate("gzip", {"br"}) == "");
+        CHECK(Compression::negotiate("gzip", {}) == "");
+    }
+
+    SUBCASE("Higher q-values win, ties go to the route's order") {
+        if (!Compression::is_supported("br")) {
+            return;
+        }
+        CHECK(Compression::negotiate("gzip, br", offered) == "br");
+        CHECK(Compression::negotiate("gzip, br", {"gzip", "br"}) == "gzip");
+        CHECK(Compression::negotiate("gzip;q=1.0, br;q=0.8", offered) == "gzip");
+        CHECK(Compression::negotiate("gzip;q=0.5, *;q=0.9", offered) == "br");
+    }
+}
+
+TEST_CASE("Compression levels and content types") {
+    CHECK(Compression::adaptive_level("gzip", 6, 1000, 0.2) == 6);
+    CHECK(Compression::adaptive_level("gzip", 9, 1000, 1.0) == 1);
+    CHECK(Compression::adaptive_level("gzip", 9, 1000, 0.75) == 5);
+    CHECK(Compression::adaptive_level("gzip", 9, 8 * 1024 * 1024, 0.0) == 4);
+    CHECK(Compression::adaptive_level("gzip", 1, 1000, 1.0) == 1);
+
+    CHECK(Compression::is_compressible("text/html; charset=utf-8") == true);
+    CHECK(Compression::is_compressible("application/json") == true);
+    CHECK(Compression::is_compressible("image/png") == false);
+}
+
+TEST_CASE("Gzip output") {
+    std::string input;
+    for (int i = 0; i < 2000; ++i) {
+        input += "line " + std::to_string(i) + "\n";
+    }
+
+    SUBCASE("One-shot compression") {
+        std::string output;
+        REQUIRE(Compression::compress("gzip", input, output, 6) == true);
+        CHECK(output.size() < input.size());
+        CHECK(gunzip(output) == input);
+    }
+
+    SUBCASE("Streams reuse the thread's context") {
+        for (int round = 0; round < 2; ++round) {
+            auto stream = Compression::make_stream("gzip", 6);
+            REQUIRE(stream != nullptr);
+            std::string output;
+            REQUIRE(stream->write(input.data(), input.size() / 2, output) == true);
+            REQUIRE(stream->write(input.data() + input.size() / 2, input.size() - input.size() / 2, output) == true);
+            REQUIRE(stream->finish(output) == true);
+            CHECK(gunzip(output) == input);
+        }
+    }
+
+    SUBCASE("Unsupported codings") {
+        std::string output;
+        CHECK(Compression::make_stream("deflate", 6) == nullptr);
+        CHECK(Compression::compress("deflate", input, output, 6) == false);
+    }
+}
@@ -0,0 +1,114 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/conditional.h"
+#include "../src/http/HttpDate.h"
+
+static HttpResponse make_response() {
+    HttpResponse response(HttpStatus::OK);
+    response.set_body("hello", "text/plain");
+    response.set_header("ETag", "\"v1\"");
+    response.set_header("Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT");
+    response.set_header("Cache-Control", "max-age=60");
+    return response;
+}
+
+static HttpRequest make_request(const std::string& name, const std::string& value) {
+    HttpRequest request("GET", "/api/items", "HTTP/1.1");
+    request.set_header(name, value);
+    return request;
+}
+
+TEST_CASE("HTTP dates") {
+    long long unix_time = 0;
+    REQUIRE(HttpDate::parse("Sun, 06 Nov 1994 08:49:37 GMT", unix_time) == true);
+    CHECK(unix_time == 784111777);
+    CHECK(HttpDate::format(784111777) == "Sun, 06 Nov 1994 08:49:37 GMT");
+    CHECK(HttpDate::parse("yesterday", unix_time) == false);
+    CHECK(HttpDate::parse("", unix_time) == false);
+}
+
+TEST_CASE("Conditional request evaluation") {
+    HttpResponse response = make_response();
+
+    SUBCASE("If-None-Match compares entity tags weakly") {
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "\"v1\""), response) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "W/\"v1\""), response) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "\"v0\", \"v1\""), response) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "*"), response) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "\"v2\""), response) == false);
+    }
+
+    SUBCASE("If-None-Match takes precedence over If-Modified-Since") {
+        HttpRequest request = make_request("If-None-Match", "\"v2\"");
+        request.set_header("If-Modified-Since", "Mon, 07 Nov 1994 08:49:37 GMT");
+        CHECK(Conditional::is_not_modified(request, response) == false);
+    }
+
+    SUBCASE("If-Modified-Since compares dates") {
+        CHECK(Conditional::is_not_modified(make_request("If-Modified-Since", "Sun, 06 Nov 1994 08:49:37 GMT"),
+                                           response) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-Modified-Since", "Mon, 07 Nov 1994 08:49:37 GMT"),
+                                           response) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-Modified-Since", "Sat, 05 Nov 1994 08:49:37 GMT"),
+                                           response) == false);
+        CHECK(Conditional::is_not_modified(make_request("If-Modified-Since", "garbage"), response) == false);
+    }
+
+    SUBCASE("A 304 carries validators and caching headers but no body") {
+        HttpResponsePtr not_modified = Conditional::make_not_modified(response);
+        CHECK(not_modified->status() == HttpStatus::NOT_MODIFIED);
+        CHECK(not_modified->get_header("ETag") == "\"v1\"");
+        CHECK(not_modified->get_header("Cache-Control") == "max-age=60");
+        CHECK(not_modified->body().empty());
+    }
+
+    SUBCASE("Revalidation headers and merging an upstream 304") {
+        HttpRequest request("GET", "/api/items", "HTTP/1.1");
+        Conditional::add_revalidation_headers(request, response);
+        CHECK(request.get_header("If-None-Match") == "\"v1\"");
+        CHECK(request.get_header("If-Modified-Since") == "Sun, 06 Nov 1994 08:49:37 GMT");
+
+        HttpResponse upstream(HttpStatus::NOT_MODIFIED);
+        upstream.set_header("Cache-Control", "max-age=120");
+        upstream.set_header("X-Other", "ignored");
+        Conditional::merge_not_modified(response, upstream);
+        CHECK(response.get_header("Cache-Control") == "max-age=120");
+        CHECK(response.get_header("ETag") == "\"v1\"");
+        CHECK(response.get_header("X-Other").empty());
+        CHECK(response.body() == "hello");
+    }
+
+    SUBCASE("If-Range needs a strong tag or the exact date") {
+        CHECK(Conditional::if_range_matches(HttpRequest("GET", "/", "HTTP/1.1"), response) == true);
+        CHECK(Conditional::if_range_matches(make_request("If-Range", "\"v1\""), response) == true);
+        CHECK(Conditional::if_range_matches(make_request("If-Range", "W/\"v1\""), response) == false);
+        CHECK(Conditional::if_range_matches(make_request("If-Range", "\"v2\""), response) == false);
+        CHECK(Conditional::if_range_matches(make_request("If-Range", "Sun, 06 Nov 1994 08:49:37 GMT"), response) == true);
+        CHECK(Conditional::if_range_matches(make_request("If-Range", "Mon, 07 Nov 1994 08:49:37 GMT"), response) == false);
+    }
+
+    SUBCASE("Encoded variants get their own entity tag") {
+        HttpResponse gzip(HttpStatus::OK);
+        gzip.set_header("ETag", "\"v1\"");
+        Conditional::tag_variant(gzip, "gzip");
+        CHECK(gzip.get_header("ETag") == "\"v1-gzip\"");
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "\"v1-gzip\""), gzip) == true);
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "\"v1\""), gzip) == false);
+        CHECK(Conditional::is_not_modified(make_request("If-None-Match", "\"v1-gzip\""), response) == false);
+        CHECK(Conditional::if_range_matches(make_request("If-Range", "\"v1-gzip\""), response) == false);
+
+        HttpResponse weak(HttpStatus::OK);
+        weak.set_header("ETag", "W/\"v1\"");
+        Conditional::tag_variant(weak, "br");
+        CHECK(weak.get_header("ETag") == "W/\"v1-br\"");
+
+        HttpResponse malformed(HttpStatus::OK);
+        malformed.set_header("ETag", "v1");
+        Conditional::tag_variant(malformed, "gzip");
+        CHECK(malformed.get_header("ETag").empty());
+
+        HttpResponse untagged(HttpStatus::OK);
+        Conditional::tag_variant(untagged, "gzip");
+        CHECK(untagged.get_header("ETag").empty());
+    }
+}
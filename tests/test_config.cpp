@@ -1,6 +1,8 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "../src/config/Config.h"
+#include <cstdio>
+#include <fstream>
 
 TEST_CASE("Config loading from JSON") {
     Config config;
@@ -15,6 +17,47 @@ TEST_CASE("Config loading from JSON") {
         CHECK(config.get_ssl_key_path() == "/etc/ssl/private/privkey.pem");
     }
 
+    SUBCASE("CORS policy is compiled from the origin list") {
+        REQUIRE(config.load("../config/proxyConfig.json") == true);
+        const CorsPolicy& cors = config.get_cors_policy();
+        CHECK(cors.allows_origin("https://example.com") == true);
+        CHECK(cors.allows_origin("https://app.example.com") == true);
+        CHECK(cors.allows_origin("https://a.b.example.com") == true);
+        CHECK(cors.allows_origin("https://evil-example.com") == false);
+        CHECK(cors.allows_origin("http://app.example.com") == false);
+        CHECK(cors.allows_request("PUT", "content-type, Authorization") == true);
+        CHECK(cors.allows_request("PATCH", "") == false);
+        CHECK(cors.allows_request("GET", "X-Custom") == false);
+    }
+
+    SUBCASE("Routes sharing a prefix get distinct identities") {
+        REQUIRE(config.load("../config/proxyConfig.json") == true);
+        std::map<std::string, std::string> premium = {{"tier", "premium"}};
+        const RouteConfig* generic = config.find_route("/api/items");
+        const RouteConfig* restricted = config.find_route("/api/items", &premium);
+        REQUIRE(generic != nullptr);
+        REQUIRE(restricted != nullptr);
+        CHECK(generic->route_id == "/api");
+        CHECK(restricted->route_id == "/api\ntier=premium");
+    }
+
+    SUBCASE("Bans must outlive every cached entry") {
+        auto load_with_ban_ttl = [&config](int ban_ttl_seconds) {
+            {
+                std::ofstream file("ban_ttl_config.json", std::ios::trunc);
+                file << "{\"cache\": {\"ban_ttl_seconds\": " << ban_ttl_seconds << "},"
+                     << " \"routes\": [{\"path_prefix\": \"/api\", \"cache_enabled\": true,"
+                     << " \"cache_ttl_seconds\": 300, \"stale_if_error_seconds\": 600,"
+                     << " \"cache_status_ttls\": {\"404\": 30}}]}";
+            }
+            bool loaded = config.load("ban_ttl_config.json");
+            std::remove("ban_ttl_config.json");
+            return loaded;
+        };
+        CHECK(load_with_ban_ttl(900) == true);
+        CHECK(load_with_ban_ttl(899) == false);
+    }
+
     SUBCASE("Invalid configuration file") {
         REQUIRE(config.load("../config/invalidConfig.json") == false);
     }
@@ -0,0 +1,84 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/corsPolicy.h"
+
+static const std::vector<std::string> methods = {"GET", "POST"};
+static const std::vector<std::string> headers = {"Content-Type", "X-Request-ID"};
+
+TEST_CASE("CORS origins") {
+    SUBCASE("An empty policy answers nothing") {
+        CorsPolicy policy;
+        CHECK(policy.empty() == true);
+        CHECK(policy.allows_origin("https://example.com") == false);
+        CHECK(policy.response_headers()->empty());
+        CHECK(policy.preflight_headers()->empty());
+    }
+
+    SUBCASE("Exact origins") {
+        CorsPolicy policy({"https://example.com", "HTTP://Localhost:3000"}, methods, headers, false, 600);
+        CHECK(policy.empty() == false);
+        CHECK(policy.allows_origin("https://example.com") == true);
+        CHECK(policy.allows_origin("http://localhost:3000") == true);
+        CHECK(policy.allows_origin("http://example.com") == false);
+        CHECK(policy.allows_origin("https://example.com:443") == false);
+        CHECK(policy.allows_origin("https://example.com.evil.net") == false);
+        CHECK(policy.allows_origin("") == false);
+        CHECK(policy.allows_origin("null") == false);
+    }
+
+    SUBCASE("Wildcard subdomains") {
+        CorsPolicy policy({"https://*.example.com"}, methods, headers, false, 600);
+        CHECK(policy.allows_origin("https://app.example.com") == true);
+        CHECK(policy.allows_origin("https://a.b.example.com") == true);
+        CHECK(policy.allows_origin("https://example.com") == false);
+        CHECK(policy.allows_origin("https://evil-example.com") == false);
+        CHECK(policy.allows_origin("https://example.com.evil.net") == false);
+        CHECK(policy.allows_origin("https://app.example.com:8443") == false);
+        CHECK(policy.allows_origin("http://app.example.com") == false);
+        CHECK(policy.allows_origin("app.example.com") == false);
+    }
+
+    SUBCASE("Any origin") {
+        CorsPolicy policy({"*"}, methods, headers, false, 600);
+        CHECK(policy.allows_origin("https://anything.test") == true);
+        CHECK(policy.allows_origin("") == false);
+    }
+}
+
+TEST_CASE("CORS preflight requests") {
+    CorsPolicy policy({"https://example.com"}, methods, headers, true, 600);
+
+    SUBCASE("Methods are matched exactly") {
+        CHECK(policy.allows_request("GET", "") == true);
+        CHECK(policy.allows_request(" POST ", "") == true);
+        CHECK(policy.allows_request("get", "") == false);
+        CHECK(policy.allows_request("DELETE", "") == false);
+    }
+
+    SUBCASE("Every requested header must be allowed, in any case") {
+        CHECK(policy.allows_request("POST", "content-type") == true);
+        CHECK(policy.allows_request("POST", "Content-Type, x-request-id") == true);
+        CHECK(policy.allows_request("POST", " , content-type ,") == true);
+        CHECK(policy.allows_request("POST", "content-type, authorization") == false);
+        CHECK(policy.allows_request("POST", "content") == false);
+    }
+}
+
+TEST_CASE("CORS header blocks") {
+    SUBCASE("Responses vary on the origin") {
+        CorsPolicy policy({"https://example.com"}, methods, headers, false, 600);
+        CHECK(*policy.response_headers() == "Vary: Origin\r\n");
+        CHECK(*policy.preflight_headers() ==
+              "Vary: Origin\r\n"
+              "Access-Control-Allow-Methods: GET, POST\r\n"
+              "Access-Control-Allow-Headers: Content-Type, X-Request-ID\r\n"
+              "Access-Control-Max-Age: 600\r\n");
+    }
+
+    SUBCASE("Credentials are allowed in both blocks") {
+        CorsPolicy policy({"https://example.com"}, methods, headers, true, 0);
+        CHECK(*policy.response_headers() == "Vary: Origin\r\nAccess-Control-Allow-Credentials: true\r\n");
+        CHECK(policy.preflight_headers()->find("Access-Control-Allow-Credentials: true\r\n") != std::string::npos);
+        CHECK(policy.preflight_headers()->find("Access-Control-Max-Age: 0\r\n") != std::string::npos);
+    }
+}
@@ -0,0 +1,168 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/diskCache.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+static const char* CACHE_DIR = "test_disk_cache_dir";
+static const size_t SEGMENT_BYTES = 4096;
+
+static CacheEntry make_entry(const std::string& body) {
+    CacheEntry entry;
+    entry.response = std::make_shared<HttpResponse>(HttpStatus::OK);
+    entry.response->set_body(body, "application/json");
+    entry.response->set_header("ETag", "\"v1\"");
+    entry.stored_at = CacheEntry::now();
+    entry.fresh_seconds = 300;
+    entry.uri = "/api/items";
+    return entry;
+}
+
+static std::string segment_path(unsigned int id) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%08u.dat", id);
+    return std::string(CACHE_DIR) + "/" + name;
+}
+
+// Overwrite a record header in place, as a crash or bit rot would leave it
+static void write_header(unsigned int segment, size_t offset, uint32_t key_length, uint64_t entry_length) {
+    unsigned char header[24] = {0x44, 0x50, 0x43, 0x52};
+    for (int i = 0; i < 4; ++i) {
+        header[4 + i] = static_cast<unsigned char>((key_length >> (8 * i)) & 0xff);
+    }
+    for (int i = 0; i < 8; ++i) {
+        header[8 + i] = static_cast<unsigned char>((entry_length >> (8 * i)) & 0xff);
+        header[16 + i] = i == 7 ? 0x7f : 0xff;  // far future expiry
+    }
+
+    std::fstream file(segment_path(segment), std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(offset));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+static std::string read_key(unsigned int segment, size_t offset, size_t length) {
+    std::string key(length, '\0');
+    std::ifstream file(segment_path(segment), std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset + 24));
+    file.read(&key[0], static_cast<std::streamsize>(length));
+    return key;
+}
+
+TEST_CASE("Disk cache") {
+    std::filesystem::remove_all(CACHE_DIR);
+    long long expires_at = CacheEntry::now() + 300;
+
+    SUBCASE("Put, get and remove") {
+        DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+        REQUIRE(cache.open() == true);
+
+        REQUIRE(cache.put("GET:/a", make_entry("{\"a\":1}"), expires_at) == true);
+        CacheEntry entry;
+        REQUIRE(cache.get("GET:/a", entry) == true);
+        CHECK(entry.response->file_body() != nullptr);
+        CHECK(entry.response->body_view() == "{\"a\":1}");
+        CHECK(entry.response->get_header("ETag") == "\"v1\"");
+        CHECK(entry.fresh_seconds == 300);
+        CHECK(entry.uri == "/api/items");
+
+        CHECK(cache.get("GET:/b", entry) == false);
+        cache.remove("GET:/a");
+        CHECK(cache.get("GET:/a", entry) == false);
+    }
+
+    SUBCASE("Entries larger than a segment are refused") {
+        DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+        REQUIRE(cache.open() == true);
+        CHECK(cache.put("GET:/big", make_entry(std::string(SEGMENT_BYTES, 'x')), expires_at) == false);
+    }
+
+    SUBCASE("Expired entries are not returned") {
+        DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+        REQUIRE(cache.open() == true);
+        REQUIRE(cache.put("GET:/old", make_entry("old"), CacheEntry::now() - 1) == true);
+        CacheEntry entry;
+        CHECK(cache.get("GET:/old", entry) == false);
+    }
+
+    SUBCASE("Reopening rebuilds the index from the segments") {
+        {
+            DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+            REQUIRE(cache.open() == true);
+            REQUIRE(cache.put("GET:/a", make_entry("first"), expires_at) == true);
+            REQUIRE(cache.put("GET:/a", make_entry("second"), expires_at) == true);
+            REQUIRE(cache.put("GET:/b", make_entry("removed"), expires_at) == true);
+            REQUIRE(cache.put("GET:/c", make_entry("expired"), CacheEntry::now() - 1) == true);
+            cache.remove("GET:/b");
+        }
+
+        DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+        REQUIRE(cache.open() == true);
+        CacheEntry entry;
+        REQUIRE(cache.get("GET:/a", entry) == true);
+        CHECK(entry.response->body_view() == "second");
+        CHECK(cache.get("GET:/b", entry) == false);
+        CHECK(cache.get("GET:/c", entry) == false);
+
+        // New records go after the existing ones
+        REQUIRE(cache.put("GET:/d", make_entry("later"), expires_at) == true);
+        REQUIRE(cache.get("GET:/a", entry) == true);
+        CHECK(entry.response->body_view() == "second");
+    }
+
+    SUBCASE("A corrupt record ends the scan without losing earlier entries") {
+        CacheEntry first = make_entry("first");
+        size_t second_offset = 24 + std::string("GET:/a").size() + first.serialize().size();
+        {
+            DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+            REQUIRE(cache.open() == true);
+            REQUIRE(cache.put("GET:/a", first, expires_at) == true);
+            REQUIRE(cache.put("GET:/b", make_entry("second"), expires_at) == true);
+        }
+
+        SUBCASE("Lengths that wrap around when added") {
+            write_header(0, second_offset, 6, UINT64_MAX - 16);
+        }
+        SUBCASE("A record running past the end of the segment") {
+            write_header(0, second_offset, 6, SEGMENT_BYTES);
+        }
+        SUBCASE("A key running past the end of the segment") {
+            write_header(0, second_offset, UINT32_MAX, 0);
+        }
+
+        DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 4 * SEGMENT_BYTES);
+        REQUIRE(cache.open() == true);
+        CacheEntry entry;
+        REQUIRE(cache.get("GET:/a", entry) == true);
+        CHECK(entry.response->body_view() == "first");
+        CHECK(cache.get("GET:/b", entry) == false);
+
+        // The torn record is overwritten by the next write
+        REQUIRE(cache.put("GET:/c", make_entry("third"), expires_at) == true);
+        REQUIRE(cache.get("GET:/c", entry) == true);
+        CHECK(entry.response->body_view() == "third");
+        CHECK(read_key(0, second_offset, 6) == "GET:/c");
+    }
+
+    SUBCASE("Evicted segments stay readable while a response uses them") {
+        DiskCache cache(CACHE_DIR, SEGMENT_BYTES, 2 * SEGMENT_BYTES);
+        REQUIRE(cache.open() == true);
+
+        std::string body(1500, 'a');
+        REQUIRE(cache.put("GET:/0", make_entry(body), expires_at) == true);
+        CacheEntry held;
+        REQUIRE(cache.get("GET:/0", held) == true);
+
+        for (int i = 1; i <= 6; ++i) {
+            REQUIRE(cache.put("GET:/" + std::to_string(i), make_entry(std::string(1500, 'b')), expires_at) == true);
+        }
+
+        CacheEntry entry;
+        CHECK(cache.get("GET:/0", entry) == false);
+        CHECK(cache.get("GET:/6", entry) == true);
+        CHECK(std::filesystem::exists(segment_path(0)) == false);
+        CHECK(held.response->body_view() == body);
+    }
+
+    std::filesystem::remove_all(CACHE_DIR);
+}
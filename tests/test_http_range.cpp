@@ -0,0 +1,103 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/http/HttpRange.h"
+
+using HttpRange::ParseResult;
+
+TEST_CASE("Range header parsing") {
+    std::vector<HttpRange::ByteRange> ranges;
+
+    SUBCASE("Closed, open-ended and suffix ranges") {
+        REQUIRE(HttpRange::parse("bytes=0-99", 1000, ranges) == ParseResult::SATISFIABLE);
+        REQUIRE(ranges.size() == 1);
+        CHECK(ranges[0].first == 0);
+        CHECK(ranges[0].last == 99);
+        CHECK(ranges[0].length() == 100);
+
+        REQUIRE(HttpRange::parse("bytes=900-", 1000, ranges) == ParseResult::SATISFIABLE);
+        CHECK(ranges[0].first == 900);
+        CHECK(ranges[0].last == 999);
+
+        REQUIRE(HttpRange::parse("bytes=-300", 1000, ranges) == ParseResult::SATISFIABLE);
+        CHECK(ranges[0].first == 700);
+        CHECK(ranges[0].last == 999);
+    }
+
+    SUBCASE("Ranges are clamped to the representation") {
+        REQUIRE(HttpRange::parse("bytes=990-2000", 1000, ranges) == ParseResult::SATISFIABLE);
+        CHECK(ranges[0].last == 999);
+
+        REQUIRE(HttpRange::parse("bytes=-5000", 1000, ranges) == ParseResult::SATISFIABLE);
+        CHECK(ranges[0].first == 0);
+    }
+
+    SUBCASE("Multiple ranges with whitespace and case-insensitive unit") {
+        REQUIRE(HttpRange::parse(" Bytes=0-0, 10-19 ,-1", 100, ranges) == ParseResult::SATISFIABLE);
+        REQUIRE(ranges.size() == 3);
+        CHECK(ranges[1].first == 10);
+        CHECK(ranges[2].first == 99);
+    }
+
+    SUBCASE("Ranges beyond the end are unsatisfiable") {
+        CHECK(HttpRange::parse("bytes=1000-", 1000, ranges) == ParseResult::UNSATISFIABLE);
+        CHECK(HttpRange::parse("bytes=-0", 1000, ranges) == ParseResult::UNSATISFIABLE);
+        CHECK(HttpRange::parse("bytes=0-10", 0, ranges) == ParseResult::UNSATISFIABLE);
+        CHECK(HttpRange::parse("bytes=2000-3000, 5-9", 1000, ranges) == ParseResult::SATISFIABLE);
+        CHECK(ranges.size() == 1);
+    }
+
+    SUBCASE("Invalid headers are ignored") {
+        CHECK(HttpRange::parse("", 1000, ranges) == ParseResult::IGNORED);
+        CHECK(HttpRange::parse("items=0-1", 1000, ranges) == ParseResult::IGNORED);
+        CHECK(HttpRange::parse("bytes=", 1000, ranges) == ParseResult::IGNORED);
+        CHECK(HttpRange::parse("bytes=5", 1000, ranges) == ParseResult::IGNORED);
+        CHECK(HttpRange::parse("bytes=9-5", 1000, ranges) == ParseResult::IGNORED);
+        CHECK(HttpRange::parse("bytes=a-5", 1000, ranges) == ParseResult::IGNORED);
+        CHECK(HttpRange::parse("bytes=0-99999999999999999999", 1000, ranges) == ParseResult::IGNORED);
+    }
+
+    SUBCASE("Too many ranges are ignored") {
+        std::string header = "bytes=0-0";
+        for (int i = 1; i <= 16; ++i) {
+            header += "," + std::to_string(i * 2) + "-" + std::to_string(i * 2);
+        }
+        CHECK(HttpRange::parse(header, 1000, ranges) == ParseResult::IGNORED);
+    }
+}
+
+TEST_CASE("Partial responses") {
+    HttpResponse full(HttpStatus::OK);
+    full.set_body("0123456789", "text/plain");
+    full.set_header("ETag", "\"v1\"");
+
+    SUBCASE("A single range") {
+        auto partial = HttpRange::make_partial(full, {{2, 5}});
+        CHECK(partial->status() == HttpStatus::PARTIAL_CONTENT);
+        CHECK(partial->body() == "2345");
+        CHECK(partial->get_header("Content-Range") == "bytes 2-5/10");
+        CHECK(partial->get_header("ETag") == "\"v1\"");
+    }
+
+    SUBCASE("Multiple ranges become multipart/byteranges") {
+        auto partial = HttpRange::make_partial(full, {{0, 1}, {8, 9}});
+        std::string content_type = partial->get_header("Content-Type");
+        REQUIRE(content_type.compare(0, 31, "multipart/byteranges; boundary=") == 0);
+        std::string boundary = content_type.substr(31);
+        CHECK(partial->body() ==
+              "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/10\r\n\r\n01"
+              "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 8-9/10\r\n\r\n89"
+              "\r\n--" + boundary + "--\r\n");
+    }
+
+    SUBCASE("Separately fetched parts") {
+        auto partial = HttpRange::make_partial(full, 1000, {{100, 102}}, {"abc"});
+        CHECK(partial->body() == "abc");
+        CHECK(partial->get_header("Content-Range") == "bytes 100-102/1000");
+    }
+
+    SUBCASE("Unsatisfiable ranges") {
+        auto response = HttpRange::make_unsatisfiable(10);
+        CHECK(response->status() == HttpStatus::RANGE_NOT_SATISFIABLE);
+        CHECK(response->get_header("Content-Range") == "bytes */10");
+    }
+}
@@ -0,0 +1,77 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/ipFilter.h"
+
+TEST_CASE("IP filter") {
+    SUBCASE("No rules allow every address") {
+        IpFilter filter;
+        CHECK(filter.empty() == true);
+        CHECK(filter.allows("203.0.113.9") == true);
+        CHECK(filter.allows("2001:db8::1") == true);
+    }
+
+    SUBCASE("IPv4 CIDR allow list") {
+        IpFilter filter;
+        REQUIRE(filter.add("192.168.1.0/24", true) == true);
+        REQUIRE(filter.add("10.0.0.7", true) == true);
+        CHECK(filter.allows("192.168.1.0") == true);
+        CHECK(filter.allows("192.168.1.255") == true);
+        CHECK(filter.allows("192.168.2.1") == false);
+        CHECK(filter.allows("10.0.0.7") == true);
+        CHECK(filter.allows("10.0.0.8") == false);
+        CHECK(filter.allows("2001:db8::1") == false);
+    }
+
+    SUBCASE("Most specific rule wins") {
+        IpFilter filter;
+        REQUIRE(filter.add("10.0.0.0/8", true) == true);
+        REQUIRE(filter.add("10.13.0.0/16", false) == true);
+        REQUIRE(filter.add("10.13.7.0/24", true) == true);
+        CHECK(filter.allows("10.1.2.3") == true);
+        CHECK(filter.allows("10.13.1.1") == false);
+        CHECK(filter.allows("10.13.7.200") == true);
+    }
+
+    SUBCASE("Deny list alone allows everything else") {
+        IpFilter filter;
+        REQUIRE(filter.add("198.51.100.0/24", false) == true);
+        REQUIRE(filter.add("2001:db8:bad::/48", false) == true);
+        CHECK(filter.allows("198.51.100.20") == false);
+        CHECK(filter.allows("198.51.101.20") == true);
+        CHECK(filter.allows("2001:db8:bad:1::5") == false);
+        CHECK(filter.allows("2001:db8:600d::5") == true);
+    }
+
+    SUBCASE("IPv6 ranges and IPv4-mapped addresses") {
+        IpFilter filter;
+        REQUIRE(filter.add("2001:db8::/32", true) == true);
+        REQUIRE(filter.add("127.0.0.0/8", true) == true);
+        CHECK(filter.allows("2001:db8:1234::1") == true);
+        CHECK(filter.allows("2001:db9::1") == false);
+        CHECK(filter.allows("::ffff:127.0.0.1") == true);
+        CHECK(filter.allows("::ffff:128.0.0.1") == false);
+    }
+
+    SUBCASE("Wildcards cover every address") {
+        IpFilter filter;
+        REQUIRE(filter.add("*", true) == true);
+        REQUIRE(filter.add("192.0.2.1", false) == true);
+        CHECK(filter.allows("203.0.113.9") == true);
+        CHECK(filter.allows("::1") == true);
+        CHECK(filter.allows("192.0.2.1") == false);
+    }
+
+    SUBCASE("Malformed rules and addresses are rejected") {
+        IpFilter filter;
+        CHECK(filter.add("192.168.1.0/33", false) == false);
+        CHECK(filter.add("192.168.1/24", false) == false);
+        CHECK(filter.add("2001:db8::/129", false) == false);
+        CHECK(filter.add("10.0.0.0/", false) == false);
+        CHECK(filter.add("example.com", false) == false);
+        CHECK(filter.empty() == true);
+
+        REQUIRE(filter.add("10.0.0.0/8", false) == true);
+        CHECK(filter.allows("not-an-ip") == false);
+        CHECK(filter.allows("") == false);
+    }
+}
@@ -0,0 +1,71 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/jwks.h"
+#include <cstdio>
+#include <fstream>
+
+// Ed25519 public key from RFC 8037, appendix A.2
+static const std::string ED25519_X = "11qYAYKxCrfVS_7TyWQHOg7hcvPapiMlrwIaaPcHURo";
+static const std::string JWKS_FILE = "test_jwks.json";
+
+static void write_jwks(const std::string& document) {
+    std::ofstream file(JWKS_FILE, std::ios::trunc);
+    file << document;
+}
+
+static std::string ed25519_jwk(const std::string& kid) {
+    return R"({"kty":"OKP","crv":"Ed25519","kid":")" + kid + R"(","x":")" + ED25519_X + R"("})";
+}
+
+TEST_CASE("JWKS parsing") {
+    SUBCASE("Supported keys are loaded by kid") {
+        write_jwks(R"({"keys":[)" + ed25519_jwk("k1") + "," + ed25519_jwk("k2") + "]}");
+        JwkSet jwks(JWKS_FILE);
+        REQUIRE(jwks.load() == true);
+        CHECK(jwks.size() == 2);
+        REQUIRE(jwks.find("k1") != nullptr);
+        CHECK(jwks.find("k1")->alg == "EdDSA");
+        CHECK(jwks.find("k3") == nullptr);
+        CHECK(jwks.find("") == nullptr);
+    }
+
+    SUBCASE("Documents that are not a key set are rejected") {
+        for (const std::string document : {"", "[]", "42", R"("keys")", R"({"keys":{}})", R"({"keys":[]})"}) {
+            write_jwks(document);
+            JwkSet jwks(JWKS_FILE);
+            CHECK(jwks.load() == false);
+            CHECK(jwks.size() == 0);
+        }
+    }
+
+    SUBCASE("Malformed keys are skipped") {
+        write_jwks(R"({"keys":[1, "x", null, [], {"kty":["OKP"]}, {"kty":"OKP","crv":{},"x":"AA"},
+                               {"kty":"OKP","crv":"Ed25519","kid":7,"x":")" + ED25519_X + R"("},
+                               {"kty":"OKP","crv":"Ed25519","alg":"RS256","x":")" + ED25519_X + R"("},
+                               {"kty":"OKP","crv":"Ed25519","use":"enc","x":")" + ED25519_X + R"("},)" +
+                   ed25519_jwk("good") + "]}");
+        JwkSet jwks(JWKS_FILE);
+        REQUIRE(jwks.load() == true);
+        CHECK(jwks.size() == 2);
+        CHECK(jwks.find("good") != nullptr);
+        CHECK(jwks.find("") == nullptr);
+    }
+
+    SUBCASE("A bad reload keeps the current keys") {
+        write_jwks(R"({"keys":[)" + ed25519_jwk("k1") + "]}");
+        JwkSet jwks(JWKS_FILE);
+        REQUIRE(jwks.load() == true);
+
+        write_jwks(R"([{"keys":[]}])");
+        CHECK(jwks.load() == false);
+        write_jwks(R"({"keys":[{"kty":"RSA","n":"AQAB","e":"AQAB"}]})");
+        CHECK(jwks.load() == false);
+        std::remove(JWKS_FILE.c_str());
+        CHECK(jwks.load() == false);
+
+        CHECK(jwks.size() == 1);
+        CHECK(jwks.find("k1") != nullptr);
+    }
+
+    std::remove(JWKS_FILE.c_str());
+}
@@ -0,0 +1,112 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/base64url.h"
+#include "../src/security/hmacSigner.h"
+#include <thread>
+
+static std::string hex(const unsigned char* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < size; ++i) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0x0f];
+    }
+    return out;
+}
+
+static std::string sign_hex(const HmacSigner& signer, std::string_view data) {
+    unsigned char mac[HmacSigner::MAC_SIZE];
+    REQUIRE(signer.sign(data, mac) == true);
+    return hex(mac, sizeof(mac));
+}
+
+TEST_CASE("Base64url coding") {
+    SUBCASE("RFC 4648 test vectors without padding") {
+        const std::pair<std::string, std::string> vectors[] = {
+            {"", ""}, {"f", "Zg"}, {"fo", "Zm8"}, {"foo", "Zm9v"},
+            {"foob", "Zm9vYg"}, {"fooba", "Zm9vYmE"}, {"foobar", "Zm9vYmFy"}
+        };
+        for (const auto& [plain, encoded] : vectors) {
+            CHECK(Base64Url::encode(plain) == encoded);
+            std::string decoded;
+            REQUIRE(Base64Url::decode(encoded, decoded) == true);
+            CHECK(decoded == plain);
+            CHECK(Base64Url::decoded_size(encoded.size()) == plain.size());
+        }
+    }
+
+    SUBCASE("The URL-safe alphabet") {
+        const unsigned char bytes[] = {0xfb, 0xff, 0xbf};
+        CHECK(Base64Url::encode(bytes, sizeof(bytes)) == "-_-_");
+        std::string decoded;
+        REQUIRE(Base64Url::decode("-_-_", decoded) == true);
+        CHECK(decoded == std::string(reinterpret_cast<const char*>(bytes), sizeof(bytes)));
+    }
+
+    SUBCASE("Malformed input is rejected") {
+        std::string decoded = "stale";
+        CHECK(Base64Url::decode("Zm9vY", decoded) == false);
+        CHECK(decoded.empty());
+        CHECK(Base64Url::decode("Zm9v+g", decoded) == false);
+        CHECK(Base64Url::decode("Zm9v/g", decoded) == false);
+        CHECK(Base64Url::decode("Zm9vYg==", decoded) == false);
+        CHECK(Base64Url::decode("Zm 9v", decoded) == false);
+        CHECK(Base64Url::decode(std::string("Zm\0v", 4), decoded) == false);
+    }
+
+    SUBCASE("Decoding into a caller buffer checks its capacity") {
+        unsigned char buffer[6];
+        CHECK(Base64Url::decode("Zm9vYmFy", buffer, sizeof(buffer)) == 6);
+        CHECK(std::string(reinterpret_cast<const char*>(buffer), 6) == "foobar");
+        CHECK(Base64Url::decode("Zm9vYmFy", buffer, 5) == -1);
+        CHECK(Base64Url::decode("Zm9vYmE", buffer, 5) == 5);
+    }
+}
+
+TEST_CASE("HMAC-SHA256 signing") {
+    SUBCASE("RFC 4231 test vectors") {
+        CHECK(sign_hex(HmacSigner(std::string(20, '\x0b')), "Hi There") ==
+              "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+        CHECK(sign_hex(HmacSigner("Jefe"), "what do ya want for nothing?") ==
+              "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+        CHECK(sign_hex(HmacSigner(std::string(131, '\xaa')), "Test Using Larger Than Block-Size Key - Hash Key First") ==
+              "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    }
+
+    SUBCASE("Signers sharing a thread rekey its context") {
+        HmacSigner jefe("Jefe");
+        HmacSigner other("other");
+        std::string expected = sign_hex(jefe, "what do ya want for nothing?");
+        std::string other_mac = sign_hex(other, "what do ya want for nothing?");
+        CHECK(other_mac != expected);
+        CHECK(sign_hex(jefe, "what do ya want for nothing?") == expected);
+        CHECK(sign_hex(jefe, "what do ya want for nothing?") == expected);
+        CHECK(sign_hex(other, "what do ya want for nothing?") == other_mac);
+    }
+
+    SUBCASE("Each thread gets the same MAC") {
+        HmacSigner signer("Jefe");
+        std::string expected = sign_hex(signer, "data");
+        std::string from_thread;
+        std::thread worker([&]() {
+            unsigned char mac[HmacSigner::MAC_SIZE];
+            if (signer.sign("data", mac)) {
+                from_thread = hex(mac, sizeof(mac));
+            }
+        });
+        worker.join();
+        CHECK(from_thread == expected);
+    }
+
+    SUBCASE("Verification") {
+        HmacSigner signer("secret");
+        unsigned char mac[HmacSigner::MAC_SIZE];
+        REQUIRE(signer.sign("header.payload", mac) == true);
+        CHECK(signer.verify("header.payload", mac, sizeof(mac)) == true);
+        CHECK(signer.verify("header.payload", mac, sizeof(mac) - 1) == false);
+        CHECK(signer.verify("header.payloaD", mac, sizeof(mac)) == false);
+        CHECK(HmacSigner("Secret").verify("header.payload", mac, sizeof(mac)) == false);
+        mac[0] ^= 1;
+        CHECK(signer.verify("header.payload", mac, sizeof(mac)) == false);
+    }
+}
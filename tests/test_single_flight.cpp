@@ -0,0 +1,154 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/cache/singleFlight.h"
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+static HttpResponsePtr make_response(const std::string& body) {
+    auto response = std::make_shared<HttpResponse>(HttpStatus::OK);
+    response->set_body(body, "text/plain");
+    return response;
+}
+
+/**
+ * A leader fetch that blocks until the test releases it
+ */
+struct SlowFetch {
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    void wait_started() { started.get_future().wait(); }
+};
+
+TEST_CASE("Single flight") {
+    SingleFlight flight;
+    std::atomic<int> own_fetches(0);
+    auto own_fetch = [&own_fetches]() {
+        ++own_fetches;
+        return make_response("own");
+    };
+
+    SUBCASE("Waiters share a copy of the leader's response") {
+        SlowFetch slow;
+        HttpResponsePtr leader_response;
+        bool leader_shared = true;
+        std::thread leader([&]() {
+            leader_response = flight.run("GET:/a", [&slow]() {
+                slow.started.set_value();
+                slow.released.wait();
+                return make_response("leader");
+            }, std::chrono::milliseconds(5000), &leader_shared);
+        });
+        slow.wait_started();
+
+        HttpResponsePtr waiter_response;
+        bool waiter_shared = false;
+        std::thread waiter([&]() {
+            waiter_response = flight.run("GET:/a", own_fetch, std::chrono::milliseconds(5000), &waiter_shared);
+        });
+
+        // Give the waiter time to join the in-flight fetch
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        slow.release.set_value();
+        leader.join();
+        waiter.join();
+
+        CHECK(leader_shared == false);
+        CHECK(leader_response->body() == "leader");
+        CHECK(waiter_shared == true);
+        CHECK(waiter_response->body() == "leader");
+        CHECK(waiter_response != leader_response);
+        CHECK(own_fetches == 0);
+
+        // The leader's response is its own to modify
+        leader_response->set_body("changed", "text/plain");
+        CHECK(waiter_response->body() == "leader");
+    }
+
+    SUBCASE("A waiter that times out fetches on its own") {
+        SlowFetch slow;
+        std::thread leader([&]() {
+            flight.run("GET:/a", [&slow]() {
+                slow.started.set_value();
+                slow.released.wait();
+                return make_response("leader");
+            }, std::chrono::milliseconds(5000));
+        });
+        slow.wait_started();
+
+        bool waiter_shared = true;
+        auto waiter_response = flight.run("GET:/a", own_fetch, std::chrono::milliseconds(20), &waiter_shared);
+        CHECK(waiter_shared == false);
+        CHECK(waiter_response->body() == "own");
+        CHECK(own_fetches == 1);
+
+        slow.release.set_value();
+        leader.join();
+    }
+
+    SUBCASE("A leader's exception is rethrown and waiters fetch on their own") {
+        SlowFetch slow;
+        bool leader_threw = false;
+        std::thread leader([&]() {
+            try {
+                flight.run("GET:/a", [&slow]() -> HttpResponsePtr {
+                    slow.started.set_value();
+                    slow.released.wait();
+                    throw std::runtime_error("backend failed");
+                }, std::chrono::milliseconds(5000));
+            }
+            catch (const std::runtime_error&) {
+                leader_threw = true;
+            }
+        });
+        slow.wait_started();
+
+        HttpResponsePtr waiter_response;
+        bool waiter_shared = true;
+        std::thread waiter([&]() {
+            waiter_response = flight.run("GET:/a", own_fetch, std::chrono::milliseconds(5000), &waiter_shared);
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        slow.release.set_value();
+        leader.join();
+        waiter.join();
+
+        CHECK(leader_threw == true);
+        CHECK(waiter_shared == false);
+        CHECK(waiter_response->body() == "own");
+        CHECK(own_fetches == 1);
+    }
+
+    SUBCASE("Finished fetches are not reused") {
+        bool shared = true;
+        flight.run("GET:/a", own_fetch, std::chrono::milliseconds(5000), &shared);
+        CHECK(shared == false);
+        flight.run("GET:/a", own_fetch, std::chrono::milliseconds(5000), &shared);
+        CHECK(shared == false);
+        CHECK(own_fetches == 2);
+    }
+
+    SUBCASE("Different keys do not wait for each other") {
+        SlowFetch slow;
+        std::thread leader([&]() {
+            flight.run("GET:/a", [&slow]() {
+                slow.started.set_value();
+                slow.released.wait();
+                return make_response("leader");
+            }, std::chrono::milliseconds(5000));
+        });
+        slow.wait_started();
+
+        bool shared = true;
+        auto response = flight.run("GET:/b", own_fetch, std::chrono::milliseconds(5000), &shared);
+        CHECK(shared == false);
+        CHECK(response->body() == "own");
+
+        slow.release.set_value();
+        leader.join();
+    }
+}
@@ -0,0 +1,190 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/ticketKeys.h"
+#include <cstdio>
+#include <fstream>
+#include <openssl/x509.h>
+#include <utime.h>
+
+static const std::string KEY_FILE = "test_ticket_keys.bin";
+
+static void write_keys(const std::string& keys, std::time_t mtime) {
+    {
+        std::ofstream file(KEY_FILE, std::ios::binary | std::ios::trunc);
+        file << keys;
+    }
+    // Reloads are keyed on the modification time, which has a one second resolution
+    utimbuf times{mtime, mtime};
+    utime(KEY_FILE.c_str(), &times);
+}
+
+static std::string make_key(char fill) {
+    return std::string(SessionTicketKeys::KEY_SIZE, fill);
+}
+
+/**
+ * Server context with a fresh self-signed certificate, limited to TLS 1.2
+ * so tickets arrive within the handshake
+ */
+static SSL_CTX* make_server_context(SessionTicketKeys& keys) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    EVP_PKEY* pkey = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, pkey);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    X509_sign(cert, pkey, EVP_sha256());
+    SSL_CTX_use_certificate(ctx, cert);
+    SSL_CTX_use_PrivateKey(ctx, pkey);
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+
+    SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+    keys.install(ctx);
+    return ctx;
+}
+
+/**
+ * Run a handshake over an in-memory BIO pair
+ * @param session Session to resume, or nullptr
+ * @param reused Set to whether the session was resumed
+ * @return The client's session afterwards, or nullptr if the handshake failed
+ */
+static SSL_SESSION* handshake(SSL_CTX* server_ctx, SSL_SESSION* session, bool& reused) {
+    SSL_CTX* client_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_max_proto_version(client_ctx, TLS1_2_VERSION);
+    SSL* client = SSL_new(client_ctx);
+    SSL* server = SSL_new(server_ctx);
+    BIO* client_bio = nullptr;
+    BIO* server_bio = nullptr;
+    BIO_new_bio_pair(&client_bio, 0, &server_bio, 0);
+    SSL_set_bio(client, client_bio, client_bio);
+    SSL_set_bio(server, server_bio, server_bio);
+    SSL_set_connect_state(client);
+    SSL_set_accept_state(server);
+    if (session) {
+        SSL_set_session(client, session);
+    }
+
+    bool client_done = false;
+    bool server_done = false;
+    for (int round = 0; round < 20 && !(client_done && server_done); ++round) {
+        client_done = client_done || SSL_do_handshake(client) == 1;
+        server_done = server_done || SSL_do_handshake(server) == 1;
+    }
+
+    SSL_SESSION* result = client_done && server_done ? SSL_get1_session(client) : nullptr;
+    reused = SSL_session_reused(client) == 1;
+
+    // Sessions of connections freed without a shutdown are not resumable
+    SSL_shutdown(client);
+    SSL_shutdown(server);
+    SSL_free(client);
+    SSL_free(server);
+    SSL_CTX_free(client_ctx);
+    return result;
+}
+
+TEST_CASE("Session ticket key files") {
+    SUBCASE("Files hold whole 80-byte keys") {
+        write_keys(make_key('a') + make_key('b'), 1000);
+        SessionTicketKeys keys(KEY_FILE, std::chrono::seconds(3600));
+        REQUIRE(keys.load() == true);
+        CHECK(keys.size() == 2);
+    }
+
+    SUBCASE("Empty, truncated and missing files are rejected") {
+        for (const std::string& contents : {std::string(), make_key('a').substr(1), make_key('a') + "x"}) {
+            write_keys(contents, 1000);
+            SessionTicketKeys keys(KEY_FILE, std::chrono::seconds(3600));
+            CHECK(keys.load() == false);
+            CHECK(keys.size() == 0);
+        }
+
+        std::remove(KEY_FILE.c_str());
+        SessionTicketKeys keys(KEY_FILE, std::chrono::seconds(3600));
+        CHECK(keys.load() == false);
+    }
+
+    std::remove(KEY_FILE.c_str());
+}
+
+TEST_CASE("Session ticket resumption") {
+    SUBCASE("Generated keys rotate and keep the keys they replaced") {
+        SessionTicketKeys keys("", std::chrono::seconds(0));
+        REQUIRE(keys.load() == true);
+        CHECK(keys.size() == 1);
+        SSL_CTX* ctx = make_server_context(keys);
+
+        bool reused = false;
+        SSL_SESSION* session = handshake(ctx, nullptr, reused);
+        REQUIRE(session != nullptr);
+        CHECK(reused == false);
+        CHECK(keys.size() == 2);
+
+        SSL_SESSION_free(handshake(ctx, nullptr, reused));
+        CHECK(keys.size() == SessionTicketKeys::KEPT_KEYS);
+
+        // The ticket's key is retired but still kept, so it is accepted and renewed
+        SSL_SESSION* resumed = handshake(ctx, session, reused);
+        REQUIRE(resumed != nullptr);
+        CHECK(reused == true);
+        for (size_t i = 0; i < SessionTicketKeys::KEPT_KEYS; ++i) {
+            SSL_SESSION_free(handshake(ctx, nullptr, reused));
+        }
+        CHECK(keys.size() == SessionTicketKeys::KEPT_KEYS);
+
+        // Once dropped the key no longer decrypts
+        SSL_SESSION* stale = handshake(ctx, session, reused);
+        CHECK(reused == false);
+
+        SSL_SESSION_free(stale);
+        SSL_SESSION_free(resumed);
+        SSL_SESSION_free(session);
+        SSL_CTX_free(ctx);
+    }
+
+    SUBCASE("Contexts sharing a key file resume each other's sessions") {
+        write_keys(make_key('a'), 1000);
+        SessionTicketKeys first_keys(KEY_FILE, std::chrono::seconds(0));
+        SessionTicketKeys second_keys(KEY_FILE, std::chrono::seconds(0));
+        REQUIRE(first_keys.load() == true);
+        REQUIRE(second_keys.load() == true);
+        SSL_CTX* first = make_server_context(first_keys);
+        SSL_CTX* second = make_server_context(second_keys);
+
+        bool reused = false;
+        SSL_SESSION* session = handshake(first, nullptr, reused);
+        REQUIRE(session != nullptr);
+        SSL_SESSION_free(handshake(second, session, reused));
+        CHECK(reused == true);
+
+        // A rewritten file is picked up on the next ticket, the old key still decrypts
+        write_keys(make_key('b') + make_key('a'), 2000);
+        SSL_SESSION_free(handshake(second, nullptr, reused));
+        CHECK(second_keys.size() == 2);
+        SSL_SESSION_free(handshake(second, session, reused));
+        CHECK(reused == true);
+
+        write_keys(make_key('b'), 3000);
+        SSL_SESSION_free(handshake(second, nullptr, reused));
+        CHECK(second_keys.size() == 1);
+        SSL_SESSION_free(handshake(second, session, reused));
+        CHECK(reused == false);
+
+        // An unreadable file keeps the current keys
+        write_keys("short", 4000);
+        SSL_SESSION_free(handshake(second, nullptr, reused));
+        CHECK(second_keys.size() == 1);
+
+        SSL_SESSION_free(session);
+        SSL_CTX_free(first);
+        SSL_CTX_free(second);
+    }
+
+    std::remove(KEY_FILE.c_str());
+}
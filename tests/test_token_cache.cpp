@@ -0,0 +1,64 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "../src/security/tokenCache.h"
+
+static VerifiedToken make_verified(long long expires_at, const std::string& subject) {
+    VerifiedToken verified;
+    verified.expires_at = expires_at;
+    verified.claims = std::make_shared<const JwtClaims>(JwtClaims{{"sub", subject}});
+    return verified;
+}
+
+TEST_CASE("Verified token cache") {
+    SUBCASE("Tokens are found until they expire") {
+        TokenCache cache(64);
+        cache.insert("token-a", make_verified(1000, "alice"));
+
+        VerifiedToken verified;
+        REQUIRE(cache.lookup("token-a", 999, verified) == true);
+        CHECK(verified.expires_at == 1000);
+        CHECK(verified.claims->at("sub") == "alice");
+        CHECK(cache.lookup("token-a", 1000, verified) == true);
+        CHECK(cache.lookup("token-a", 1001, verified) == false);
+        CHECK(cache.lookup("token-b", 999, verified) == false);
+    }
+
+    SUBCASE("A token verified twice is kept once") {
+        TokenCache cache(64);
+        cache.insert("token", make_verified(1000, "alice"));
+        cache.insert("token", make_verified(1000, "alice"));
+        CHECK(cache.size() == 1);
+    }
+
+    SUBCASE("Full shards drop their oldest tokens") {
+        TokenCache cache(4, 1);
+        for (int i = 0; i < 6; ++i) {
+            cache.insert("token-" + std::to_string(i), make_verified(1000, std::to_string(i)));
+        }
+        CHECK(cache.size() == 4);
+
+        VerifiedToken verified;
+        CHECK(cache.lookup("token-0", 0, verified) == false);
+        CHECK(cache.lookup("token-1", 0, verified) == false);
+        CHECK(cache.lookup("token-5", 0, verified) == true);
+    }
+
+    SUBCASE("Capacity is spread over the shards") {
+        TokenCache cache(1000, 16);
+        for (int i = 0; i < 5000; ++i) {
+            cache.insert("token-" + std::to_string(i), make_verified(1000, ""));
+        }
+        CHECK(cache.size() <= 1008);
+        CHECK(cache.size() >= 900);
+    }
+
+    SUBCASE("Clearing forgets every token") {
+        TokenCache cache(64);
+        cache.insert("token", make_verified(1000, "alice"));
+        cache.clear();
+        CHECK(cache.size() == 0);
+
+        VerifiedToken verified;
+        CHECK(cache.lookup("token", 0, verified) == false);
+    }
+}